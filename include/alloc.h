@@ -0,0 +1,77 @@
+/**
+*************************************************************
+* @file     alloc.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Counters of the heap allocations of every call site, built with
+*           make COUNT_ALLOCS=1, which includes this file in every source
+*           so that malloc, calloc, realloc and aligned_alloc are counted.
+*************************************************************
+*/
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+// Included before any other header with COUNT_ALLOCS, so with the features
+// some sources ask for before theirs
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // declared before the wrappers below
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+
+// Allocations counted per call site, fixed at compile time so that the
+// default build calls the allocator directly (make COUNT_ALLOCS=1)
+#ifndef COUNT_ALLOCS
+#define COUNT_ALLOCS 0
+#endif
+
+#define ALLOC_MAX_SITES 1024   // call sites counted, the others are merged
+#define ALLOC_REPORT_SITES 16 // call sites logged at exit, by calls
+
+#if COUNT_ALLOCS
+#define malloc(size) countedMalloc((size), __FILE__, __LINE__)
+#define calloc(n, size) countedCalloc((n), (size), __FILE__, __LINE__)
+#define realloc(pointer, size)                                                 \
+  countedRealloc((pointer), (size), __FILE__, __LINE__)
+#define aligned_alloc(alignment, size)                                         \
+  countedAlignedAlloc((alignment), (size), __FILE__, __LINE__)
+#define free(pointer) countedFree(pointer)
+#endif
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// Allocations of the process so far, all zero unless COUNT_ALLOCS
+typedef struct AllocTotals {
+  uint64_t calls; // malloc, calloc, realloc and aligned_alloc
+  uint64_t bytes; // requested by these calls
+  uint64_t frees;
+} AllocTotals;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+void *countedMalloc(size_t size, const char *file, int line);
+void *countedCalloc(size_t n, size_t size, const char *file, int line);
+void *countedRealloc(void *pointer, size_t size, const char *file, int line);
+void *countedAlignedAlloc(size_t alignment, size_t size, const char *file,
+                          int line);
+void countedFree(void *pointer);
+bool allocCounted(void);
+AllocTotals allocTotals(void);
+long peakResidentKiB(void);
+void logAllocations(unsigned int steps);
+
+#endif // !ALLOC_H
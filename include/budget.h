@@ -0,0 +1,56 @@
+/**
+*************************************************************
+* @file     budget.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Memory needed by a mesh before it is built: its points, springs,
+*           the scratch of its update and the buffers of its frames, checked
+*           against the memory available and the range of meshIndex.
+*************************************************************
+*/
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define BUDGET_COORDINATE_TEXT 11 // usual text of a coordinate, -123.456789
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// Bytes allocated by the mesh and its frames, grouped as they are reported.
+// The counts are those of the mesh to be built, the largest over the
+// adaptations for a refined grid.
+typedef struct MemoryBudget {
+  size_t state;   // positions, rest positions and velocities of the points
+  size_t springs; // springs, faces and their states
+  size_t scratch; // accelerations and lists of the update
+  size_t output;  // frames being formatted, drawn or shared
+  unsigned int n, m; // lines and columns of the mesh
+  uint64_t n_springs, n_faces;
+} MemoryBudget;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+void initMemoryBudget(MemoryBudget *);
+bool budgetGrid(MemoryBudget *, const Params *);
+bool budgetScene(MemoryBudget *, unsigned int n_bodies, const Params *);
+bool budgetRefinedGrid(MemoryBudget *, const Params *);
+size_t availableMemory(void);
+bool checkMemoryBudget(MemoryBudget *, const Options *);
+
+#endif // !BUDGET_H
@@ -0,0 +1,82 @@
+/**
+*************************************************************
+* @file     cloth.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Public API of libcloth, to drive a simulation from a host process
+*           and read its state in place.
+*************************************************************
+*/
+
+#ifndef CLOTH_H
+#define CLOTH_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef struct Cloth Cloth;
+
+// Called once per spring broken during an update, after the update
+typedef void (*clothBreakCallback)(const Cloth *, meshIndex spring,
+                                   void *user_data);
+
+// Called after every STEP updates, like the VTK files of the application
+typedef void (*clothFrameCallback)(const Cloth *, unsigned int step,
+                                   void *user_data);
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+/**
+ * @brief Create a simulation of the given type.
+ *
+ * @param type The scenario, it defines the fixed points and the added forces.
+ * @param params The params to use, NULL for the default params of the type.
+ * @return The simulation, NULL if the type is not handled or the params are
+ *         rejected (see checkGridParams).
+ */
+Cloth *clothCreate(meshType type, const Params *params);
+
+/**
+ * @brief Set the param `name` (a field of Params, e.g. C_DIS or FLUID.z).
+ *
+ * Params used to build the mesh (dimensions, spacing, stiffnesses) can only
+ * be set before the first step, the mesh is then rebuilt. The others take
+ * effect at the next step.
+ *
+ * @return 0 on success, -1 if the name is unknown, the param is frozen or
+ *         the mesh can not be rebuilt with it, which keeps the mesh.
+ */
+int clothSetParam(Cloth *, const char *name, float value);
+const Params *clothGetParams(const Cloth *);
+
+void clothOnBreak(Cloth *, clothBreakCallback, void *user_data);
+void clothOnFrame(Cloth *, clothFrameCallback, void *user_data);
+
+/**
+ * @brief Advance the simulation of n updates of DELTA_T.
+ */
+void clothStep(Cloth *, unsigned int n);
+unsigned int clothStepCount(const Cloth *);
+
+/**
+ * Read-only access to the state, valid until the next step. Positions and
+ * velocities are n * m vectors stored line after line, the point (i, j)
+ * being at i * m + j. With params.STENCIL there is no list of springs:
+ * clothSprings returns NULL and a count of 0.
+ */
+const Mesh *clothMesh(const Cloth *);
+const Vector *clothPositions(const Cloth *, unsigned int *n, unsigned int *m);
+const Vector *clothVelocities(const Cloth *);
+const Spring *clothSprings(const Cloth *, meshIndex *count);
+
+void clothDestroy(Cloth *);
+
+#endif // !CLOTH_H
@@ -0,0 +1,53 @@
+/**
+*************************************************************
+* @file     diagnostics.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Physical quantities computed during each update, written as a
+*           per-update time series.
+*************************************************************
+*/
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "space.h"
+#include <stdio.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define DIAG_DAMAGE_BINS 10
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// State of the mesh at the end of an update. The spring quantities are those
+// of the springs which were intact at the start of the update.
+typedef struct Diagnostics {
+  double kinetic_energy;   // sum of 1/2 Mu |V|^2
+  double potential_energy; // sum of the elastic energy of the springs
+  float max_strain;        // largest elongation over rest length
+  // Springs by damage / DAMAGE_THRESHOLD, bin k for [k, k+1) / BINS, the
+  // first one also counting negative damage and the last one values above 1
+  meshIndex damage_histogram[DIAG_DAMAGE_BINS];
+  meshIndex broken_springs; // total since the start
+  Vector min, max;             // bounding box of the points
+} Diagnostics;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Diagnostics *newDiagnostics(void);
+unsigned int damageBin(float damage, float threshold);
+void writeDiagnosticsHeader(FILE *);
+void writeDiagnostics(FILE *, unsigned int step, float t,
+                      const Diagnostics *);
+
+#endif // !DIAGNOSTICS_H
@@ -0,0 +1,58 @@
+/**
+*************************************************************
+* @file     distributed.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Mesh split in blocks over MPI ranks, each rank updating its
+*           block and exchanging a halo of 2 points with its neighbours.
+*           Only built by `make mpi`.
+*************************************************************
+*/
+
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+#include <mpi.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+// Points of the neighbours kept around a block, the flexion springs span 2
+#define DIST_HALO 2
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// The rank at (ci, cj) of the process grid owns the points
+// [own_i0, own_i1) x [own_j0, own_j1) of the N x M grid. Its mesh is the
+// block widened by the halo, clipped to the grid, so that every spring of
+// an owned point is in it. The springs between two blocks are updated by
+// both ranks from the same positions, and so break at the same update.
+typedef struct Distributed {
+  MPI_Comm comm; // cartesian communicator
+  int rank, size;
+  int dims[2], coords[2];
+  int lower[2], upper[2]; // neighbours along i and j, MPI_PROC_NULL if none
+  unsigned int own_i0, own_i1, own_j0, own_j1;
+  Mesh *mesh;          // block and halo, in the coordinates of the block
+  MPI_Datatype vector; // one Vector
+  MPI_Datatype column; // DIST_HALO columns of the mesh, every line
+} Distributed;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Distributed *newDistributed(MPI_Comm, meshType, const Params *);
+void distributedUpdate(Distributed *, float delta_t, meshType);
+meshIndex distributedBrokenSprings(const Distributed *);
+int writeDistributedVTK(const Distributed *, const char *directory,
+                        const char *name, unsigned int iteration);
+void freeDistributed(Distributed *);
+
+#endif // !DISTRIBUTED_H
@@ -1,23 +1,53 @@
-/**
-*************************************************************
-* @file     log.h
-* @author   Stackoverflow : https://stackoverflow.com/a/23446001
-* @date     20/07/2024
-* @brief
-*************************************************************
-*/
-
-#ifndef LOG_H
-#define LOG_H
-
-#include <stdarg.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
-
-void log_error(const char *message, ...);
-void log_info(const char *message, ...);
-void log_debug(const char *message, ...);
-
+/**
+*************************************************************
+* @file     log.h
+* @author   Stackoverflow : https://stackoverflow.com/a/23446001
+* @date     20/07/2024
+* @brief
+*************************************************************
+*/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+// Level of the logs inside the update loops, fixed at compile time so that
+// the lower levels cost nothing (make LOG_HOT_LEVEL=1). The trace records the
+// same events without printing them.
+#ifndef LOG_HOT_LEVEL
+#define LOG_HOT_LEVEL LOG_LEVEL_NONE
+#endif
+
+#if LOG_HOT_LEVEL >= LOG_LEVEL_ERROR
+#define log_hot_error(...) log_error(__VA_ARGS__)
+#else
+#define log_hot_error(...) ((void)0)
+#endif
+
+#if LOG_HOT_LEVEL >= LOG_LEVEL_INFO
+#define log_hot_info(...) log_info(__VA_ARGS__)
+#else
+#define log_hot_info(...) ((void)0)
+#endif
+
+#if LOG_HOT_LEVEL >= LOG_LEVEL_DEBUG
+#define log_hot_debug(...) log_debug(__VA_ARGS__)
+#else
+#define log_hot_debug(...) ((void)0)
+#endif
+
+void log_error(const char *message, ...);
+void log_info(const char *message, ...);
+void log_debug(const char *message, ...);
+
 #endif
\ No newline at end of file
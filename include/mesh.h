@@ -1,78 +1,174 @@
-/**
-*************************************************************
-* @file     mesh.h
-* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
-* @date     20/07/2024
-* @brief
-*************************************************************
-*/
-
-#ifndef MESH_H
-#define MESH_H
-
-/************************************
- * INCLUDES
- ************************************/
-#include "log.h"
-#include "params.h"
-#include "space.h"
-#include "spring.h"
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-
-/************************************
- * MACROS AND DEFINES
- ************************************/
-#define SPRINGS_PER_FACE 8
-
-/************************************
- * TYPEDEFS
- ************************************/
-
-typedef struct Mesh {
-  unsigned int n; // number of lines
-  unsigned int m; // number of columns
-
-  float t;    // the time at which position P are calculated
-  Vector **P; // Coordinate in the space at t time, should be used for rendering
-  Vector **V; // Velocity matrix n*m
-
-  Vector **P0; // Initial position matrix
-
-  Spring
-      *springs; // list of springs of the mesh, refered as R in the litterature
-  unsigned int n_springs; // number of non-break springs in the mesh
-
-  unsigned int **
-      *face_spring_indices; // 2D array of spring indices for each face
-} Mesh;
-
-typedef enum {
-  CURTAIN,     // A curtain(rideau) in the x, y plan with two points fixed
-  TABLE_CLOTH, // Square Table on the plan x, z with a circular table. The edge
-               // is tree times the radius.
-  SOFT,        // A cloth in the x, y plan which it strech untill it breaks
-  FLAG
-} meshType;
-
-/************************************
- * EXPORTED VARIABLES AND CONST
- ************************************/
-
-/************************************
- * GLOBAL FUNCTION PROTOTYPES
- ************************************/
-
-bool isFixedPoint(unsigned int, unsigned int, Mesh *mesh, meshType);
-// void customs_params(meshType type);
-
-void initMesh(Mesh *, meshType);
-void updatePosition(Mesh *, float, meshType);
-void computeSpringForces(Mesh *, Vector **, meshType, float);
-void freeMesh(Mesh *);
-
-Vector computeAddForces(Mesh *, meshType, unsigned int, unsigned int);
-Vector computeFluidForce(Mesh *, unsigned int, unsigned int, Vector);
-
-#endif // !MESH_H
+/**
+*************************************************************
+* @file     mesh.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     20/07/2024
+* @brief
+*************************************************************
+*/
+
+#ifndef MESH_H
+#define MESH_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "diagnostics.h"
+#include "log.h"
+#include "params.h"
+#include "profile.h"
+#include "refine.h"
+#include "space.h"
+#include "spring.h"
+#include "stencil.h"
+#include "surface.h"
+#include "temporal.h"
+#include "tile.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define NO_FACE MESH_INDEX_MAX // missing face of a spring
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef struct Mesh {
+  unsigned int n; // number of lines
+  unsigned int m; // number of columns
+  unsigned int i0, j0; // first line and column in the grid of params, 0
+                       // unless the mesh is a block of a distributed mesh
+
+  float t;    // the time at which position P are calculated
+  Vector **P; // Coordinate in the space at t time, should be used for rendering
+  Vector **V; // Velocity matrix n*m
+
+  Vector **P0; // Initial position matrix
+
+  Spring
+      *springs; // list of springs of the mesh, refered as R in the litterature
+  meshIndex total_springs; // number of springs, broken or not
+  meshIndex n_springs; // number of non-break springs in the mesh
+  meshIndex *broken_springs; // springs broken during the last update, or
+                             // the last block of updates, see temporal.h
+  meshIndex n_broken;        // number of springs in broken_springs
+
+  // Deterministic mode only (params.DETERMINISTIC): the springs of the point
+  // p are point_springs[point_springs_start[p] .. point_springs_start[p+1]],
+  // stored as (index << 1 | 1 if p is ext_2), and spring_forces holds the
+  // acceleration each spring gives to its ext_1
+  meshIndex *point_springs_start;
+  meshIndex *point_springs;
+  Vector *spring_forces;
+
+  // Tiled update only (params.TILE_SIZE > 0), see tile.h
+  Tiling *tiling;
+
+  // Temporally blocked update only (params.TEMPORAL_STEPS > 1), see
+  // temporal.h
+  TemporalBlocking *temporal;
+
+  // Implicit springs only (params.STENCIL), see stencil.h; springs,
+  // face_springs and spring_faces are then NULL
+  Stencil *stencil;
+
+  // Imported meshes only (initMeshFromObj), see surface.h; the points are
+  // then the line 0 of the mesh, and its faces those of the surface
+  Surface *surface;
+
+  // Refined grids only (initMeshAdaptive), see refine.h; the points and
+  // faces are then those of the surface, rebuilt by adaptMesh. The mass of
+  // the point p is mass[p] times params.Mu, NULL if they all weigh Mu
+  Refinement *refinement;
+  float *mass;
+
+  // Scenes only (initMeshScene): the bodies whose points, springs and faces
+  // are packed in those of the mesh, see Scene
+  struct Scene *scene;
+
+  // Faces, (i, j) of a grid being the face i * (m - 1) + j. The springs of
+  // the face f are face_springs[f * SPRINGS_PER_FACE ...], see fillSprings,
+  // and the faces of the spring k spring_faces[2 * k] and [2 * k + 1].
+  // The bit f of broken_faces is set once a structural spring of f broke.
+  meshIndex n_faces;
+  meshIndex *face_springs;
+  meshIndex *spring_faces;
+  uint64_t *broken_faces;
+  meshIndex n_broken_faces;
+
+  Params params; // parameters of the simulation this mesh belongs to
+  Profile *profile; // timers of the phases, NULL when not profiled
+  Diagnostics *diagnostics; // computed by each update, NULL if not needed
+  Trace *trace;             // solver events, NULL if not traced
+} Mesh;
+
+typedef enum {
+  CURTAIN,     // A curtain(rideau) in the x, y plan with two points fixed
+  TABLE_CLOTH, // Square Table on the plan x, z with a circular table. The edge
+               // is tree times the radius.
+  SOFT,        // A cloth in the x, y plan which it strech untill it breaks
+  FLAG
+} meshType;
+
+// A body of a scene, a grid of its own type and params. Its points, springs
+// and faces are the ranges of those of the scene starting at first_point,
+// first_spring and first_face, in the order of the grid.
+typedef struct Body {
+  meshType type;
+  Mesh *mesh; // the grid of the body, whose lines are those of the points
+              // of the scene; its springs and face states are copied from
+              // the scene by syncSceneBodies
+  meshIndex first_point, first_spring, first_face;
+} Body;
+
+// Several cloths updated as a single mesh: its points are the line 0 of the
+// mesh and its faces those of its surface, as an imported mesh, so that one
+// pass over the springs and one over the points cover all of them. The
+// forces on a point and the breaking of a spring follow the params and the
+// type of its body.
+typedef struct Scene {
+  unsigned int n_bodies;
+  Body *bodies;
+  unsigned int *point_body; // body of each point of the mesh
+} Scene;
+
+/************************************
+ * EXPORTED VARIABLES AND CONST
+ ************************************/
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+bool isFixedPoint(unsigned int, unsigned int, Mesh *mesh, meshType);
+void customs_params(Params *, meshType);
+
+bool checkMeshIndices(uint64_t points);
+bool checkGridParams(meshType, const Params *);
+int initMesh(Mesh *, meshType, const Params *);
+int initMeshBlock(Mesh *, meshType, const Params *, unsigned int i0,
+                  unsigned int j0, unsigned int n, unsigned int m);
+int initMeshFromObj(Mesh *, meshType, const Params *, const char *filename,
+                    reorderPolicy);
+int initMeshAdaptive(Mesh *, meshType, const Params *);
+int initMeshScene(Mesh *, unsigned int n_bodies, const meshType *types,
+                  const Params *params, const Vector *offsets);
+void syncSceneBodies(Mesh *);
+bool adaptMesh(Mesh *, meshType);
+void updatePosition(Mesh *, float, meshType);
+void updatePositions(Mesh *, float, meshType, unsigned int steps);
+void computeSpringForces(Mesh *, Vector **, meshType, float);
+void freeMesh(Mesh *);
+bool isFaceIntact(const Mesh *, unsigned int, unsigned int);
+bool isMeshFaceIntact(const Mesh *, meshIndex face);
+
+Vector computeAddForces(Mesh *, meshType, unsigned int, unsigned int);
+Vector computeFluidForce(Mesh *, unsigned int, unsigned int, Vector);
+
+#endif // !MESH_H
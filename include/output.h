@@ -0,0 +1,61 @@
+/**
+*************************************************************
+* @file     output.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    When to write a frame: every STEP updates, or when the cloth
+*           moved or tore since the last frame, within bounds on the
+*           interval between two frames.
+*************************************************************
+*/
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define OUTPUT_MAX_STEPS 10 // default longest interval, in STEP
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// With no tolerance, a frame is written every `max` updates. Otherwise, a
+// frame is written once a point moved more than tolerance * SPACING from
+// its position in the last frame, a spring broke or the points were
+// rebuilt, if `min` updates passed since the last frame, and after `max`
+// updates in any case.
+typedef struct OutputPolicy {
+  float tolerance;       // in spacings of the grid, 0 for a fixed interval
+  unsigned int min, max; // updates between two frames
+  unsigned int last;     // update of the last frame
+  unsigned int n_frames; // frames written so far
+  meshIndex n_springs;    // intact springs at the last frame
+  unsigned int n_points;  // points in reference
+  Vector *reference;      // positions of the points at the last frame
+  bool rebuilt;           // the points changed since the last frame
+  FILE *times;            // frame, update and time of each frame, or NULL
+} OutputPolicy;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+void initOutputPolicy(OutputPolicy *, float tolerance, unsigned int min,
+                      unsigned int max);
+int recordFrameTimes(OutputPolicy *, const char *filename);
+bool isFrameDue(OutputPolicy *, const Mesh *, unsigned int update);
+void frameWritten(OutputPolicy *, const Mesh *, unsigned int update,
+                  const char *name);
+unsigned int updatesBeforeCheck(const OutputPolicy *, unsigned int update);
+void closeOutputPolicy(OutputPolicy *);
+
+#endif // !OUTPUT_H
@@ -11,37 +11,106 @@
 #define PARAMS_H
 
 #include "space.h"
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+
+// Counts and indices of the springs and faces, and of the points of a
+// mesh, which are 64-bit in the large-mesh build (make LARGE_MESH=1). A
+// configuration whose counts do not fit is refused, see budget.h.
+#ifndef LARGE_MESH
+#define LARGE_MESH 0
+#endif
+#if LARGE_MESH
+typedef uint64_t meshIndex;
+#define MESH_INDEX_MAX UINT64_MAX
+#define PRI_MESH_INDEX PRIu64 // printf conversion of a meshIndex
+#else
+typedef unsigned int meshIndex;
+#define MESH_INDEX_MAX UINT_MAX
+#define PRI_MESH_INDEX "u"
+#endif
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// Parameters of one simulation, every mesh carries its own copy so several
+// configurations can run in the same process.
+typedef struct Params {
+  // SPACE CONST
+  unsigned int M, N; // Matrix dimensions
+  float SPACING; // Standard spacing between two points on the same axis
+
+  // MESH CONST
+  float Mu;    // Mass of a point
+  float C_DIS; // Damping coefficient
+  float C_VI;  // Viscous coefficient
+
+  // SPRINGS CONST
+  int MAX_SPRINGS_PER_POINT;
+  float STIFFNESS_H;      // Stiffness of a horizontal spring
+  float STIFFNESS_V;      // Stiffness of a vertical spring
+  float STIFFNESS_D;      // Stiffness of a diagonal spring
+  float ENERGY_THRESHOLD; // Maximum energy a spring can accumulate
+  float DAMAGE_THRESHOLD; // Maximum damage a spring can take
+
+  // FIXED POINT
+  float
+      RADIUS; // For the table, the radius of the circle containing fixed points
+
+  // SIMULATION
+  float DELTA_T; // Time interval between two consecutives updates.
+  unsigned int NB_UPDATES; // Total numbers of updates
+  int STEP; // Step used for files generation, as instance a step of 10
+            // means 1 file generated every 10 update
+
+  Vector GRAVITY;
+  Vector FLUID;
+
+  // PARALLELISM
+  unsigned int DETERMINISTIC; // 1 for results independent of the number of
+                              // threads and of the scheduling
+  unsigned int TILE_SIZE; // points on a side of the tiles of the tiled
+                          // update, 0 to update the whole grid at once
+  unsigned int TEMPORAL_STEPS; // updates a tile of the deterministic update
+                               // advances at once, 0 or 1 for none; above 1
+                               // needs DETERMINISTIC, which --temporal sets
+  unsigned int TEMPORAL_TILE;  // points on a side of these tiles
+  unsigned int STENCIL; // 1 for springs implied by the grid, only their
+                        // damage and state being stored
+  unsigned int PARALLEL_THRESHOLD; // points under which an update is done by
+                                   // a single thread
+
+  // ADAPTIVE REFINEMENT
+  unsigned int REFINE_LEVELS; // times a face of the grid can be split in
+                              // four, 0 for a grid that is not refined
+  float REFINE_STRAIN;        // strain over which a face is split
+  float REFINE_CURVATURE;     // angle, in radians, between the normal of a
+                              // face and of a corner over which it is split
+} Params;
+
+// Description of a field of Params, to set it from its name
+typedef struct ParamInfo {
+  const char *name; // name of the field, FLUID.x for a component
+  size_t offset;    // offset of the field in Params
+  bool isInteger;   // unsigned int field, float otherwise
+  bool isTopology;  // used when the mesh is built, cannot change afterwards
+} ParamInfo;
+
 /************************************
- * EXPORTED VARIABLES
+ * GLOBAL FUNCTION PROTOTYPES
  ************************************/
 
-// SPACE CONST
-extern unsigned int M, N; // Matrix dimensions
-extern float SPACING; // Standard spacing between two points on the same axis
-
-// MESH CONST
-extern float Mu;    // Mass of a point
-extern float C_DIS; // Damping coefficient
-extern float C_VI;  // Viscous coefficient
-
-// SPRINGS CONST
-extern int MAX_SPRINGS_PER_POINT;
-extern float STIFFNESS_H;      // Stiffness of a horizontal spring
-extern float STIFFNESS_V;      // Stiffness of a vertical spring
-extern float STIFFNESS_D;      // Stiffness of a diagonal spring
-extern float ENERGY_THRESHOLD; // Maximum energy a spring can accumulate
-extern float DAMAGE_THRESHOLD; // Maximum damage a spring can take
-
-// FIXED POINT
-extern float
-    RADIUS; // For the table, the radius of the circle containing fixed points
-
-// SIMULATION
-extern float DELTA_T; // Time interval between two consecutives updates.
-extern unsigned int NB_UPDATES; // Total numbers of updates
-extern int STEP; // Step used for files generation, as instance a step of 10
-                 // means 1 file generated every 10 update
-
-extern Vector GRAVITY;
-extern Vector FLUID;
+Params defaultParams(void);
+const ParamInfo *findParam(const char *name);
+void setParam(Params *, const ParamInfo *, float value);
+float getParam(const Params *, const ParamInfo *);
+
 #endif // PARAMS_H
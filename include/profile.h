@@ -0,0 +1,102 @@
+/**
+*************************************************************
+* @file     profile.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Timers around the phases of an update and of the output, with a
+*           JSON or CSV report at the end of the run.
+*************************************************************
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "alloc.h"
+#include "params.h"
+#include <omp.h>
+#include <stdio.h>
+#include <time.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+
+// The timers cost one test when the mesh has no profile attached
+#define PROFILE_START(profile, name)                                           \
+  double name = (profile) != NULL ? profileNow() : 0.0
+#define PROFILE_STOP(profile, phase, name)                                     \
+  do {                                                                         \
+    if ((profile) != NULL)                                                     \
+      profileAdd((profile), (phase), profileNow() - (name));                   \
+  } while (0)
+// Inside a parallel loop, see profileCollectThreads
+#define PROFILE_STOP_THREAD(profile, name)                                     \
+  do {                                                                         \
+    if ((profile) != NULL)                                                     \
+      (profile)->threads[omp_get_thread_num()].elapsed +=                      \
+          profileNow() - (name);                                               \
+  } while (0)
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef enum {
+  PHASE_STEP,        // a whole update
+  PHASE_SPRINGS,     // spring force loop
+  PHASE_MERGE,       // merge of the thread-local accelerations
+  PHASE_FLUID,       // normal and fluid force computation
+  PHASE_INTEGRATION, // the rest of the vertex loop
+  PHASE_VTK_FORMAT,  // formatting of the VTK files in memory
+  PHASE_VTK_WRITE,   // writing of the VTK files
+  PHASE_RENDER,      // rasterization of an image frame
+  PHASE_IMAGE_WRITE, // writing of an image frame
+  PHASE_COUNT
+} profilePhase;
+
+// Durations of every occurrence of a phase
+typedef struct PhaseSamples {
+  double current; // accumulated during the current step
+  unsigned int occurred; // the phase was timed during the current step
+  double *samples;       // one duration per step where it occurred
+  unsigned int count, capacity;
+} PhaseSamples;
+
+// Time spent by each thread in a phase of a parallel loop, one cache line
+// per thread
+typedef struct ThreadTimer {
+  double elapsed;
+  char padding[64 - sizeof(double)];
+} ThreadTimer;
+
+typedef struct Profile {
+  PhaseSamples phases[PHASE_COUNT];
+  ThreadTimer *threads; // per-thread time in PHASE_FLUID
+  int n_threads;
+  unsigned int steps;
+  double springs; // total number of spring updates
+  double startup; // initialization of the mesh, before the first update
+  // Allocation calls and bytes since the end of the last step, the frames
+  // written in between included, when they are counted, see alloc.h
+  PhaseSamples allocations, allocated_bytes;
+  AllocTotals allocated; // totals at the end of the last step
+} Profile;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Profile *newProfile(void);
+double profileNow(void);
+void profileAdd(Profile *, profilePhase, double elapsed);
+double profileCollectThreads(Profile *);
+void profileEndStep(Profile *, meshIndex springs);
+int writeProfileReport(const Profile *, const char *filename,
+                       const char *mesh_name, unsigned int n, unsigned int m,
+                       double elapsed);
+void freeProfile(Profile *);
+
+#endif // !PROFILE_H
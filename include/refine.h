@@ -0,0 +1,89 @@
+/**
+*************************************************************
+* @file     refine.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Adaptive refinement of the grid: its faces are split in four
+*           where the cloth folds or stretches, and merged back once it
+*           relaxes. The points of every level are those of a lattice finer
+*           than the grid.
+*************************************************************
+*/
+
+#ifndef REFINE_H
+#define REFINE_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "space.h"
+#include "spring.h"
+#include "surface.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define REFINE_NONE UINT_MAX // lattice index without a point
+#define REFINE_OUTLINE 8     // points around a leaf, see leafOutline
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// A face of the refined grid. Its corners are (i, j), (i + side, j),
+// (i + side, j + side) and (i, j + side) on the lattice, side being
+// 1 << (levels - level) lattice steps.
+typedef struct Leaf {
+  unsigned int i, j;
+  unsigned int level; // 0 for a face of the grid
+  float damage; // mean damage of the springs of its edges, given to the new
+                // springs inside it when it is split or merged
+} Leaf;
+
+// The lattice has (N - 1) << levels + 1 lines and (M - 1) << levels + 1
+// columns, its point (i, j) being the point (i, j) / (1 << levels) of the
+// grid. Neighbouring faces differ by at most one level, the edges of the
+// coarser one being split by the corners of the finer ones.
+typedef struct Refinement {
+  unsigned int levels; // maximum number of splits of a face of the grid
+  unsigned int n, m;   // lines and columns of the lattice
+  unsigned int n_leaves;
+  Leaf *leaves; // sorted by the lattice index of their corner (i, j)
+  unsigned int n_points;
+  unsigned int *points;   // lattice index i * m + j of each point, sorted
+  unsigned int *point_of; // point at each lattice index, or REFINE_NONE
+
+  // The leaves and points before the last adaptRefinement
+  unsigned int old_n_leaves;
+  Leaf *old_leaves;
+  unsigned int old_n_points;
+  unsigned int *old_points;
+} Refinement;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Refinement *newRefinement(unsigned int N, unsigned int M, unsigned int levels);
+unsigned int leafSide(const Refinement *, const Leaf *);
+unsigned int leafOutline(const Refinement *, unsigned int leaf,
+                         unsigned int *points);
+Surface *refinementSurface(const Refinement *);
+meshIndex refinementSprings(const Refinement *, const Params *,
+                            Spring **springs, meshIndex **face_springs);
+void refinementMasses(const Refinement *, float *mass);
+bool adaptRefinement(Refinement *, const Surface *, const Vector *P,
+                     const Vector *P0, const Spring *springs,
+                     const meshIndex *face_springs,
+                     const uint64_t *broken_faces, const Params *);
+void carryPoints(const Refinement *, const Vector *old_P,
+                 const Vector *old_V, Vector *P, Vector *V);
+void carrySprings(const Refinement *, Spring *springs, meshIndex n_springs,
+                  const Spring *old_springs, meshIndex old_n_springs);
+void freeRefinement(Refinement *);
+
+#endif // !REFINE_H
@@ -0,0 +1,82 @@
+/**
+*************************************************************
+* @file     render.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Software rasterizer of the faces of a mesh, run in the
+*           simulation to write PNG or PPM frames instead of the VTK files.
+*************************************************************
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+#include "space.h"
+#include <stdbool.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define RENDER_DEFAULT_WIDTH 640
+#define RENDER_DEFAULT_HEIGHT 480
+#define RENDER_DEFAULT_FOV 40.0f // degrees
+#define RENDER_STRAIN_SCALE 0.1f // strain drawn in red, 0 being blue
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef enum {
+  IMAGE_PNG, // compressed by zlib, the default
+  IMAGE_PPM, // binary PPM, not compressed
+} imageFormat;
+
+typedef enum {
+  COLOR_STATE,  // intact faces in the cloth color, broken ones in red
+  COLOR_STRAIN, // largest strain of the edges, broken faces not drawn
+} colorMode;
+
+// A perspective camera. The eye and the target left unset are placed by
+// fitCamera so that the mesh fills the image.
+typedef struct Camera {
+  Vector eye;    // position of the camera
+  Vector target; // point at the center of the image
+  Vector up;     // direction of the top of the image
+  bool has_eye, has_target;
+  float fov;                  // vertical field of view, in degrees
+  unsigned int width, height; // of the image, in pixels
+} Camera;
+
+typedef struct Renderer {
+  Camera camera;
+  colorMode color;
+  imageFormat format;
+  unsigned char *pixels; // RGB of each pixel, top row first
+  float *depth;          // inverse distance of each pixel, 0 if empty
+  unsigned int n_points; // points for which screen and shade are allocated
+  Vector *screen;        // x, y in pixels and inverse distance of each point
+  float *shade;          // lighting of each point, from 0 to 1
+  meshIndex n_faces;     // faces for which colors are allocated
+  float (*colors)[3];    // RGB of each face, negative if it is not drawn
+} Renderer;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Camera defaultCamera(void);
+bool parseImageFormat(const char *name, imageFormat *format);
+const char *imageFormatName(imageFormat);
+bool parseColorMode(const char *name, colorMode *mode);
+void fitCamera(Camera *, const Mesh *);
+Renderer *newRenderer(const Camera *, colorMode, imageFormat);
+void renderMesh(Renderer *, const Mesh *);
+void convertMeshToImage(Renderer *, const Mesh *,
+                        const char *output_filename);
+void freeRenderer(Renderer *);
+
+#endif // !RENDER_H
@@ -0,0 +1,105 @@
+/**
+*************************************************************
+* @file     shm.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    POSIX shared-memory ring buffer of mesh frames, used as a live
+*           alternative to the VTK files.
+*************************************************************
+*/
+
+#ifndef SHM_H
+#define SHM_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define SHM_DEFAULT_NAME "/cloth_frames"
+#define SHM_DEFAULT_SLOTS 8
+#define SHM_NAME_MAX 64 // bytes of a segment name, its '\0' included
+#define SHM_MAGIC 0x434c4f54u // "CLOT"
+#define SHM_VERSION 2u // the slots start on a cache line since 2
+#define SHM_CACHE_LINE 64 // bytes, the header and slots are multiples of it
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// Layout of the shared segment: one ShmHeader of SHM_CACHE_LINE bytes
+// followed by `slots` slots of `slot_size` bytes. Each slot is a ShmSlot
+// followed by the positions (3 * n * m floats, row major) and the face
+// states ((n-1) * (m-1) bytes).
+typedef struct ShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t n; // number of lines of the mesh
+  uint32_t m; // number of columns of the mesh
+  uint32_t slots;
+  uint32_t reserved;
+  uint64_t slot_size; // size in bytes of a slot, header included
+  _Atomic uint64_t head; // number of frames published so far
+  uint8_t pad[SHM_CACHE_LINE - 40]; // so that the first slot starts a line
+} ShmHeader;
+
+_Static_assert(sizeof(ShmHeader) == SHM_CACHE_LINE,
+               "the slots must start on a cache line");
+
+typedef struct ShmSlot {
+  _Atomic uint64_t seq; // seqlock counter, odd while the slot is written
+  uint64_t frame;       // index of the frame stored in the slot
+  uint32_t step;        // simulation update at which the frame was taken
+  uint32_t n_springs;   // number of non-break springs
+  float t;              // simulated time of the frame
+  uint32_t reserved;
+} ShmSlot;
+
+typedef struct ShmPublisher {
+  char name[SHM_NAME_MAX];
+  size_t size; // size of the mapping
+  ShmHeader *header;
+} ShmPublisher;
+
+typedef struct ShmReader {
+  size_t size;
+  const ShmHeader *header;
+} ShmReader;
+
+// A frame read in place from the shared segment. Pointers are valid until
+// shmEndRead is called and only meaningful if it returns true.
+typedef struct ShmFrameView {
+  uint64_t seq;
+  uint64_t frame;
+  uint32_t step;
+  uint32_t n_springs;
+  float t;
+  const float *positions;       // 3 * n * m floats
+  const unsigned char *faces;   // (n-1) * (m-1) face states, 1 if intact
+  const ShmSlot *slot;
+} ShmFrameView;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+size_t shmSegmentSize(unsigned int n, unsigned int m, unsigned int slots);
+ShmPublisher *shmOpenPublisher(const char *name, const Mesh *mesh,
+                               unsigned int slots);
+void shmPublishFrame(ShmPublisher *, const Mesh *, unsigned int step);
+void shmClosePublisher(ShmPublisher *);
+
+ShmReader *shmOpenReader(const char *name);
+uint64_t shmLatestFrame(const ShmReader *);
+bool shmBeginRead(const ShmReader *, uint64_t frame, ShmFrameView *);
+bool shmEndRead(const ShmFrameView *);
+void shmCloseReader(ShmReader *);
+
+#endif // !SHM_H
@@ -16,12 +16,15 @@
 #include "log.h"
 #include "params.h"
 #include "space.h"
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
 /************************************
  * MACROS AND DEFINES
  ************************************/
+#define SPRINGS_PER_FACE 8
+#define NO_SPRING MESH_INDEX_MAX // missing spring of a face
 
 /************************************
  * TYPEDEFS
@@ -45,9 +48,12 @@ typedef struct {
  ************************************/
 
 Spring newSpring(Point, Point, float);
-unsigned int numberOfSprings(unsigned int, unsigned int);
-void fillSprings(Spring *, unsigned int ***, unsigned int *spring_index, int i,
-                 int j, int n, int m);
+meshIndex numberOfSprings(unsigned int, unsigned int);
+void fillSprings(Spring *, meshIndex *face_springs, meshIndex *spring_index,
+                 int i, int j, int n, int m, const Params *);
+meshIndex firstSpringOf(unsigned int i, unsigned int j, unsigned int n,
+                        unsigned int m);
+unsigned int gridPointSprings(int i, int j, int n, int m, meshIndex *springs);
 Spring *getPossibleSprings(unsigned int, unsigned int, unsigned int,
-                           unsigned int, unsigned int *);
+                           unsigned int, unsigned int *, const Params *);
 #endif // !SPRING_H
\ No newline at end of file
@@ -0,0 +1,66 @@
+/**
+*************************************************************
+* @file     stencil.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Springs of the regular grid implied by a stencil of 6
+*           directions per point, only their damage and whether they are
+*           broken being stored, direction after direction.
+*************************************************************
+*/
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "space.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+// Structural (i+1, j) and (i, j+1), shear (i+1, j+1) and (i-1, j+1),
+// flexion (i+2, j) and (i, j+2), in the order of fillSprings
+#define STENCIL_DIRECTIONS 6
+
+// True if the spring of direction d leaving the point p is broken
+#define STENCIL_BROKEN(stencil, d, p)                                          \
+  (((stencil)->broken[(d) * (stencil)->words + (p) / 64] >> ((p) % 64)) & 1)
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// The spring (d, p) goes from the point p = i * m + j to the point
+// (i + STENCIL_OFFSET[d][0], j + STENCIL_OFFSET[d][1]) if it is in the grid.
+// Its number, as listed in Mesh.broken_springs, is d * n * m + p.
+typedef struct Stencil {
+  unsigned int n, m;
+  unsigned int words; // 64-bit words of the broken bits of a direction
+  float *damage;      // damage of the spring (d, p) at d * n * m + p
+  uint64_t *broken;   // bit p of broken[d * words ...] set once broken
+  Vector *force; // during an update, acceleration of p by its spring of the
+                 // direction being computed
+} Stencil;
+
+/************************************
+ * EXPORTED VARIABLES AND CONST
+ ************************************/
+
+extern const int STENCIL_OFFSET[STENCIL_DIRECTIONS][2];
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Stencil *newStencil(unsigned int n, unsigned int m);
+bool stencilHasSpring(const Stencil *, unsigned int d, int i, int j);
+float stencilStiffness(const Params *, unsigned int d);
+void stencilBreak(Stencil *, unsigned int d, unsigned int p);
+void freeStencil(Stencil *);
+
+#endif // !STENCIL_H
@@ -0,0 +1,68 @@
+/**
+*************************************************************
+* @file     surface.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Unstructured meshes of triangles and quads read from OBJ
+*           files, their springs, and the reordering of their points for
+*           the locality of the update loops.
+*************************************************************
+*/
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "space.h"
+#include "spring.h"
+#include <limits.h>
+#include <stdbool.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+// Fourth point of a triangle
+#define SURFACE_NONE UINT_MAX
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef enum {
+  REORDER_NONE,   // the order of the file
+  REORDER_MORTON, // along the Z-order curve of the initial positions
+  REORDER_RCM,    // reverse Cuthill-McKee of the edges, the default
+} reorderPolicy;
+
+// The points are numbered from 0 to n_points - 1, and are the line 0 of the
+// Mesh (n = 1, m = n_points). The springs of the edges are the structural
+// ones, the diagonals of the quads the shear ones, and the springs between
+// the points on each side of an edge shared by two faces the flexion ones.
+typedef struct Surface {
+  unsigned int n_points;
+  unsigned int n_faces;
+  unsigned int (*faces)[4];        // points of a face, in the file order
+  unsigned int *point_faces_start; // faces of the point p are point_faces
+  unsigned int *point_faces;       // [point_faces_start[p] .. [p + 1]]
+  bool *fixed;                     // the highest points, which do not move
+} Surface;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Surface *readObj(const char *filename, Vector **points);
+bool parseReorderPolicy(const char *name, reorderPolicy *policy);
+const char *reorderPolicyName(reorderPolicy);
+void reorderSurface(Surface *, Vector *points, reorderPolicy);
+void linkSurfaceFaces(Surface *);
+meshIndex surfaceSprings(const Surface *, const Params *, Spring **springs,
+                         meshIndex **face_springs);
+unsigned int faceSize(const Surface *, unsigned int face);
+Vector surfaceNormal(const Surface *, const Vector *points, unsigned int p);
+void freeSurface(Surface *);
+
+#endif // !SURFACE_H
@@ -0,0 +1,66 @@
+/**
+*************************************************************
+* @file     sweep.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Run a grid of independent simulations in one process, one
+*           simulation per thread.
+*************************************************************
+*/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "mesh.h"
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define SWEEP_MAX_AXES 16
+#define SWEEP_MAX_VALUES 256
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// One parameter of Params and the values it takes in the sweep
+typedef struct SweepAxis {
+  const ParamInfo *param;
+  unsigned int n_values;
+  float values[SWEEP_MAX_VALUES];
+} SweepAxis;
+
+// The cartesian product of the axes applied on top of the params of a type
+typedef struct Sweep {
+  meshType type;
+  Params base; // default params adjusted for the type
+  unsigned int n_axes;
+  SweepAxis axes[SWEEP_MAX_AXES];
+} Sweep;
+
+// Summary of one simulation of the sweep
+typedef struct SweepResult {
+  meshIndex broken_springs;
+  meshIndex broken_faces;
+  float kinetic_energy;   // at the end of the simulation
+  float max_displacement; // largest distance between P and P0
+  float min_y, max_y;     // vertical extent of the cloth
+  double elapsed;         // wall time of the simulation in seconds
+  int thread;             // thread which ran the simulation
+} SweepResult;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+void initSweep(Sweep *, meshType);
+int addSweepAxis(Sweep *, const char *name, const char *values);
+unsigned int sweepSize(const Sweep *);
+Params sweepParams(const Sweep *, unsigned int index);
+int runSimulation(const Sweep *, unsigned int index, SweepResult *);
+int runSweep(const Sweep *, const char *output_filename);
+
+#endif // !SWEEP_H
@@ -0,0 +1,85 @@
+/**
+*************************************************************
+* @file     temporal.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Temporal blocking of the deterministic update: each tile of the
+*           grid is advanced several updates while it is in the cache, from
+*           a copy of the tile and of a halo shrinking at each update.
+*************************************************************
+*/
+
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "params.h"
+#include "space.h"
+#include <stdbool.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+// Points around a region reached by an update, the flexion springs span 2
+#define TEMPORAL_HALO 2
+#define TEMPORAL_MAX_SPRINGS 6 // springs whose ext_1 is a point of a grid
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// Points [i0, i1) x [j0, j1) of the grid
+typedef struct Region {
+  unsigned int i0, i1, j0, j1;
+} Region;
+
+// The tile t = ti * cols + tj holds the points [ti * size, (ti + 1) * size)
+// x [tj * size, (tj + 1) * size) and owns the springs whose ext_1 is one of
+// them. Advancing a tile `steps` updates reads the points up to
+// steps * TEMPORAL_HALO around it, so the tiles are advanced from the state
+// at the start of the block and their results kept apart until all of them
+// are done.
+typedef struct TemporalBlocking {
+  unsigned int steps;      // updates of a block, at most
+  unsigned int size;       // points on a side of a tile
+  unsigned int rows, cols; // number of tiles along i and j
+  Vector **P, **V;         // positions and velocities at the end of a block
+  float *damage;           // of every spring at the end of a block
+  bool *broken;            // state of every spring at the end of a block
+  meshIndex *broken_at;    // springs broken by each update of a block
+} TemporalBlocking;
+
+// Copy of the region a thread advances: the positions and velocities, seen
+// through rows indexed by the lines and columns of the grid, and the damage,
+// state and force of the springs whose ext_1 is in it. The springs of the
+// line i are those from first[r] on, r = i - region.i0, and the spring k of
+// this line is at offset[r] + k - first[r].
+typedef struct TemporalScratch {
+  Region region;
+  Vector *positions, *velocities; // the rows, after m unused points
+  Vector **P, **V;                // n rows, those of the region set
+  float *damage;
+  bool *broken;
+  Vector *forces; // acceleration given to ext_1 by the current update
+  meshIndex *first, *offset;
+} TemporalScratch;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+TemporalBlocking *newTemporalBlocking(unsigned int n, unsigned int m,
+                                      meshIndex n_springs, unsigned int steps,
+                                      unsigned int size);
+Region tileRegion(const TemporalBlocking *, unsigned int tile,
+                  unsigned int halo, unsigned int n, unsigned int m);
+TemporalScratch *newTemporalScratch(const TemporalBlocking *, unsigned int n,
+                                    unsigned int m);
+void setScratchRegion(TemporalScratch *, Region, unsigned int n,
+                      unsigned int m);
+void freeTemporalScratch(TemporalScratch *);
+void freeTemporalBlocking(TemporalBlocking *, unsigned int n);
+
+#endif // !TEMPORAL_H
@@ -0,0 +1,52 @@
+/**
+*************************************************************
+* @file     tile.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Decomposition of the grid in square tiles, each one with the
+*           springs anchored in it and a buffer of accelerations covering
+*           the tile and a halo around it.
+*************************************************************
+*/
+
+#ifndef TILE_H
+#define TILE_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include "space.h"
+#include "spring.h"
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+// Points around a tile reached by its springs, the flexion springs span 2
+#define TILE_HALO 2
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+// The tile (ti, tj), number t = ti * cols + tj, holds the points
+// [ti * size, (ti + 1) * size) x [tj * size, (tj + 1) * size) of the grid
+// and the springs whose ext_1 is one of them.
+typedef struct Tiling {
+  unsigned int size;       // points on a side of a tile
+  unsigned int rows, cols; // number of tiles along i and j
+  unsigned int pitch;      // size + 2 * TILE_HALO, side of a buffer
+  meshIndex *springs_start; // springs of tile t from springs_start[t]
+  meshIndex *springs;       // to springs_start[t + 1], increasing
+  Vector *acc; // pitch * pitch accelerations per tile, halo included
+} Tiling;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Tiling *newTiling(const Spring *springs, meshIndex n_springs,
+                  unsigned int n, unsigned int m, unsigned int size);
+Vector *tileBuffer(const Tiling *, unsigned int tile);
+void freeTiling(Tiling *);
+
+#endif // !TILE_H
@@ -0,0 +1,52 @@
+/**
+*************************************************************
+* @file     topology.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    NUMA nodes and CPUs of the machine, read from sysfs, pinning of
+*           the OpenMP threads to them and report of where they run.
+*************************************************************
+*/
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include <stdbool.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define TOPOLOGY_MAX_CPUS 1024
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef enum {
+  PIN_NONE,    // the threads may migrate, the default
+  PIN_COMPACT, // thread t on the t-th CPU, filling a node before the next
+  PIN_SPREAD,  // threads dealt to the nodes in turn
+} pinPolicy;
+
+// CPUs the process may run on, in increasing order, with their node
+typedef struct Topology {
+  int n_nodes;
+  int n_cpus;
+  int cpus[TOPOLOGY_MAX_CPUS];
+  int cpu_node[TOPOLOGY_MAX_CPUS]; // node of cpus[k]
+} Topology;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+void readTopology(Topology *);
+bool parsePinPolicy(const char *name, pinPolicy *policy);
+const char *pinPolicyName(pinPolicy);
+int pinThreads(const Topology *, pinPolicy);
+void logTopology(const Topology *, pinPolicy);
+
+#endif // !TOPOLOGY_H
@@ -0,0 +1,99 @@
+/**
+*************************************************************
+* @file     trace.h
+* @author   WATCHO KEUGONG Gabby Pavel, gwathok@etu.utc.fr
+* @date     19/10/2026
+* @brief    Binary trace of the solver events (spring breaks, normal
+*           failures, step boundaries), recorded in per-thread lock-free
+*           ring buffers and written to a file by a background thread.
+*************************************************************
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/************************************
+ * INCLUDES
+ ************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/************************************
+ * MACROS AND DEFINES
+ ************************************/
+#define TRACE_MAGIC "CLTRACE1"
+#define TRACE_VERSION 2 // a and b on 64 bits since 2
+// Events kept per thread until the writer catches up, a power of two
+#define TRACE_RING_SIZE 16384
+
+// The events cost one test when the mesh has no trace attached
+#define TRACE_EVENT(trace, type, a, b, x, y)                                   \
+  do {                                                                         \
+    if ((trace) != NULL)                                                       \
+      traceEvent((trace), (type), (a), (b), (x), (y));                         \
+  } while (0)
+
+/************************************
+ * TYPEDEFS
+ ************************************/
+
+typedef enum {
+  TRACE_STEP_BEGIN,     // a: update, b: springs intact
+  TRACE_STEP_END,       // a: update, b: springs intact
+  TRACE_SPRING_BREAK,   // a: spring, x: energy, y: damage
+  TRACE_NORMAL_FAILURE, // a: line, b: column, x: number of springs around
+  TRACE_TYPE_COUNT
+} traceType;
+
+// One event as written in the file, after the header
+typedef struct TraceEvent {
+  uint64_t time;   // nanoseconds since the trace was opened
+  uint32_t type;   // traceType
+  uint32_t thread; // OpenMP thread number
+  uint64_t a, b;   // integer arguments, see traceType, wide as a meshIndex
+  float x, y;      // real arguments, see traceType
+} TraceEvent;
+
+// Header of a trace file
+typedef struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t event_size; // sizeof(TraceEvent)
+  uint64_t start;      // CLOCK_REALTIME of the opening, in nanoseconds
+} TraceHeader;
+
+// Events of one thread, written by this thread only and read by the writer.
+// Each index has its own cache line.
+typedef struct TraceRing {
+  _Alignas(64) atomic_uint_fast64_t head; // next event written
+  _Alignas(64) atomic_uint_fast64_t tail; // next event read
+  _Alignas(64) atomic_uint_fast64_t dropped; // events lost on a full ring
+  TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+
+typedef struct Trace {
+  FILE *file;
+  uint64_t origin; // CLOCK_MONOTONIC of the opening, in nanoseconds
+  TraceRing *rings;
+  int n_rings; // one per thread
+  uint32_t step; // current update, for the step events
+  pthread_t writer;
+  atomic_bool stop;
+  uint64_t written;
+} Trace;
+
+/************************************
+ * GLOBAL FUNCTION PROTOTYPES
+ ************************************/
+
+Trace *openTrace(const char *filename, int n_threads);
+void traceEvent(Trace *, traceType, uint64_t a, uint64_t b, float x, float y);
+void traceStepBegin(Trace *, uint64_t springs);
+void traceStepEnd(Trace *, uint64_t springs);
+void closeTrace(Trace *);
+const char *traceTypeName(traceType);
+
+#endif // !TRACE_H
@@ -12,6 +12,9 @@
 
 #include "log.h"
 #include "mesh.h"
+#include "render.h"
+#include "shm.h"
+#include "topology.h"
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -25,6 +28,57 @@
 #define MKDIR(path) mkdir(path, 0755)
 #endif
 
+#define MAX_BODIES 16 // bodies of a scene, see --body
+#define PREVIEW_RATE 4 // previews per frame by default, see --preview
+
+// Longest text of a coordinate in a VTK file, that of -FLT_MAX
+#define VTK_FLOAT_TEXT 48
+// Rows of a VTK file formatted by a thread at once
+#define VTK_BLOCK_ROWS 4096
+
+typedef enum {
+  SINK_VTK,  // Poly and grid VTK files on disk
+  SINK_SHM,  // Shared-memory ring buffer of the latest frames
+  SINK_IMAGE, // Images of the mesh rendered in the simulation
+  SINK_NONE, // No output at all
+} outputSink;
+
+// Options of the application given after the mesh type
+typedef struct Options {
+  outputSink sink;
+  float output_tolerance;  // displacement, in spacings, which makes a frame
+                           // due, 0 for a frame every STEP updates
+  unsigned int output_min; // updates between two frames, at least
+  unsigned int output_max; // at most, 0 for OUTPUT_MAX_STEPS * STEP
+  const char *shm_name;   // name of the shared-memory segment
+  unsigned int shm_slots; // number of frames kept in the ring buffer
+  Camera camera;          // of the image frames
+  colorMode color;        // of the faces in the image frames
+  imageFormat format;     // of the image frames
+  const char *profile;    // report of the phase timers, NULL if not timed
+  bool deterministic;     // results independent of the number of threads
+  unsigned int tile_size; // points on a side of a tile, 0 for no tiles
+  bool stencil;           // springs implied by the grid
+  const char *obj;        // mesh imported from an OBJ file, NULL for a grid
+  reorderPolicy reorder;  // order of the points of an imported mesh
+  unsigned int refine;    // times a face can be split, 0 for a fixed grid
+  pinPolicy pin;           // placement of the threads on the CPUs
+  const char *diagnostics; // per-update time series, NULL if not computed
+  float stop_at_rest;      // stop once the kinetic energy is below, if > 0
+  float stop_broken;       // stop once this fraction of springs broke, if > 0
+  const char *trace;       // binary trace of the solver events, NULL if none
+  unsigned int n_bodies;   // bodies added to the mesh type, 0 for no scene
+  meshType body_types[MAX_BODIES];
+  Vector body_offsets[MAX_BODIES]; // position of each body in the scene
+  unsigned int lines, columns; // of the grid, 0 for those of the mesh type
+  unsigned int preview;      // every k-th line and column, 0 for no preview
+  unsigned int preview_step; // updates between two previews, 0 for STEP /
+                             // PREVIEW_RATE
+  unsigned int temporal;      // updates advanced at once, 0 for one by one
+  unsigned int temporal_tile; // points on a side of their tiles, 0 for
+                              // params.TEMPORAL_TILE
+} Options;
+
 /**
  * @brief Creates a directory if it does not exist.
  *
@@ -42,8 +96,29 @@ int createDirectory(const char *path);
  */
 meshType parseArguments(int argc, char *argv[]);
 
+/**
+ * @brief Reads a mesh type from its name, as given on the command line.
+ *
+ * @param name Name of the type, curtain, table-cloth, soft or flag.
+ * @param type Set to the type if the name is known.
+ * @return true if the name is known, false otherwise.
+ */
+bool parseMeshType(const char *name, meshType *type);
+
+/**
+ * @brief Parses the options following the mesh type, as --name or
+ * --name=value.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Filled with the defaults, then with the given options.
+ */
+void parseOptions(int argc, char *argv[], Options *options);
+
 const char *getTypeName(meshType type);
 void convertMeshToPolyVTK(const Mesh *mesh, const char *output_filename);
+void convertMeshToPreviewVTK(const Mesh *mesh, unsigned int k,
+                             const char *output_filename);
 void convertMeshToGridVTK(const Mesh *mesh, const char *output_filename);
 
 #endif // UTILS_H
@@ -0,0 +1,143 @@
+#include "../include/alloc.h"
+#include "../include/log.h"
+#include <inttypes.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// This file calls the allocator itself
+#undef malloc
+#undef calloc
+#undef realloc
+#undef aligned_alloc
+#undef free
+
+// Allocations of a call site, the last entry of the table counting those of
+// the sites which did not fit
+typedef struct AllocSite {
+  const char *file; // NULL for a free entry
+  int line;
+  uint64_t calls, bytes;
+} AllocSite;
+
+static AllocSite sites[ALLOC_MAX_SITES + 1];
+static uint64_t frees;
+
+/**
+ * Count an allocation of size bytes at file:line. The sites are hashed on
+ * their line, with linear probing.
+ */
+static void countAllocation(size_t size, const char *file, int line) {
+#pragma omp critical(alloc_sites)
+  {
+    AllocSite *site = &sites[ALLOC_MAX_SITES];
+    for (unsigned int k = 0; k < ALLOC_MAX_SITES; k++) {
+      AllocSite *s = &sites[((unsigned int)line + k) % ALLOC_MAX_SITES];
+      if (s->file == NULL) {
+        s->file = file;
+        s->line = line;
+      }
+      if (s->line == line && (s->file == file || strcmp(s->file, file) == 0)) {
+        site = s;
+        break;
+      }
+    }
+    site->calls++;
+    site->bytes += size;
+  }
+}
+
+void *countedMalloc(size_t size, const char *file, int line) {
+  countAllocation(size, file, line);
+  return malloc(size);
+}
+
+void *countedCalloc(size_t n, size_t size, const char *file, int line) {
+  countAllocation(n * size, file, line);
+  return calloc(n, size);
+}
+
+void *countedRealloc(void *pointer, size_t size, const char *file, int line) {
+  countAllocation(size, file, line);
+  return realloc(pointer, size);
+}
+
+void *countedAlignedAlloc(size_t alignment, size_t size, const char *file,
+                          int line) {
+  countAllocation(size, file, line);
+  return aligned_alloc(alignment, size);
+}
+
+void countedFree(void *pointer) {
+  if (pointer != NULL) {
+#pragma omp atomic
+    frees++;
+  }
+  free(pointer);
+}
+
+/**
+ * Return true if the allocations are counted, see COUNT_ALLOCS
+ */
+bool allocCounted(void) { return COUNT_ALLOCS != 0; }
+
+/**
+ * Allocations of every call site so far
+ */
+AllocTotals allocTotals(void) {
+  AllocTotals totals = {0, 0, 0};
+#pragma omp critical(alloc_sites)
+  {
+    for (unsigned int k = 0; k <= ALLOC_MAX_SITES; k++) {
+      totals.calls += sites[k].calls;
+      totals.bytes += sites[k].bytes;
+    }
+  }
+#pragma omp atomic read
+  totals.frees = frees;
+  return totals;
+}
+
+/**
+ * Largest resident size of the process so far, in KiB, -1 if unknown
+ */
+long peakResidentKiB(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+  return usage.ru_maxrss;
+}
+
+static int compareSiteCalls(const void *a, const void *b) {
+  const AllocSite *x = a, *y = b;
+  return (x->calls < y->calls) - (x->calls > y->calls);
+}
+
+/**
+ * Log the totals, the peak resident size and the call sites allocating the
+ * most, with their calls per update over steps updates
+ */
+void logAllocations(unsigned int steps) {
+  AllocTotals totals = allocTotals();
+  log_info("Allocations: %" PRIu64 " calls, %" PRIu64 " bytes, %" PRIu64
+           " frees, peak resident size %ld KiB",
+           totals.calls, totals.bytes, totals.frees, peakResidentKiB());
+
+  AllocSite sorted[ALLOC_MAX_SITES + 1];
+  unsigned int count = 0;
+#pragma omp critical(alloc_sites)
+  {
+    for (unsigned int k = 0; k <= ALLOC_MAX_SITES; k++) {
+      if (sites[k].calls > 0)
+        sorted[count++] = sites[k];
+    }
+  }
+  qsort(sorted, count, sizeof(AllocSite), compareSiteCalls);
+  for (unsigned int k = 0; k < count && k < ALLOC_REPORT_SITES; k++) {
+    log_info("  %s:%d: %" PRIu64 " calls (%.2f per update), %" PRIu64
+             " bytes",
+             sorted[k].file != NULL ? sorted[k].file : "other",
+             sorted[k].line, sorted[k].calls,
+             steps > 0 ? (double)sorted[k].calls / steps : 0.0,
+             sorted[k].bytes);
+  }
+}
@@ -0,0 +1,272 @@
+#include "../include/budget.h"
+#include "../include/log.h"
+#include "../include/mesh.h"
+#include "../include/refine.h"
+#include "../include/spring.h"
+#include "../include/stencil.h"
+#include "../include/temporal.h"
+#include "../include/tile.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <zlib.h>
+
+void initMemoryBudget(MemoryBudget *budget) {
+  budget->state = 0;
+  budget->springs = 0;
+  budget->scratch = 0;
+  budget->output = 0;
+  budget->n = 0;
+  budget->m = 0;
+  budget->n_springs = 0;
+  budget->n_faces = 0;
+}
+
+/**
+ * Threads updating a mesh of these points, see params.PARALLEL_THRESHOLD
+ */
+static size_t updateThreads(const Params *params, uint64_t points) {
+  return points >= params->PARALLEL_THRESHOLD ? omp_get_max_threads() : 1;
+}
+
+/**
+ * Same as getMatrix(n, m)
+ */
+static size_t matrixBytes(uint64_t n, uint64_t m) {
+  return n * sizeof(Vector *) + n * m * sizeof(Vector);
+}
+
+/**
+ * Lists of the springs of the points and forces of the springs of the
+ * deterministic mode, see listPointSprings
+ */
+static size_t pointSpringsBytes(uint64_t points, uint64_t springs) {
+  return (points + 1 + 2 * springs) * sizeof(meshIndex) +
+         springs * sizeof(Vector);
+}
+
+/**
+ * Add the grid of n lines and m columns of params, as built by initMesh.
+ * Return false if its points can not be numbered.
+ */
+static bool addGrid(MemoryBudget *budget, const Params *params,
+                    unsigned int n, unsigned int m) {
+  const uint64_t points = (uint64_t)n * m;
+  if (!checkMeshIndices(points))
+    return false;
+  const uint64_t springs = numberOfSprings(n, m);
+  const uint64_t faces = (uint64_t)(n - 1) * (m - 1);
+
+  budget->state += 3 * matrixBytes(n, m);
+  budget->springs += springs * sizeof(meshIndex) + // broken_springs
+                     (faces / 64 + 1) * sizeof(uint64_t);
+  if (params->STENCIL) {
+    uint64_t words = (points + 63) / 64;
+    budget->springs += STENCIL_DIRECTIONS * points * sizeof(float) +
+                       STENCIL_DIRECTIONS * words * sizeof(uint64_t);
+    budget->scratch += points * sizeof(Vector);
+  } else {
+    budget->springs += springs * sizeof(Spring) +
+                       faces * SPRINGS_PER_FACE * sizeof(meshIndex) +
+                       2 * springs * sizeof(meshIndex); // spring_faces
+  }
+
+  // One acceleration matrix per update, and one per thread of the team
+  size_t threads = updateThreads(params, points);
+  budget->scratch += (threads > 1 ? threads + 1 : 1) * matrixBytes(n, m);
+  if (params->DETERMINISTIC && !params->STENCIL)
+    budget->scratch += pointSpringsBytes(points, springs);
+  if (params->TILE_SIZE > 0) {
+    uint64_t size = params->TILE_SIZE, pitch = size + 2 * TILE_HALO;
+    uint64_t tiles = ((n + size - 1) / size) * ((m + size - 1) / size);
+    budget->scratch += (springs + tiles + 1) * sizeof(meshIndex) +
+                       tiles * pitch * pitch * sizeof(Vector);
+  }
+  if (params->TEMPORAL_STEPS > 1) {
+    // The state at the end of a block, and the copy of a tile and its halo
+    // for each thread, see newTemporalScratch
+    uint64_t side = params->TEMPORAL_TILE +
+                    2 * TEMPORAL_HALO * (uint64_t)params->TEMPORAL_STEPS;
+    uint64_t copied = (side < n ? side : n) * (side < m ? side : m);
+    budget->scratch +=
+        2 * matrixBytes(n, m) + springs * (sizeof(float) + sizeof(bool)) +
+        params->TEMPORAL_STEPS * sizeof(meshIndex) +
+        threads * (2 * (m + copied) * sizeof(Vector) +
+                   TEMPORAL_MAX_SPRINGS * copied *
+                       (sizeof(float) + sizeof(bool) + sizeof(Vector)));
+  }
+
+  budget->n_springs += springs;
+  budget->n_faces += faces;
+  return true;
+}
+
+/**
+ * Add the faces of a mesh whose points are the line 0, see Surface: the
+ * corners of every face and the faces of every corner, the fixed points and
+ * the masses
+ */
+static void addSurface(MemoryBudget *budget, uint64_t points) {
+  budget->springs += 2 * budget->n_faces * 4 * sizeof(unsigned int) +
+                     (points + 1) * sizeof(unsigned int) +
+                     points * (sizeof(bool) + sizeof(float));
+}
+
+/**
+ * Memory of the grid of params, as built by initMesh. Return false if its
+ * points can not be numbered.
+ */
+bool budgetGrid(MemoryBudget *budget, const Params *params) {
+  budget->n = params->N;
+  budget->m = params->M;
+  return addGrid(budget, params, params->N, params->M);
+}
+
+/**
+ * Memory of a scene of the grids of params[b], see initMeshScene: each body
+ * keeps its grid and springs, and the scene a copy of them. Return false if
+ * their points can not be numbered.
+ */
+bool budgetScene(MemoryBudget *budget, unsigned int n_bodies,
+                 const Params *params) {
+  uint64_t points = 0;
+  for (unsigned int b = 0; b < n_bodies; b++) {
+    points += (uint64_t)params[b].N * params[b].M;
+  }
+  if (!checkMeshIndices(points))
+    return false;
+  for (unsigned int b = 0; b < n_bodies; b++) {
+    if (!addGrid(budget, &params[b], params[b].N, params[b].M))
+      return false;
+  }
+  budget->springs *= 2;
+  budget->scratch += (points + 1) * sizeof(unsigned int); // point_body
+  if (params[0].DETERMINISTIC)
+    budget->scratch += pointSpringsBytes(points, budget->n_springs);
+  addSurface(budget, points);
+  budget->n = 1;
+  budget->m = points;
+  return true;
+}
+
+/**
+ * Upper bound of the memory of a refined grid, whose faces are at most all
+ * split to the finest level of the lattice, see initMeshAdaptive. The
+ * springs are built from candidates twice as many as them. Return false if
+ * the points of the lattice can not be numbered.
+ */
+bool budgetRefinedGrid(MemoryBudget *budget, const Params *params) {
+  const unsigned int levels = params->REFINE_LEVELS;
+  const uint64_t n = ((uint64_t)(params->N - 1) << levels) + 1;
+  const uint64_t m = ((uint64_t)(params->M - 1) << levels) + 1;
+  if (!checkMeshIndices(n * m) || !addGrid(budget, params, n, m))
+    return false;
+  budget->scratch += 2 * budget->n_springs * sizeof(Spring) + // candidates
+                     n * m * sizeof(unsigned int) +           // point_of
+                     2 * budget->n_faces * sizeof(Leaf) +     // and old ones
+                     2 * n * m * sizeof(unsigned int);        // points
+  addSurface(budget, n * m);
+  budget->n = 1;
+  budget->m = n * m;
+  return true;
+}
+
+/**
+ * Text of a frame in VTK files: the poly then the grid file are formatted
+ * in memory one after the other, see convertMeshToPolyVTK and
+ * convertMeshToGridVTK
+ */
+static size_t vtkBytes(const MemoryBudget *budget) {
+  const uint64_t points = (uint64_t)budget->n * budget->m;
+  size_t digits = 1;
+  for (uint64_t k = points; k >= 10; k /= 10)
+    digits++;
+  size_t coordinates = points * (3 * BUDGET_COORDINATE_TEXT + 3);
+  size_t poly = coordinates + budget->n_springs * (4 + 2 * digits);
+  size_t grid = coordinates + budget->n_faces * (2 + 4 * (digits + 1) + 4);
+  return poly > grid ? poly : grid;
+}
+
+/**
+ * Add the buffers of the frames of the sink of options
+ */
+static void budgetOutput(MemoryBudget *budget, const Options *options) {
+  const uint64_t points = (uint64_t)budget->n * budget->m;
+  switch (options->sink) {
+  case SINK_VTK:
+    // The memory stream may hold its old and new buffer while it grows
+    budget->output += 2 * vtkBytes(budget) +
+                      (size_t)omp_get_max_threads() * VTK_BLOCK_ROWS * 3 *
+                          VTK_FLOAT_TEXT;
+    break;
+  case SINK_SHM:
+    budget->output +=
+        shmSegmentSize(budget->n, budget->m, options->shm_slots);
+    break;
+  case SINK_IMAGE: {
+    size_t pixels = (size_t)options->camera.width * options->camera.height;
+    size_t rows = pixels * 3 + options->camera.height; // filtered PNG rows
+    budget->output += pixels * (3 + sizeof(float)) +
+                      points * (sizeof(Vector) + sizeof(float)) +
+                      budget->n_faces * 3 * sizeof(float) + rows +
+                      compressBound(rows);
+    break;
+  }
+  case SINK_NONE:
+    break;
+  }
+  if (options->preview > 0) {
+    // A preview holds about one point and face in k * k of the grid
+    uint64_t k2 = (uint64_t)options->preview * options->preview;
+    budget->output += 2 * vtkBytes(budget) / k2 +
+                      (size_t)omp_get_max_threads() * VTK_BLOCK_ROWS * 3 *
+                          VTK_FLOAT_TEXT;
+  }
+  if (options->output_tolerance > 0.0f)
+    budget->output += points * sizeof(Vector); // positions at the last frame
+}
+
+/**
+ * Bytes of memory available to the process, from MemAvailable in
+ * /proc/meminfo, else the free pages
+ */
+size_t availableMemory(void) {
+  FILE *file = fopen("/proc/meminfo", "r");
+  if (file != NULL) {
+    char line[256];
+    unsigned long long kib;
+    while (fgets(line, sizeof(line), file) != NULL) {
+      if (sscanf(line, "MemAvailable: %llu kB", &kib) == 1) {
+        fclose(file);
+        return (size_t)kib * 1024;
+      }
+    }
+    fclose(file);
+  }
+  return (size_t)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+static double mebibytes(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+/**
+ * Add the frames of options to the budget and report it. Return false if it
+ * does not fit in the memory available.
+ */
+bool checkMemoryBudget(MemoryBudget *budget, const Options *options) {
+  budgetOutput(budget, options);
+  size_t total =
+      budget->state + budget->springs + budget->scratch + budget->output;
+  size_t available = availableMemory();
+  log_info("Memory budget: %.1f MiB (state %.1f, springs %.1f, scratch "
+           "%.1f, output %.1f) of %.1f MiB available",
+           mebibytes(total), mebibytes(budget->state),
+           mebibytes(budget->springs), mebibytes(budget->scratch),
+           mebibytes(budget->output), mebibytes(available));
+  if (total > available) {
+    log_error("The mesh needs %.1f MiB, more than the %.1f MiB available",
+              mebibytes(total), mebibytes(available));
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,141 @@
+#include "../include/cloth.h"
+
+struct Cloth {
+  meshType type;
+  Mesh *mesh;
+  unsigned int step; // number of updates done
+
+  clothBreakCallback on_break;
+  void *break_data;
+  clothFrameCallback on_frame;
+  void *frame_data;
+};
+
+/**
+ * Return a simulation of the given type, NULL if its mesh can not be built
+ */
+Cloth *clothCreate(meshType type, const Params *params) {
+  Params defaults = defaultParams();
+  if (params == NULL) {
+    customs_params(&defaults, type);
+    params = &defaults;
+  }
+  if (!checkGridParams(type, params))
+    return NULL;
+
+  Cloth *cloth = (Cloth *)calloc(1, sizeof(Cloth));
+  cloth->type = type;
+  cloth->mesh = (Mesh *)malloc(sizeof(Mesh));
+  if (initMesh(cloth->mesh, type, params) != 0) {
+    free(cloth->mesh);
+    free(cloth);
+    return NULL;
+  }
+  return cloth;
+}
+
+/**
+ * Set a param of the simulation, rebuilding the mesh if needed
+ */
+int clothSetParam(Cloth *cloth, const char *name, float value) {
+  const ParamInfo *info = findParam(name);
+  if (info == NULL) {
+    log_error("Unknown param %s", name);
+    return -1;
+  }
+
+  if (!info->isTopology) {
+    setParam(&cloth->mesh->params, info, value);
+    return 0;
+  }
+
+  if (cloth->step > 0) {
+    log_error("Param %s cannot change once the simulation started", name);
+    return -1;
+  }
+
+  // The mesh is kept if the new one can not be built
+  Params params = cloth->mesh->params;
+  setParam(&params, info, value);
+  if (!checkGridParams(cloth->type, &params))
+    return -1;
+  Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
+  if (initMesh(mesh, cloth->type, &params) != 0) {
+    free(mesh);
+    return -1;
+  }
+  freeMesh(cloth->mesh);
+  cloth->mesh = mesh;
+  return 0;
+}
+
+const Params *clothGetParams(const Cloth *cloth) {
+  return &cloth->mesh->params;
+}
+
+void clothOnBreak(Cloth *cloth, clothBreakCallback callback,
+                  void *user_data) {
+  cloth->on_break = callback;
+  cloth->break_data = user_data;
+}
+
+void clothOnFrame(Cloth *cloth, clothFrameCallback callback,
+                  void *user_data) {
+  cloth->on_frame = callback;
+  cloth->frame_data = user_data;
+}
+
+/**
+ * Run n updates, the callbacks are called between two updates so they can
+ * read the state
+ */
+void clothStep(Cloth *cloth, unsigned int n) {
+  Mesh *mesh = cloth->mesh;
+
+  for (unsigned int k = 0; k < n; k++) {
+    updatePosition(mesh, mesh->params.DELTA_T, cloth->type);
+    cloth->step++;
+
+    if (cloth->on_break != NULL) {
+      for (meshIndex b = 0; b < mesh->n_broken; b++) {
+        cloth->on_break(cloth, mesh->broken_springs[b], cloth->break_data);
+      }
+    }
+
+    if (cloth->on_frame != NULL && mesh->params.STEP > 0 &&
+        cloth->step % mesh->params.STEP == 0) {
+      cloth->on_frame(cloth, cloth->step, cloth->frame_data);
+    }
+  }
+}
+
+unsigned int clothStepCount(const Cloth *cloth) { return cloth->step; }
+
+const Mesh *clothMesh(const Cloth *cloth) { return cloth->mesh; }
+
+const Vector *clothPositions(const Cloth *cloth, unsigned int *n,
+                             unsigned int *m) {
+  if (n != NULL)
+    *n = cloth->mesh->n;
+  if (m != NULL)
+    *m = cloth->mesh->m;
+  return cloth->mesh->P[0];
+}
+
+const Vector *clothVelocities(const Cloth *cloth) { return cloth->mesh->V[0]; }
+
+const Spring *clothSprings(const Cloth *cloth, meshIndex *count) {
+  if (count != NULL)
+    *count = cloth->mesh->springs == NULL ? 0 : cloth->mesh->total_springs;
+  return cloth->mesh->springs;
+}
+
+/**
+ * Free the simulation and its mesh
+ */
+void clothDestroy(Cloth *cloth) {
+  if (cloth == NULL)
+    return;
+  freeMesh(cloth->mesh);
+  free(cloth);
+}
@@ -0,0 +1,50 @@
+#include "../include/diagnostics.h"
+#include <stdlib.h>
+
+/**
+ * Return zeroed diagnostics
+ */
+Diagnostics *newDiagnostics(void) {
+  return (Diagnostics *)calloc(1, sizeof(Diagnostics));
+}
+
+/**
+ * Bin of the damage histogram of a spring
+ */
+unsigned int damageBin(float damage, float threshold) {
+  float ratio = damage / threshold;
+  if (!(ratio > 0.0f)) // negative damage, or NaN
+    return 0;
+  if (ratio >= 1.0f)
+    return DIAG_DAMAGE_BINS - 1;
+  return (unsigned int)(ratio * DIAG_DAMAGE_BINS);
+}
+
+/**
+ * Write the CSV header of the time series
+ */
+void writeDiagnosticsHeader(FILE *file) {
+  fprintf(file, "step,t,kinetic_energy,potential_energy,max_strain,"
+                "broken_springs,min_x,min_y,min_z,max_x,max_y,max_z");
+  for (int k = 0; k < DIAG_DAMAGE_BINS; k++) {
+    fprintf(file, ",damage_%d", k);
+  }
+  fprintf(file, "\n");
+}
+
+/**
+ * Write one line of the time series, for the state after the update `step`
+ */
+void writeDiagnostics(FILE *file, unsigned int step, float t,
+                      const Diagnostics *diag) {
+  fprintf(file,
+          "%u,%g,%.7g,%.7g,%.6g,%" PRI_MESH_INDEX
+          ",%.6g,%.6g,%.6g,%.6g,%.6g,%.6g",
+          step, t, diag->kinetic_energy, diag->potential_energy,
+          diag->max_strain, diag->broken_springs, diag->min.x, diag->min.y,
+          diag->min.z, diag->max.x, diag->max.y, diag->max.z);
+  for (int k = 0; k < DIAG_DAMAGE_BINS; k++) {
+    fprintf(file, ",%" PRI_MESH_INDEX, diag->damage_histogram[k]);
+  }
+  fprintf(file, "\n");
+}
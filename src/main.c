@@ -1,84 +1,378 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/time.h>
-#include <time.h>
-
-#include "../include/mesh.h"
-#include "../include/params.h"
-#include "../include/utils.h"
-
-int main(int argc, char **argv) {
-  // Allocate memory for the mesh structure
-  Mesh *m = (Mesh *)malloc(sizeof(Mesh));
-
-  // Parse command-line arguments to determine the type of mesh
-  meshType type = parseArguments(argc, argv);
-
-  // Initialize the mesh with the specified type
-  initMesh(m, type);
-
-  // Log the total number of springs in the mesh
-  log_info("The number of springs in this network is %d",
-           numberOfSprings(m->n, m->m));
-
-  // Get the string representation of the mesh type
-  const char *type_name = getTypeName(type);
-
-  // Buffers for storing file paths
-  char poly_file_name[256];
-  char grid_file_name[256];
-
-  // Log the start of file generation, including the delta time and number of
-  // files
-  log_info("Starting file generation: delta_time=%.3f number_of_file=%d",
-           DELTA_T, NB_UPDATES / STEP);
-
-  // Create directories for storing VTK files
-  snprintf(poly_file_name, sizeof(poly_file_name), "vtk_poly_%s", type_name);
-  snprintf(grid_file_name, sizeof(grid_file_name), "vtk_grid_%s", type_name);
-  createDirectory(poly_file_name);
-  createDirectory(grid_file_name);
-
-  // Variables to store the start and end time for performance measurement
-  struct timespec start_time, end_time;
-
-  // Start the timer to measure the execution time
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-
-  // Main loop to update the mesh over time
-  for (unsigned int i = 0; i < NB_UPDATES; i++) {
-    // Every 'STEP' iterations, save the current state of the mesh to VTK files
-    if (i % STEP == 0) {
-      // Generate file names for the current iteration
-      snprintf(poly_file_name, sizeof(poly_file_name),
-               "vtk_poly_%s/mesh_poly_%s_%03u.vtk", type_name, type_name, i);
-      snprintf(grid_file_name, sizeof(grid_file_name),
-               "vtk_grid_%s/mesh_grid_%s_%03u.vtk", type_name, type_name, i);
-
-      // Convert the current mesh state to VTK format and save
-      convertMeshToPolyVTK(m, poly_file_name);
-      convertMeshToGridVTK(m, grid_file_name);
-    }
-
-    // Update the position of the mesh points for the next iteration
-    updatePosition(m, DELTA_T, type);
-  }
-
-  // End the timer after the main loop has completed
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-
-  // Calculate the total elapsed time in seconds
-  double elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
-                        (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
-
-  // Log the time taken for file generation
-  log_info("File generation completed in %.3f seconds", elapsed_time);
-
-  // Free the allocated memory for the mesh structure
-  freeMesh(m);
-
-  // Log that the program has finished generating files and is exiting
-  log_debug("Files generated. Exiting ");
-  return 0;
-}
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "../include/alloc.h"
+#include "../include/budget.h"
+#include "../include/mesh.h"
+#include "../include/output.h"
+#include "../include/params.h"
+#include "../include/shm.h"
+#include "../include/utils.h"
+
+int main(int argc, char **argv) {
+  // Allocate memory for the mesh structure
+  Mesh *m = (Mesh *)malloc(sizeof(Mesh));
+
+  // Parse command-line arguments to determine the type of mesh
+  meshType type = parseArguments(argc, argv);
+
+  // Parse the options following the mesh type (output sink...)
+  Options options;
+  parseOptions(argc, argv, &options);
+
+  // Pin the threads before the mesh is first written, and report where
+  // they run
+  Topology topology;
+  readTopology(&topology);
+  pinThreads(&topology, options.pin);
+  logTopology(&topology, options.pin);
+
+  // Initialize the mesh with the default params adjusted for the type
+  Params params = defaultParams();
+  customs_params(&params, type);
+  params.DETERMINISTIC = options.deterministic;
+  params.TILE_SIZE = options.tile_size;
+  params.STENCIL = options.stencil;
+  params.TEMPORAL_STEPS = options.temporal;
+  if (options.temporal_tile > 0)
+    params.TEMPORAL_TILE = options.temporal_tile;
+  if (options.lines > 0) {
+    params.N = options.lines;
+    params.M = options.columns;
+  }
+
+  // The springs of a split face are stiffer, the updates are shorter for
+  // the same frames
+  if (options.refine > 0) {
+    params.REFINE_LEVELS = options.refine;
+    params.DELTA_T /= 1u << options.refine;
+    params.NB_UPDATES <<= options.refine;
+    params.STEP <<= options.refine;
+  }
+
+  // The startup is timed apart from the updates
+  struct timespec init_start, init_end;
+  clock_gettime(CLOCK_MONOTONIC, &init_start);
+
+  // A grid of the type, the mesh of an OBJ file, a refined grid, or a scene
+  // of the grid of the type at the origin and of the added bodies. Except
+  // for an OBJ file, whose size is only known once read, the memory needed
+  // is checked first.
+  MemoryBudget budget;
+  initMemoryBudget(&budget);
+  if (options.n_bodies > 0) {
+    unsigned int n_bodies = options.n_bodies + 1;
+    meshType types[MAX_BODIES + 1];
+    Params body_params[MAX_BODIES + 1];
+    Vector offsets[MAX_BODIES + 1];
+    types[0] = type;
+    body_params[0] = params;
+    offsets[0] = newVector(0.0f, 0.0f, 0.0f);
+    for (unsigned int b = 1; b < n_bodies; b++) {
+      types[b] = options.body_types[b - 1];
+      offsets[b] = options.body_offsets[b - 1];
+      body_params[b] = defaultParams();
+      customs_params(&body_params[b], types[b]);
+      body_params[b].DETERMINISTIC = options.deterministic;
+    }
+    if (!budgetScene(&budget, n_bodies, body_params) ||
+        !checkMemoryBudget(&budget, &options) ||
+        initMeshScene(m, n_bodies, types, body_params, offsets) != 0) {
+      free(m);
+      exit(EXIT_FAILURE);
+    }
+  } else if (options.obj != NULL) {
+    if (initMeshFromObj(m, type, &params, options.obj, options.reorder) != 0) {
+      free(m);
+      exit(EXIT_FAILURE);
+    }
+  } else if (params.REFINE_LEVELS > 0) {
+    if (!budgetRefinedGrid(&budget, &params) ||
+        !checkMemoryBudget(&budget, &options) ||
+        initMeshAdaptive(m, type, &params) != 0) {
+      free(m);
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    if (!budgetGrid(&budget, &params) ||
+        !checkMemoryBudget(&budget, &options) ||
+        initMesh(m, type, &params) != 0) {
+      free(m);
+      exit(EXIT_FAILURE);
+    }
+    log_info("Mesh Created!");
+    Vector center = {(m->n - 1) * params.SPACING / 2.0f, 0.0f,
+                     (m->m - 1) * params.SPACING / 2.0f}; // center of the grid
+    char *center_string = VectorToString(center);
+    log_info("center = %s", center_string);
+    free(center_string);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &init_end);
+  double startup_time = (init_end.tv_sec - init_start.tv_sec) +
+                        (init_end.tv_nsec - init_start.tv_nsec) / 1e9;
+  log_info("Mesh initialized in %.3f seconds", startup_time);
+
+  // Attach the phase timers if a report is requested
+  if (options.profile != NULL) {
+    m->profile = newProfile();
+    m->profile->startup = startup_time;
+  }
+
+  // Compute the diagnostics of every update if a time series is requested
+  FILE *diagnostics_file = NULL;
+  if (options.diagnostics != NULL) {
+    diagnostics_file = fopen(options.diagnostics, "w");
+    if (diagnostics_file == NULL) {
+      log_error("Error: Could not open file %s.", options.diagnostics);
+      freeMesh(m);
+      exit(EXIT_FAILURE);
+    }
+    m->diagnostics = newDiagnostics();
+    writeDiagnosticsHeader(diagnostics_file);
+  }
+
+  // Record the solver events, written by a background thread
+  if (options.trace != NULL) {
+    m->trace = openTrace(options.trace, omp_get_max_threads());
+    if (m->trace == NULL) {
+      freeMesh(m);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Log the total number of springs in the mesh
+  log_info("The number of springs in this network is %" PRI_MESH_INDEX,
+           m->total_springs);
+
+  // Get the string representation of the mesh type
+  const char *type_name = getTypeName(type);
+
+  // Buffers for storing file paths
+  char poly_file_name[256];
+  char grid_file_name[256];
+  char image_file_name[256];
+
+  // Log the start of file generation, including the delta time and number of
+  // files
+  log_info("Starting file generation: delta_time=%.3f number_of_file=%d",
+           params.DELTA_T, params.NB_UPDATES / params.STEP);
+
+  // Create directories for storing VTK files or images, or the shared-memory
+  // segment
+  ShmPublisher *publisher = NULL;
+  Renderer *renderer = NULL;
+  if (options.sink == SINK_VTK && m->scene != NULL) {
+    // The files of each body of a scene
+    for (unsigned int b = 0; b < m->scene->n_bodies; b++) {
+      snprintf(poly_file_name, sizeof(poly_file_name), "vtk_poly_%s_%u",
+               type_name, b);
+      snprintf(grid_file_name, sizeof(grid_file_name), "vtk_grid_%s_%u",
+               type_name, b);
+      createDirectory(poly_file_name);
+      createDirectory(grid_file_name);
+    }
+  } else if (options.sink == SINK_VTK) {
+    snprintf(poly_file_name, sizeof(poly_file_name), "vtk_poly_%s", type_name);
+    snprintf(grid_file_name, sizeof(grid_file_name), "vtk_grid_%s", type_name);
+    createDirectory(poly_file_name);
+    createDirectory(grid_file_name);
+  } else if (options.sink == SINK_IMAGE) {
+    snprintf(image_file_name, sizeof(image_file_name), "img_%s", type_name);
+    createDirectory(image_file_name);
+    fitCamera(&options.camera, m);
+    renderer = newRenderer(&options.camera, options.color, options.format);
+  } else if (options.sink == SINK_SHM) {
+    publisher = shmOpenPublisher(options.shm_name, m, options.shm_slots);
+    if (publisher == NULL) {
+      freeMesh(m);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // The previews, written every preview_step updates whatever the sink
+  char preview_file_name[256];
+  unsigned int preview_step = 0;
+  if (options.preview > 0) {
+    preview_step = options.preview_step > 0 ? options.preview_step
+                                            : params.STEP / PREVIEW_RATE;
+    if (preview_step == 0)
+      preview_step = 1;
+    snprintf(preview_file_name, sizeof(preview_file_name), "vtk_preview_%s",
+             type_name);
+    createDirectory(preview_file_name);
+  }
+
+  // Variables to store the start and end time for performance measurement
+  struct timespec start_time, end_time;
+
+  // Start the timer to measure the execution time
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  // A frame every 'STEP' updates, or when the cloth moves or tears, with
+  // the time of each frame next to the files
+  OutputPolicy policy;
+  if (options.output_tolerance > 0.0f) {
+    initOutputPolicy(&policy, options.output_tolerance, options.output_min,
+                     options.output_max > 0 ? options.output_max
+                                            : OUTPUT_MAX_STEPS * params.STEP);
+    if (options.sink == SINK_VTK || options.sink == SINK_IMAGE) {
+      char times_file_name[256];
+      snprintf(times_file_name, sizeof(times_file_name), "frames_%s.csv",
+               type_name);
+      if (recordFrameTimes(&policy, times_file_name) != 0) {
+        freeMesh(m);
+        exit(EXIT_FAILURE);
+      }
+    }
+  } else {
+    initOutputPolicy(&policy, 0.0f, params.STEP, params.STEP);
+  }
+
+  // Main loop to update the mesh over time
+  unsigned int updates = 0;
+  for (unsigned int i = 0; i < params.NB_UPDATES;) {
+    bool frame = isFrameDue(&policy, m, i);
+
+    // Save each body of a scene to its VTK files
+    if (frame && options.sink == SINK_VTK && m->scene != NULL) {
+      syncSceneBodies(m);
+      for (unsigned int b = 0; b < m->scene->n_bodies; b++) {
+        snprintf(poly_file_name, sizeof(poly_file_name),
+                 "vtk_poly_%s_%u/mesh_poly_%s_%u_%03u.vtk", type_name, b,
+                 type_name, b, i);
+        snprintf(grid_file_name, sizeof(grid_file_name),
+                 "vtk_grid_%s_%u/mesh_grid_%s_%u_%03u.vtk", type_name, b,
+                 type_name, b, i);
+        convertMeshToPolyVTK(m->scene->bodies[b].mesh, poly_file_name);
+        convertMeshToGridVTK(m->scene->bodies[b].mesh, grid_file_name);
+      }
+      frameWritten(&policy, m, i, poly_file_name);
+    } else if (frame && options.sink == SINK_VTK) {
+      // Save the current state of the mesh to VTK files
+      // Generate file names for the current iteration
+      snprintf(poly_file_name, sizeof(poly_file_name),
+               "vtk_poly_%s/mesh_poly_%s_%03u.vtk", type_name, type_name, i);
+      snprintf(grid_file_name, sizeof(grid_file_name),
+               "vtk_grid_%s/mesh_grid_%s_%03u.vtk", type_name, type_name, i);
+
+      // Convert the current mesh state to VTK format and save
+      convertMeshToPolyVTK(m, poly_file_name);
+      convertMeshToGridVTK(m, grid_file_name);
+      frameWritten(&policy, m, i, poly_file_name);
+    } else if (frame && options.sink == SINK_IMAGE) {
+      // Or render it, without writing the mesh itself
+      snprintf(image_file_name, sizeof(image_file_name),
+               "img_%s/frame_%s_%03u.%s", type_name, type_name, i,
+               imageFormatName(options.format));
+      convertMeshToImage(renderer, m, image_file_name);
+      frameWritten(&policy, m, i, image_file_name);
+    } else if (frame && options.sink == SINK_SHM) {
+      // Or publish it for live readers of the shared memory
+      shmPublishFrame(publisher, m, i);
+      frameWritten(&policy, m, i, options.shm_name);
+    } else if (frame) {
+      frameWritten(&policy, m, i, "");
+    }
+
+    // Save every k-th line and column of the grid to its preview
+    if (preview_step > 0 && i % preview_step == 0) {
+      snprintf(preview_file_name, sizeof(preview_file_name),
+               "vtk_preview_%s/mesh_preview_%s_%03u.vtk", type_name,
+               type_name, i);
+      convertMeshToPreviewVTK(m, options.preview, preview_file_name);
+    }
+
+    // Split and merge the faces of a refined grid every 'STEP' updates
+    if (i % params.STEP == 0 && adaptMesh(m, type)) {
+      log_debug("Update %u: %u points, %" PRI_MESH_INDEX " faces", i, m->m,
+                m->n_faces);
+      policy.rebuilt = true;
+    }
+
+    // Update the position of the mesh points until the next frame may be
+    // due, one update at a time when the diagnostics are recorded
+    unsigned int steps = updatesBeforeCheck(&policy, i);
+    if (steps > params.STEP - i % params.STEP)
+      steps = params.STEP - i % params.STEP;
+    if (preview_step > 0 && steps > preview_step - i % preview_step)
+      steps = preview_step - i % preview_step;
+    if (m->diagnostics != NULL)
+      steps = 1;
+    if (steps > params.NB_UPDATES - i)
+      steps = params.NB_UPDATES - i;
+    updatePositions(m, params.DELTA_T, type, steps);
+    i += steps;
+    updates = i;
+
+    // Record the diagnostics and stop early if asked to
+    if (m->diagnostics != NULL) {
+      writeDiagnostics(diagnostics_file, i, m->t, m->diagnostics);
+      if (options.stop_at_rest > 0.0f &&
+          m->diagnostics->kinetic_energy < options.stop_at_rest) {
+        log_info("Mesh at rest after %u updates, stopping", i);
+        break;
+      }
+      if (options.stop_broken > 0.0f &&
+          m->diagnostics->broken_springs >=
+              options.stop_broken * m->total_springs) {
+        log_info("%" PRI_MESH_INDEX
+                 " springs broken after %u updates, stopping",
+                 m->diagnostics->broken_springs, i);
+        break;
+      }
+    }
+  }
+
+  // End the timer after the main loop has completed
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+  // Calculate the total elapsed time in seconds
+  double elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
+                        (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+  // Log the time taken for file generation
+  log_info("File generation completed in %.3f seconds", elapsed_time);
+  if (options.output_tolerance > 0.0f)
+    log_info("%u frames in %u updates", policy.n_frames, params.NB_UPDATES);
+  closeOutputPolicy(&policy);
+
+  // Write the report of the phase timers
+  if (m->profile != NULL) {
+    if (writeProfileReport(m->profile, options.profile, type_name, m->n,
+                           m->m, elapsed_time) == 0) {
+      log_info("Profile report written in %s", options.profile);
+    } else {
+      log_error("Error: Could not write profile report %s", options.profile);
+    }
+    freeProfile(m->profile);
+  }
+
+  if (diagnostics_file != NULL) {
+    fclose(diagnostics_file);
+    log_info("Diagnostics written in %s", options.diagnostics);
+    free(m->diagnostics);
+  }
+
+  if (m->trace != NULL) {
+    closeTrace(m->trace);
+    log_info("Trace written in %s", options.trace);
+  }
+
+  // Free the allocated memory for the mesh structure
+  shmClosePublisher(publisher);
+  freeRenderer(renderer);
+  freeMesh(m);
+
+  // Report the allocations of the run, see make COUNT_ALLOCS=1
+  if (allocCounted())
+    logAllocations(updates);
+
+  // Log that the program has finished generating files and is exiting
+  log_debug("Files generated. Exiting ");
+  return 0;
+}
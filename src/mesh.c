@@ -1,451 +1,2202 @@
-#include "../include/mesh.h"
-#include <omp.h>
-
-/**
- * Return true if a point is fixed and false if not
- */
-bool isFixedPoint(unsigned int i, unsigned int j, Mesh *mesh, meshType type) {
-  Vector origin = {0.0f, 0.0f, 0.0f};
-
-  switch (type) {
-  case CURTAIN: // only the two top points
-    return (i == 0 && j == mesh->m - 1) ||
-           (i == mesh->n - 1 && j == mesh->m - 1);
-
-  case TABLE_CLOTH: // The circle of center
-    Vector center = {(origin.x + (mesh->n - 1) * SPACING) / 2.0f, origin.y,
-                     (origin.z + (mesh->m - 1) * SPACING) /
-                         2.0f}; // center of the mesh
-    float distance =
-        norm(newVectorFromPoint(center, mesh->P[i][j])); // distance de l'origin
-    return distance <= RADIUS;
-
-  case SOFT:
-    // no points is fixed.
-    return false;
-
-  case FLAG: // only the left edge
-    return (i == 0 && j == 0) || (i == 0 && j == mesh->n - 1);
-
-  default:
-    log_error("Type not handled");
-    exit(EXIT_FAILURE);
-  }
-}
-
-/**
- * Ajust params according to the type.
- */
-void customs_params(meshType type) {
-  switch (type) {
-  case CURTAIN:
-    // default params are OK.
-    break;
-
-  case TABLE_CLOTH:
-    // default params are also ok
-    break;
-
-  case SOFT:
-    STIFFNESS_H = 15.0f;
-    STIFFNESS_V = 20.0f;
-    STIFFNESS_D = 40.0f;
-    M = 20;
-    N = 20;
-    SPACING = 0.2f;
-    NB_UPDATES = 300;
-    STEP = 1;
-    ENERGY_THRESHOLD = 1.50f;
-    DAMAGE_THRESHOLD = 4.50f;
-    RADIUS = 0.2f;
-
-    break;
-
-  case FLAG:
-    // default params are OK
-    FLUID.x = 5.0f;
-    FLUID.z = 2.0f;
-    GRAVITY.y = -0.05f;
-    break;
-
-  default:
-    // if you want customs params for a new type : add it here
-    break;
-  }
-}
-
-/**
- * Correctly allocate all attributes of a flag mesh, it fails if the mesh
- * provided is NULL
- */
-void initMesh(Mesh *mesh, meshType type) {
-  if (mesh == NULL) {
-    log_error("Mesh provided is empty!!");
-    return;
-  }
-
-  /**
-   *   customs params
-   */
-  customs_params(type);
-
-  mesh->n = N;
-  mesh->m = M;
-  mesh->t = 0.0f; // the initial is zero
-
-  mesh->P = getMatrix(N, M);
-  mesh->P0 = getMatrix(N, M);
-  mesh->V = getMatrix(N, M);
-
-  unsigned int nb_springs =
-      numberOfSprings(N, M); // total number of springs in the mesh
-  mesh->springs = (Spring *)malloc(nb_springs * sizeof(Spring));
-  mesh->n_springs = nb_springs;
-
-  mesh->face_spring_indices =
-      (unsigned int ***)malloc((N - 1) * sizeof(unsigned int **));
-  for (unsigned int i = 0; i < N - 1; i++) {
-    mesh->face_spring_indices[i] =
-        (unsigned int **)malloc((M - 1) * sizeof(unsigned int *));
-    for (unsigned int j = 0; j < M - 1; j++) {
-      mesh->face_spring_indices[i][j] = (unsigned int *)malloc(
-          SPRINGS_PER_FACE * sizeof(unsigned int)); // Up to 8 springs per face
-    }
-  }
-
-  Vector origin = {0.0f, 0.0f, 0.0f};
-  unsigned int spring_count = 0;
-
-  for (unsigned int i = 0; i < N; i++) {
-    for (unsigned int j = 0; j < M; j++) {
-      /**
-       * Initialize the position of the point in the space here.
-       *
-       * */
-      switch (type) {
-      case CURTAIN: // rectangle in the x,y
-        mesh->P[i][j] =
-            newVector(origin.x + i * SPACING, origin.y + j * SPACING, origin.z);
-        mesh->P0[i][j] =
-            newVector(origin.x + i * SPACING, origin.y + j * SPACING, origin.z);
-        mesh->V[i][j] = newVector(0.0f, 0.0f, 0.0f);
-        break;
-
-      case TABLE_CLOTH: // rectangle in the x,z plan
-        mesh->P[i][j] =
-            newVector(origin.x + i * SPACING, origin.y, origin.z + j * SPACING);
-        mesh->P0[i][j] =
-            newVector(origin.x + i * SPACING, origin.y, origin.z + j * SPACING);
-        mesh->V[i][j] = newVector(0.0f, 0.0f, 0.0f);
-        break;
-
-      case SOFT: // rectangle in the x,y plan
-        mesh->P[i][j] =
-            newVector(origin.x + i * SPACING, origin.y + j * SPACING, origin.z);
-        mesh->P0[i][j] =
-            newVector(origin.x + i * SPACING, origin.y + j * SPACING, origin.z);
-        mesh->V[i][j] = newVector(0.0f, 0.0f, 0.0f);
-        break;
-
-      case FLAG: // rectangle in the x,y
-        mesh->P[i][j] = newVector(origin.x + i * 1.4f * SPACING,
-                                  origin.y + j * SPACING, origin.z);
-        mesh->P0[i][j] = newVector(origin.x + i * 1.4f * SPACING,
-                                   origin.y + j * SPACING, origin.z);
-        mesh->V[i][j] = newVector(0.0f, 0.0f, 0.0f);
-        break;
-
-      default:
-        log_error("Type of mesh not handled");
-        freeMesh(mesh);
-        exit(EXIT_FAILURE);
-      }
-      fillSprings(mesh->springs, mesh->face_spring_indices, &spring_count, i, j,
-                  N, M);
-    }
-  }
-
-  log_info("Mesh Created!");
-  Vector center = {(origin.x + (mesh->n - 1) * SPACING) / 2.0f, origin.y,
-                   (origin.z + (mesh->m - 1) * SPACING) /
-                       2.0f}; // center of the mesh
-
-  char *center_string = VectorToString(center);
-  log_info("center = %s", center_string);
-  free(center_string);
-}
-
-/**
- * Compute the next position of the mesh point.
- * For now, we ignore the fluid forces
- */
-void updatePosition(Mesh *mesh, float delta_t, meshType type) {
-  Vector **acc = getMatrix(mesh->n, mesh->m); // Acceleration matrix
-
-  // Compute spring forces and update acceleration
-  computeSpringForces(mesh, acc, type, delta_t);
-
-// Compute position and velocity for every point
-#pragma omp parallel for collapse(2)
-  for (int i = 0; i < mesh->n; i++) {
-    for (int j = 0; j < mesh->m; j++) {
-      if (!isFixedPoint(i, j, mesh, type)) {
-        Vector f_dis =
-            multVector(-C_DIS, mesh->V[i][j]); // Viscous damping force
-        Vector f_fluid = computeFluidForce(mesh, i, j, FLUID); // fluid force
-        Vector F = addVector(GRAVITY, f_dis);
-        F = addVector(F, computeAddForces(mesh, type, i, j));
-        F = addVector(F, f_fluid);
-
-        acc[i][j] = addVector(acc[i][j], multVector(1 / Mu, F));
-
-        mesh->V[i][j] =
-            addVector(mesh->V[i][j], multVector(delta_t, acc[i][j]));
-        mesh->P[i][j] =
-            addVector(mesh->P[i][j], multVector(delta_t, mesh->V[i][j]));
-      }
-    }
-  }
-
-  freeMatrix(acc, mesh->n); // Free allocated memory for acceleration matrix
-}
-
-/**
- * Compute forces applied to each spring and update acceleration matrix
- */
-void computeSpringForces(Mesh *mesh, Vector **acc, meshType type,
-                         float delta_t) {
-  unsigned int number_springs = numberOfSprings(mesh->n, mesh->m);
-
-// Start a parallel region; each thread will have its own local acceleration
-// matrix
-#pragma omp parallel
-  {
-    // Thread-local acceleration matrix to avoid conflicts with other threads
-    Vector **local_acc = getMatrix(mesh->n, mesh->m);
-
-// Parallel for loop to iterate over all springs in the mesh
-#pragma omp for
-    for (unsigned int k = 0; k < number_springs; k++) {
-      Spring *current = &mesh->springs[k];
-
-      // Skip broken springs
-      if (current->isBreak)
-        continue;
-
-      // Get the points connected by the spring
-      Point A = current->ext_1;
-      Point B = current->ext_2;
-
-      // Get the current positions of the spring's endpoints
-      Vector current_position = mesh->P[A.i][A.j];
-      Vector target_current_position = mesh->P[B.i][B.j];
-
-      // Compute the vector representing the spring's displacement
-      Vector l_i_j_k_l =
-          newVectorFromPoint(target_current_position, current_position);
-      float current_spring_len = norm(l_i_j_k_l);
-
-      // Compute the original length of the spring
-      float original_spring_len =
-          norm(newVectorFromPoint(mesh->P0[A.i][A.j], mesh->P0[B.i][B.j]));
-
-      // Calculate the spring force magnitude using Hooke's Law
-      float force_magnitude =
-          -current->stiffness * (current_spring_len - original_spring_len);
-
-      // Calculate the direction of the spring force
-      Vector direction = normalize(l_i_j_k_l);
-
-      // Apply force to endpoint A if it's not a fixed point
-      if (!isFixedPoint(A.i, A.j, mesh, type)) {
-        // Accumulate the force into the thread-local acceleration matrix
-        local_acc[A.i][A.j] = addVector(
-            local_acc[A.i][A.j], multVector(force_magnitude / Mu, direction));
-      }
-
-      // Apply force to endpoint B if it's not a fixed point
-      if (!isFixedPoint(B.i, B.j, mesh, type)) {
-        // Accumulate the opposing force into the thread-local acceleration
-        // matrix
-        local_acc[B.i][B.j] = addVector(
-            local_acc[B.i][B.j], multVector(-force_magnitude / Mu, direction));
-      }
-
-      // Calculate strain and potential energy for damage and breakage checks
-      float strain =
-          (current_spring_len - original_spring_len) / original_spring_len;
-      float potential_energy = 0.5f * current->stiffness *
-                               (current_spring_len - original_spring_len) *
-                               (current_spring_len - original_spring_len);
-
-// Atomically update the damage on the spring
-#pragma omp atomic
-      current->damage += strain * delta_t;
-
-      // Check if the spring should break based on energy or damage thresholds
-
-      // Method using a len criteria
-      // float ratio = current_spring_len / original_spring_len ;
-      // if ( ratio >= 1.5f  )
-      // {
-      //     #pragma omp critical
-      //     {
-      //         current->isBreak = true;
-      //         mesh->n_springs--;
-      //     }
-      // }
-
-      // Method using a more complex criteria based on energy and damage
-      if (potential_energy > ENERGY_THRESHOLD ||
-          current->damage > DAMAGE_THRESHOLD) {
-// Critical section to safely mark the spring as broken and decrease the spring
-// count
-#pragma omp critical
-        {
-          current->isBreak = true;
-          mesh->n_springs--;
-        }
-      }
-    }
-
-// Critical section to merge thread-local acceleration matrices into the global
-// matrix
-#pragma omp critical
-    {
-      // Iterate over the entire matrix and add local_acc to the global acc
-      for (int i = 0; i < mesh->n; i++) {
-        for (int j = 0; j < mesh->m; j++) {
-          acc[i][j] = addVector(acc[i][j], local_acc[i][j]);
-        }
-      }
-    }
-
-    // Free the memory allocated for the thread-local acceleration matrix
-    freeMatrix(local_acc, mesh->n);
-  }
-}
-
-/**
- * Compute the force generated by the fluid at point i,j
- */
-Vector computeFluidForce(Mesh *mesh, unsigned int i, unsigned int j,
-                         Vector u_fluid) {
-  Vector f_fluid = {0.0f, 0.0f, 0.0f};
-  Vector n_ij = {0.0f, 0.0f, 0.0f};
-
-  // Compute the normal force
-  unsigned int nb_springs = 0;
-  Spring *R = getPossibleSprings(i, j, mesh->n, mesh->m, &nb_springs);
-
-  if (nb_springs > 2) {
-    // First vector
-    Vector a = newVectorFromPoint(mesh->P[R[0].ext_1.i][R[0].ext_1.j],
-                                  mesh->P[R[0].ext_2.i][R[0].ext_2.j]);
-
-    unsigned int k = 0;
-    for (k = 1; k < nb_springs;
-         k++) // find a non colinear vector among his neighbors
-    {
-      // Second Vector
-      Vector b = newVectorFromPoint(mesh->P[R[k].ext_1.i][R[k].ext_1.j],
-                                    mesh->P[R[k].ext_2.i][R[k].ext_2.j]);
-
-      // Check for colinearity
-      if (!isCollinear(a, b)) {
-        n_ij = normalize(crossProduct(a, b));
-        break;
-      }
-    }
-    if (k == nb_springs) // there is no non colinear vector between his spring
-                         // neighborhood
-    {
-      log_error("Cannot compute normal vector for %d, %d", i, j);
-    }
-  } else {
-    log_error("Cannot find correct possible springs for %d, %d", i, j);
-  }
-
-  float scal = scalar_product(
-      n_ij, addVector(u_fluid, multVector(-1.0f, mesh->V[i][j])));
-  f_fluid = multVector(scal * C_VI, n_ij);
-
-  free(R);
-
-  return f_fluid;
-}
-
-/**
- * De-allocate correctly a mesh
- */
-void freeMesh(Mesh *mesh) {
-
-  for (unsigned int i = 0; i < mesh->n - 1; i++) {
-    for (unsigned int j = 0; j < mesh->m - 1; j++) {
-      free(mesh->face_spring_indices[i][j]);
-    }
-    free(mesh->face_spring_indices[i]);
-  }
-
-  for (unsigned int i = 0; i < mesh->n; i++) {
-    free(mesh->P[i]);
-    free(mesh->V[i]);
-    free(mesh->P0[i]);
-  }
-
-  free(mesh->P);
-  free(mesh->V);
-  free(mesh->P0);
-  free(mesh->springs);
-  free(mesh->face_spring_indices);
-  free(mesh);
-}
-
-/**
- * Return a vector of force depending on the meshtype, these are customs forces
- * that are not listed in the initial documentation
- */
-Vector computeAddForces(Mesh *mesh, meshType type, unsigned int i,
-                        unsigned int j) {
-  Vector res = {0, 0, 0};
-  float coef = 2.0f;
-
-  switch (type) {
-  case CURTAIN:
-    /* No additionnal forces to add*/
-    break;
-
-  case TABLE_CLOTH:
-    /* No additionnal forces to add*/
-    break;
-
-  case SOFT:
-    res.y = 0.1f;
-
-    // Apply a force to point onto the left and right edge of the soft
-    if (i < mesh->n / 2) {
-      res.x += -coef * mesh->P[i][j].y;
-      // if( j >= mesh->m - 4)
-      //     res.z += coef;
-    } else {
-      res.x += coef * mesh->P[i][j].y;
-    }
-
-    // apply a force to little square a t the bottom right of the soft
-    // if ( j <= 4)
-    // {
-    //     res.y -= coef;
-    // }
-
-    break;
-  case FLAG:
-    /* No additionnal forces to add*/
-    break;
-
-  default:
-    break;
-  }
-
-  // Return null vector
-  return res;
+#include "../include/mesh.h"
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
+#include <string.h>
+
+/**
+ * Return true if a point is fixed and false if not
+ */
+static bool isFixedAt(meshType type, const Params *params, float gi,
+                      float gj, Vector position);
+
+bool isFixedPoint(unsigned int i, unsigned int j, Mesh *mesh, meshType type) {
+  // An imported or refined mesh has its fixed points listed
+  if (mesh->surface != NULL)
+    return mesh->surface->fixed[j];
+
+  // Coordinates in the whole grid, the mesh may be a block of it
+  return isFixedAt(type, &mesh->params, i + mesh->i0, j + mesh->j0,
+                   mesh->P[i][j]);
+}
+
+/**
+ * True if the point at the line gi and column gj of the grid of params is
+ * fixed, its position being given. The points of a refined grid are between
+ * those of the grid, at fractions of lines and columns.
+ */
+static bool isFixedAt(meshType type, const Params *params, float gi,
+                      float gj, Vector position) {
+  Vector origin = {0.0f, 0.0f, 0.0f};
+  const unsigned int N = params->N, M = params->M;
+
+  switch (type) {
+  case CURTAIN: // only the two top points
+    return (gi == 0 && gj == M - 1) || (gi == N - 1 && gj == M - 1);
+
+  case TABLE_CLOTH: // The circle of center
+    Vector center = {(origin.x + (N - 1) * params->SPACING) / 2.0f, origin.y,
+                     (origin.z + (M - 1) * params->SPACING) /
+                         2.0f}; // center of the mesh
+    float distance =
+        norm(newVectorFromPoint(center, position)); // distance de l'origin
+    return distance <= params->RADIUS;
+
+  case SOFT:
+    // no points is fixed.
+    return false;
+
+  case FLAG: // only the left edge
+    return (gi == 0 && gj == 0) || (gi == 0 && gj == N - 1);
+
+  default:
+    log_error("Type not handled");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * Ajust params according to the type.
+ */
+void customs_params(Params *params, meshType type) {
+  switch (type) {
+  case CURTAIN:
+    // default params are OK.
+    break;
+
+  case TABLE_CLOTH:
+    // default params are also ok
+    break;
+
+  case SOFT:
+    params->STIFFNESS_H = 15.0f;
+    params->STIFFNESS_V = 20.0f;
+    params->STIFFNESS_D = 40.0f;
+    params->M = 20;
+    params->N = 20;
+    params->SPACING = 0.2f;
+    params->NB_UPDATES = 300;
+    params->STEP = 1;
+    params->ENERGY_THRESHOLD = 1.50f;
+    params->DAMAGE_THRESHOLD = 4.50f;
+    params->RADIUS = 0.2f;
+
+    break;
+
+  case FLAG:
+    // default params are OK
+    params->FLUID.x = 5.0f;
+    params->FLUID.z = 2.0f;
+    params->GRAVITY.y = -0.05f;
+    break;
+
+  default:
+    // if you want customs params for a new type : add it here
+    break;
+  }
+}
+
+/**
+ * Position of the point i, j at t = 0
+ */
+static Vector initialPosition(meshType type, Vector origin, float spacing,
+                              unsigned int i, unsigned int j) {
+  switch (type) {
+  case TABLE_CLOTH: // rectangle in the x,z plan
+    return newVector(origin.x + i * spacing, origin.y, origin.z + j * spacing);
+
+  case FLAG: // rectangle in the x,y
+    return newVector(origin.x + i * 1.4f * spacing, origin.y + j * spacing,
+                     origin.z);
+
+  default: // CURTAIN and SOFT, rectangle in the x,y plan
+    return newVector(origin.x + i * spacing, origin.y + j * spacing, origin.z);
+  }
+}
+
+/**
+ * Write zeros in the count elements of an array with the static partition of
+ * a parallel loop over them, which places each page on the NUMA node of the
+ * thread that will use it
+ */
+static void firstTouch(void *array, size_t count, size_t size) {
+#pragma omp parallel
+  {
+    // The elements of the thread in a static loop, as one block
+    size_t threads = omp_get_num_threads(), t = omp_get_thread_num();
+    size_t share = count / threads, extra = count % threads;
+    size_t begin = t * share + (t < extra ? t : extra);
+    size_t end = begin + share + (t < extra);
+    memset((char *)array + begin * size, 0, (end - begin) * size);
+  }
+}
+
+/**
+ * Allocate the states of n_faces faces, all intact
+ */
+static void newFaceStates(Mesh *mesh, meshIndex n_faces) {
+  mesh->n_faces = n_faces;
+  mesh->broken_faces = (uint64_t *)calloc(n_faces / 64 + 1, sizeof(uint64_t));
+  mesh->n_broken_faces = 0;
+}
+
+/**
+ * Fill spring_faces, the faces having each spring as an edge, from the
+ * first `edges` springs of the faces
+ */
+static void linkSpringFaces(Mesh *mesh, unsigned int edges) {
+  mesh->spring_faces =
+      (meshIndex *)malloc(2 * (size_t)mesh->total_springs * sizeof(meshIndex));
+  memset(mesh->spring_faces, 0xff,
+         2 * (size_t)mesh->total_springs * sizeof(meshIndex));
+  for (meshIndex f = 0; f < mesh->n_faces; f++) {
+    for (unsigned int k = 0; k < edges; k++) {
+      meshIndex spring = mesh->face_springs[f * SPRINGS_PER_FACE + k];
+      if (spring == NO_SPRING)
+        continue;
+      meshIndex *faces = &mesh->spring_faces[2 * (size_t)spring];
+      faces[faces[0] == NO_FACE ? 0 : 1] = f;
+    }
+  }
+}
+
+/**
+ * Same as linkSpringFaces(mesh, 4) for the faces of a grid filled by
+ * fillSprings, face by face in parallel: the structural spring of an edge
+ * shared with the face on the left or above is the second edge of the spring
+ */
+static void linkGridSpringFaces(Mesh *mesh) {
+  const size_t size = 2 * (size_t)mesh->total_springs;
+  mesh->spring_faces = (meshIndex *)malloc(size * sizeof(meshIndex));
+#pragma omp parallel for schedule(static)
+  for (size_t k = 0; k < size; k++) {
+    mesh->spring_faces[k] = NO_FACE;
+  }
+
+  const unsigned int m = mesh->m;
+#pragma omp parallel for schedule(static)
+  for (meshIndex f = 0; f < mesh->n_faces; f++) {
+    const meshIndex *springs =
+        &mesh->face_springs[(size_t)f * SPRINGS_PER_FACE];
+    unsigned int i = f / (m - 1), j = f % (m - 1);
+    mesh->spring_faces[2 * (size_t)springs[0] + (j > 0)] = f;
+    mesh->spring_faces[2 * (size_t)springs[1]] = f;
+    mesh->spring_faces[2 * (size_t)springs[2] + (i > 0)] = f;
+    mesh->spring_faces[2 * (size_t)springs[3]] = f;
+  }
+}
+
+/**
+ * Set the state of the face f to broken
+ */
+static inline void breakFace(Mesh *mesh, meshIndex f) {
+  uint64_t bit = (uint64_t)1 << (f % 64);
+  if (!(mesh->broken_faces[f / 64] & bit)) {
+    mesh->broken_faces[f / 64] |= bit;
+    mesh->n_broken_faces++;
+  }
+}
+
+/**
+ * Break the faces of the springs broken during the last update. Only the
+ * faces of these springs are visited.
+ */
+static void updateFaceStates(Mesh *mesh) {
+  const Stencil *stencil = mesh->stencil;
+  const unsigned int m = mesh->m;
+  for (meshIndex b = 0; b < mesh->n_broken; b++) {
+    meshIndex k = mesh->broken_springs[b];
+    if (stencil == NULL) {
+      for (unsigned int e = 0; e < 2; e++) {
+        if (mesh->spring_faces[2 * (size_t)k + e] != NO_FACE)
+          breakFace(mesh, mesh->spring_faces[2 * (size_t)k + e]);
+      }
+      continue;
+    }
+
+    // The structural spring (d, p) of the stencil is an edge of the faces
+    // on each side of it
+    unsigned int d = k / (mesh->n * m), p = k % (mesh->n * m);
+    unsigned int i = p / m, j = p % m;
+    if (d == 0 && i + 1 < mesh->n) { // (i, j) -> (i+1, j)
+      if (j > 0)
+        breakFace(mesh, i * (m - 1) + j - 1);
+      if (j + 1 < m)
+        breakFace(mesh, i * (m - 1) + j);
+    } else if (d == 1 && j + 1 < m) { // (i, j) -> (i, j+1)
+      if (i > 0)
+        breakFace(mesh, (i - 1) * (m - 1) + j);
+      if (i + 1 < mesh->n)
+        breakFace(mesh, i * (m - 1) + j);
+    }
+  }
+}
+
+/**
+ * List the springs of every point for the deterministic mode, in increasing
+ * order, see Mesh.point_springs
+ */
+static void listPointSprings(Mesh *mesh, meshIndex nb_springs) {
+  const unsigned int N = mesh->n, M = mesh->m;
+  mesh->point_springs_start =
+      (meshIndex *)calloc(N * M + 1, sizeof(meshIndex));
+  mesh->point_springs =
+      (meshIndex *)malloc(2 * (size_t)nb_springs * sizeof(meshIndex));
+  mesh->spring_forces = (Vector *)malloc(nb_springs * sizeof(Vector));
+  firstTouch(mesh->spring_forces, nb_springs, sizeof(Vector));
+
+  for (meshIndex k = 0; k < nb_springs; k++) {
+    Spring *s = &mesh->springs[k];
+    mesh->point_springs_start[s->ext_1.i * M + s->ext_1.j + 1]++;
+    mesh->point_springs_start[s->ext_2.i * M + s->ext_2.j + 1]++;
+  }
+  for (unsigned int p = 0; p < N * M; p++) {
+    mesh->point_springs_start[p + 1] += mesh->point_springs_start[p];
+  }
+
+  meshIndex *fill = (meshIndex *)malloc(N * M * sizeof(meshIndex));
+  memcpy(fill, mesh->point_springs_start, N * M * sizeof(meshIndex));
+  for (meshIndex k = 0; k < nb_springs; k++) {
+    Spring *s = &mesh->springs[k];
+    mesh->point_springs[fill[s->ext_1.i * M + s->ext_1.j]++] = k << 1;
+    mesh->point_springs[fill[s->ext_2.i * M + s->ext_2.j]++] = k << 1 | 1;
+  }
+  free(fill);
+}
+
+/**
+ * Same as listPointSprings for a grid filled by fillSprings, point by point
+ * in parallel, see gridPointSprings
+ */
+static void listGridPointSprings(Mesh *mesh) {
+  const unsigned int N = mesh->n, M = mesh->m;
+  const meshIndex nb_springs = mesh->total_springs;
+  meshIndex *start =
+      (meshIndex *)malloc(((size_t)N * M + 1) * sizeof(meshIndex));
+  mesh->point_springs_start = start;
+  mesh->point_springs =
+      (meshIndex *)malloc(2 * (size_t)nb_springs * sizeof(meshIndex));
+  mesh->spring_forces = (Vector *)malloc(nb_springs * sizeof(Vector));
+  firstTouch(mesh->spring_forces, nb_springs, sizeof(Vector));
+
+  start[0] = 0;
+#pragma omp parallel for collapse(2) schedule(static)
+  for (unsigned int i = 0; i < N; i++) {
+    for (unsigned int j = 0; j < M; j++) {
+      start[i * M + j + 1] = gridPointSprings(i, j, N, M, NULL);
+    }
+  }
+  for (size_t p = 0; p < (size_t)N * M; p++) {
+    start[p + 1] += start[p];
+  }
+#pragma omp parallel for collapse(2) schedule(static)
+  for (unsigned int i = 0; i < N; i++) {
+    for (unsigned int j = 0; j < M; j++) {
+      gridPointSprings(i, j, N, M, &mesh->point_springs[start[i * M + j]]);
+    }
+  }
+}
+
+static void freeMeshArrays(Mesh *mesh);
+
+/**
+ * Return true if the points of a mesh can be numbered: they are on 32 bits,
+ * and at most 6 springs start at a point, each of them numbered twice in
+ * the lists of the deterministic mode. Else log why.
+ */
+bool checkMeshIndices(uint64_t points) {
+  if (points > UINT_MAX) {
+    log_error("%" PRIu64 " points, more than the %u a mesh can number",
+              points, UINT_MAX);
+    return false;
+  }
+  if (points > (uint64_t)MESH_INDEX_MAX / (2 * 6)) {
+    log_error("%" PRIu64 " points, too many springs for 32-bit indices, "
+              "build with make LARGE_MESH=1",
+              points);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Return true if a grid of the type can be built with params, else log why
+ */
+bool checkGridParams(meshType type, const Params *params) {
+  if (type != CURTAIN && type != TABLE_CLOTH && type != SOFT && type != FLAG) {
+    log_error("Type of mesh not handled");
+    return false;
+  }
+  if (!checkMeshIndices((uint64_t)params->N * params->M))
+    return false;
+  if (params->STENCIL && params->TILE_SIZE > 0) {
+    log_error("The tiled update needs the list of springs, not a stencil");
+    return false;
+  }
+  if (params->TEMPORAL_STEPS > 1 &&
+      (!params->DETERMINISTIC || params->STENCIL || params->TILE_SIZE > 0 ||
+       params->TEMPORAL_TILE == 0)) {
+    log_error("The temporally blocked update is that of the deterministic "
+              "mode, with tiles of at least one point");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Correctly allocate all attributes of a flag mesh. The mesh keeps a copy of
+ * params, usually the default params adjusted with customs_params. Return 0
+ * on success, -1 if the mesh provided is NULL or params are rejected, see
+ * checkGridParams.
+ */
+int initMesh(Mesh *mesh, meshType type, const Params *params) {
+  return initMeshBlock(mesh, type, params, 0, 0, params->N, params->M);
+}
+
+/**
+ * Same as initMesh for the block of n lines and m columns starting at i0, j0
+ * in the N x M grid of params. The springs are those between the points of
+ * the block, and the fixed points and forces those of the whole grid.
+ */
+int initMeshBlock(Mesh *mesh, meshType type, const Params *params,
+                  unsigned int i0, unsigned int j0, unsigned int n,
+                  unsigned int m) {
+  if (mesh == NULL) {
+    log_error("Mesh provided is empty!!");
+    return -1;
+  }
+  // Nothing is allocated yet
+  if (!checkGridParams(type, params))
+    return -1;
+
+  mesh->params = *params;
+  mesh->profile = NULL;
+  mesh->diagnostics = NULL;
+  mesh->trace = NULL;
+  mesh->tiling = NULL;
+  mesh->temporal = NULL;
+  mesh->stencil = NULL;
+  mesh->surface = NULL;
+  mesh->refinement = NULL;
+  mesh->mass = NULL;
+  mesh->scene = NULL;
+  mesh->springs = NULL;
+  mesh->face_springs = NULL;
+  mesh->spring_faces = NULL;
+  mesh->broken_faces = NULL;
+  mesh->i0 = i0;
+  mesh->j0 = j0;
+  const unsigned int N = n, M = m;
+  const float SPACING = params->SPACING;
+
+  mesh->n = N;
+  mesh->m = M;
+  mesh->t = 0.0f; // the initial is zero
+
+  mesh->P = getMatrix(N, M);
+  mesh->P0 = getMatrix(N, M);
+  mesh->V = getMatrix(N, M);
+
+  meshIndex nb_springs =
+      numberOfSprings(N, M); // total number of springs in the mesh
+  mesh->total_springs = nb_springs;
+  mesh->n_springs = nb_springs;
+  mesh->broken_springs =
+      (meshIndex *)malloc(nb_springs * sizeof(meshIndex));
+  mesh->n_broken = 0;
+
+  Vector origin = {0.0f, 0.0f, 0.0f};
+
+  newFaceStates(mesh, (N - 1) * (M - 1));
+  if (!params->STENCIL) {
+    mesh->springs = (Spring *)malloc(nb_springs * sizeof(Spring));
+    mesh->face_springs = (meshIndex *)malloc(
+        (size_t)mesh->n_faces * SPRINGS_PER_FACE * sizeof(meshIndex));
+    memset(mesh->face_springs, 0xff,
+           (size_t)mesh->n_faces * SPRINGS_PER_FACE * sizeof(meshIndex));
+  }
+
+  // The points are first written with the partition of the vertex loops, and
+  // the springs with the one of the spring loop, so that on a NUMA machine
+  // their pages are on the node of the thread updating them
+#pragma omp parallel for collapse(2) schedule(static)
+  for (unsigned int i = 0; i < N; i++) {
+    for (unsigned int j = 0; j < M; j++) {
+      mesh->P[i][j] = initialPosition(type, origin, SPACING, i0 + i, j0 + j);
+      mesh->P0[i][j] = mesh->P[i][j];
+      mesh->V[i][j] = newVector(0.0f, 0.0f, 0.0f);
+    }
+  }
+
+  // The springs of the stencil are implied by the grid
+  if (params->STENCIL) {
+    mesh->stencil = newStencil(N, M);
+    mesh->point_springs_start = NULL;
+    mesh->point_springs = NULL;
+    mesh->spring_forces = NULL;
+    return 0;
+  }
+
+  // Each line starts at its first spring, see firstSpringOf, so the lines
+  // are filled in parallel and each spring first written by the thread of
+  // its line
+#pragma omp parallel for schedule(static)
+  for (unsigned int i = 0; i < N; i++) {
+    meshIndex spring_count = firstSpringOf(i, 0, N, M);
+    for (unsigned int j = 0; j < M; j++) {
+      fillSprings(mesh->springs, mesh->face_springs, &spring_count, i, j, N,
+                  M, params);
+    }
+  }
+  linkGridSpringFaces(mesh); // the structural springs
+
+  // Springs of every point for the deterministic mode, in increasing order
+  mesh->point_springs_start = NULL;
+  mesh->point_springs = NULL;
+  mesh->spring_forces = NULL;
+  if (params->DETERMINISTIC)
+    listGridPointSprings(mesh);
+
+  // Tiles of the tiled update, see updateTiles
+  if (params->TILE_SIZE > 0) {
+    mesh->tiling =
+        newTiling(mesh->springs, nb_springs, N, M, params->TILE_SIZE);
+    if (mesh->tiling == NULL) {
+      freeMeshArrays(mesh);
+      return -1;
+    }
+  }
+
+  // Tiles of the temporally blocked update, see advanceBlock
+  if (params->TEMPORAL_STEPS > 1)
+    mesh->temporal = newTemporalBlocking(N, M, nb_springs,
+                                         params->TEMPORAL_STEPS,
+                                         params->TEMPORAL_TILE);
+  return 0;
+}
+
+/**
+ * Add the point i, j to the diagnostics of the calling thread: kinetic gets
+ * |V|^2, low and high are the 3 lower and upper bounds of the positions
+ */
+static inline void addPointDiagnostics(const Mesh *mesh, int i, int j,
+                                       double *kinetic, float *low,
+                                       float *high) {
+  Vector p = mesh->P[i][j];
+  *kinetic += scalar_product(mesh->V[i][j], mesh->V[i][j]);
+  low[0] = fminf(low[0], p.x);
+  low[1] = fminf(low[1], p.y);
+  low[2] = fminf(low[2], p.z);
+  high[0] = fmaxf(high[0], p.x);
+  high[1] = fmaxf(high[1], p.y);
+  high[2] = fmaxf(high[2], p.z);
+}
+
+/**
+ * Add a spring to the diagnostics of the calling thread
+ */
+static inline void addSpringDiagnostics(const Mesh *mesh, float damage,
+                                        float strain, float potential_energy,
+                                        double *potential, float *max_strain,
+                                        meshIndex *histogram) {
+  *potential += potential_energy;
+  *max_strain = fmaxf(*max_strain, strain);
+  histogram[damageBin(damage, mesh->params.DAMAGE_THRESHOLD)]++;
+}
+
+/**
+ * Acceleration of the point i, j due to every force but the springs
+ */
+static Vector externalAcceleration(Mesh *mesh, meshType type, int i, int j) {
+  // The point of a scene is moved as the point of the grid of its body
+  if (mesh->scene != NULL) {
+    const Body *body = &mesh->scene->bodies[mesh->scene->point_body[j]];
+    unsigned int p = j - body->first_point;
+    return externalAcceleration(body->mesh, body->type, p / body->mesh->m,
+                                p % body->mesh->m);
+  }
+
+  const Params *params = &mesh->params;
+  Vector f_dis =
+      multVector(-params->C_DIS, mesh->V[i][j]); // Viscous damping force
+  PROFILE_START(mesh->profile, fluid_start);
+  Vector f_fluid = computeFluidForce(mesh, i, j, params->FLUID); // fluid force
+  PROFILE_STOP_THREAD(mesh->profile, fluid_start);
+  Vector F = addVector(params->GRAVITY, f_dis);
+  F = addVector(F, computeAddForces(mesh, type, i, j));
+  F = addVector(F, f_fluid);
+  return multVector(1 / params->Mu, F);
+}
+
+/**
+ * Acceleration of the point i, j by its springs, from the one it would have
+ * if it weighed params.Mu. The other forces follow the area of the point, as
+ * its mass, and give the same acceleration whatever it weighs.
+ */
+static inline Vector springAcceleration(const Mesh *mesh, int i, int j,
+                                        Vector acc) {
+  if (mesh->mass == NULL)
+    return acc;
+  return multVector(1.0f / mesh->mass[i * mesh->m + j], acc);
+}
+
+/**
+ * Params deciding when a spring breaks, those of its body in a scene
+ */
+static inline const Params *breakingParams(const Mesh *mesh,
+                                           const Spring *spring) {
+  if (mesh->scene == NULL)
+    return &mesh->params;
+  const Scene *scene = mesh->scene;
+  return &scene->bodies[scene->point_body[spring->ext_1.j]].mesh->params;
+}
+
+static void updateTiles(Mesh *mesh, meshType type, float delta_t,
+                        double *kinetic, float *low, float *high);
+static void updateSeparately(Mesh *mesh, float delta_t, meshType type);
+static void advanceBlock(Mesh *mesh, float delta_t, meshType type,
+                         unsigned int steps);
+static void storeSpringDiagnostics(Diagnostics *diag, double potential,
+                                   float max_strain,
+                                   const meshIndex *histogram);
+static inline void updateSpring(Mesh *mesh, meshIndex k, meshType type,
+                                float delta_t, Vector **local_acc,
+                                double *potential, float *max_strain,
+                                meshIndex *histogram);
+
+/**
+ * True if the mesh has enough points for a team of threads to be faster
+ * than a single one
+ */
+static bool inParallel(const Mesh *mesh) {
+  return mesh->n * mesh->m >= mesh->params.PARALLEL_THRESHOLD;
+}
+
+/**
+ * Store the point diagnostics reduced during the vertex loop
+ */
+static void storePointDiagnostics(Mesh *mesh, double kinetic,
+                                  const float *low, const float *high) {
+  Diagnostics *diag = mesh->diagnostics;
+  diag->kinetic_energy = 0.5 * mesh->params.Mu * kinetic;
+  diag->broken_springs = mesh->total_springs - mesh->n_springs;
+  diag->min = newVector(low[0], low[1], low[2]);
+  diag->max = newVector(high[0], high[1], high[2]);
+}
+
+// Spring diagnostics of an update, summed over the threads
+typedef struct SpringSums {
+  double potential;
+  float max_strain;
+  meshIndex histogram[DIAG_DAMAGE_BINS];
+} SpringSums;
+
+static void resetSpringSums(SpringSums *sums) {
+  sums->potential = 0.0;
+  sums->max_strain = -INFINITY;
+  memset(sums->histogram, 0, sizeof(sums->histogram));
+}
+
+/**
+ * Spring pass of the default update, run by every thread of a team: a thread
+ * adds the forces of its springs in local_acc, acc itself in a team of one
+ * thread, then merges them and its diagnostics in acc and sums as soon as its
+ * springs are done, leaving local_acc zeroed. The master sets springs_end
+ * once its own springs are done, and the team waits for the last merge.
+ */
+static void addSpringForces(Mesh *mesh, meshType type, float delta_t,
+                            Vector **acc, Vector **local_acc,
+                            SpringSums *sums, double *springs_end) {
+  const meshIndex number_springs = mesh->total_springs;
+  const Vector zero = {0.0f, 0.0f, 0.0f};
+  double potential = 0.0;
+  float max_strain = -INFINITY;
+  meshIndex histogram[DIAG_DAMAGE_BINS] = {0};
+
+#pragma omp for nowait
+  for (meshIndex k = 0; k < number_springs; k++) {
+    updateSpring(mesh, k, type, delta_t, local_acc, &potential, &max_strain,
+                 histogram);
+  }
+
+#pragma omp master
+  *springs_end = mesh->profile != NULL ? profileNow() : 0.0;
+
+#pragma omp critical
+  {
+    if (local_acc != acc) {
+      for (int i = 0; i < mesh->n; i++) {
+        for (int j = 0; j < mesh->m; j++) {
+          acc[i][j] = addVector(acc[i][j], local_acc[i][j]);
+          local_acc[i][j] = zero;
+        }
+      }
+    }
+    sums->potential += potential;
+    sums->max_strain = fmaxf(sums->max_strain, max_strain);
+    for (unsigned int b = 0; b < DIAG_DAMAGE_BINS; b++) {
+      sums->histogram[b] += histogram[b];
+    }
+  }
+#pragma omp barrier
+}
+
+/**
+ * `steps` updates of the default mode by a single team of threads, kept
+ * from one update to the next. In an update, the threads go from the spring
+ * pass to the merge of their accelerations without waiting, then through a
+ * single vertex pass (fixed points, external forces and integration); the
+ * bookkeeping between two updates is done by one thread. Below
+ * params.PARALLEL_THRESHOLD points the team has a single thread.
+ */
+static void updateTeam(Mesh *mesh, float delta_t, meshType type,
+                       unsigned int steps) {
+  const Vector zero = {0.0f, 0.0f, 0.0f};
+  Diagnostics *diag = mesh->diagnostics;
+  Vector **acc = getMatrix(mesh->n, mesh->m); // zeroed again by each update
+
+  // Shared by the team, reset between two updates
+  meshIndex springs = 0; // springs updated during the current update
+  double step_start = 0.0, springs_end = 0.0, merge_end = 0.0;
+  double kinetic = 0.0;
+  SpringSums sums;
+  float low[3], high[3];
+
+#pragma omp parallel if (inParallel(mesh))
+  {
+    // A team of one thread works directly on acc
+    bool alone = omp_get_num_threads() == 1;
+    Vector **local_acc = alone ? acc : getMatrix(mesh->n, mesh->m);
+
+    for (unsigned int step = 0; step < steps; step++) {
+#pragma omp single
+      {
+        step_start = mesh->profile != NULL ? profileNow() : 0.0;
+        springs = mesh->n_springs;
+        if (mesh->trace != NULL)
+          traceStepBegin(mesh->trace, springs);
+        mesh->n_broken = 0;
+        kinetic = 0.0;
+        resetSpringSums(&sums);
+        for (int c = 0; c < 3; c++) {
+          low[c] = INFINITY;
+          high[c] = -INFINITY;
+        }
+      }
+
+      addSpringForces(mesh, type, delta_t, acc, local_acc, &sums,
+                      &springs_end);
+
+#pragma omp master
+      merge_end = mesh->profile != NULL ? profileNow() : 0.0;
+
+// Compute position and velocity for every point
+#pragma omp for collapse(2) reduction(+ : kinetic) reduction(min : low[:3])  \
+    reduction(max : high[:3])
+      for (int i = 0; i < mesh->n; i++) {
+        for (int j = 0; j < mesh->m; j++) {
+          if (!isFixedPoint(i, j, mesh, type)) {
+            acc[i][j] = addVector(springAcceleration(mesh, i, j, acc[i][j]),
+                                  externalAcceleration(mesh, type, i, j));
+
+            mesh->V[i][j] =
+                addVector(mesh->V[i][j], multVector(delta_t, acc[i][j]));
+            mesh->P[i][j] =
+                addVector(mesh->P[i][j], multVector(delta_t, mesh->V[i][j]));
+          }
+          acc[i][j] = zero; // for the next update
+          if (diag != NULL)
+            addPointDiagnostics(mesh, i, j, &kinetic, low, high);
+        }
+      }
+
+#pragma omp single
+      {
+        mesh->n_springs -= mesh->n_broken;
+        updateFaceStates(mesh);
+        mesh->t += delta_t;
+        if (diag != NULL) {
+          storeSpringDiagnostics(diag, sums.potential, sums.max_strain,
+                                 sums.histogram);
+          storePointDiagnostics(mesh, kinetic, low, high);
+        }
+
+        if (mesh->profile != NULL) {
+          // The fluid force is timed by each thread, the rest is integration
+          double fluid = profileCollectThreads(mesh->profile);
+          double now = profileNow();
+          profileAdd(mesh->profile, PHASE_SPRINGS, springs_end - step_start);
+          profileAdd(mesh->profile, PHASE_MERGE, merge_end - springs_end);
+          profileAdd(mesh->profile, PHASE_FLUID, fluid);
+          profileAdd(mesh->profile, PHASE_INTEGRATION,
+                     now - merge_end - fluid);
+          profileAdd(mesh->profile, PHASE_STEP, now - step_start);
+          profileEndStep(mesh->profile, springs);
+        }
+        if (mesh->trace != NULL)
+          traceStepEnd(mesh->trace, mesh->n_springs);
+      }
+    }
+
+    if (!alone)
+      freeMatrix(local_acc, mesh->n);
+  }
+
+  freeMatrix(acc, mesh->n);
+}
+
+/**
+ * Compute the next position of the mesh point.
+ */
+void updatePosition(Mesh *mesh, float delta_t, meshType type) {
+  updatePositions(mesh, delta_t, type, 1);
+}
+
+/**
+ * Do `steps` updates. In the default mode they are done by the same team of
+ * threads, see updateTeam. With temporal blocking they are done by blocks of
+ * up to params.TEMPORAL_STEPS, unless the diagnostics or the trace of each
+ * update are recorded, see advanceBlock.
+ */
+void updatePositions(Mesh *mesh, float delta_t, meshType type,
+                     unsigned int steps) {
+  const Params *params = &mesh->params;
+  if (!params->DETERMINISTIC && mesh->tiling == NULL &&
+      mesh->stencil == NULL) {
+    updateTeam(mesh, delta_t, type, steps);
+    return;
+  }
+
+  unsigned int block = 1;
+  if (mesh->temporal != NULL && mesh->diagnostics == NULL &&
+      mesh->trace == NULL)
+    block = mesh->temporal->steps;
+  for (unsigned int step = 0; step < steps;) {
+    unsigned int count = steps - step < block ? steps - step : block;
+    if (count > 1)
+      advanceBlock(mesh, delta_t, type, count);
+    else
+      updateSeparately(mesh, delta_t, type);
+    step += count;
+  }
+}
+
+/**
+ * An update of the deterministic, tiled or stencil mode
+ */
+static void updateSeparately(Mesh *mesh, float delta_t, meshType type) {
+  PROFILE_START(mesh->profile, step_start);
+  meshIndex springs = mesh->n_springs; // springs updated during this step
+  if (mesh->trace != NULL)
+    traceStepBegin(mesh->trace, springs);
+
+  // Kinetic energy and bounding box, reduced over the points
+  Diagnostics *diag = mesh->diagnostics;
+  double kinetic = 0.0;
+  float low[3] = {INFINITY, INFINITY, INFINITY};
+  float high[3] = {-INFINITY, -INFINITY, -INFINITY};
+  mesh->n_broken = 0;
+
+  if (mesh->tiling != NULL) {
+    // Forces and integration tile by tile
+    updateTiles(mesh, type, delta_t, &kinetic, low, high);
+    mesh->n_springs -= mesh->n_broken;
+    updateFaceStates(mesh);
+  } else {
+    Vector **acc = getMatrix(mesh->n, mesh->m); // Acceleration matrix
+
+    // Compute spring forces and update acceleration
+    computeSpringForces(mesh, acc, type, delta_t);
+    mesh->n_springs -= mesh->n_broken;
+    updateFaceStates(mesh);
+
+    // The normals are computed from the positions at the start of the loop,
+    // so the points are moved once every velocity is known
+    PROFILE_START(mesh->profile, vertex_start);
+#pragma omp parallel for collapse(2) if (inParallel(mesh))
+    for (int i = 0; i < mesh->n; i++) {
+      for (int j = 0; j < mesh->m; j++) {
+        if (!isFixedPoint(i, j, mesh, type)) {
+          acc[i][j] = addVector(springAcceleration(mesh, i, j, acc[i][j]),
+                                externalAcceleration(mesh, type, i, j));
+          mesh->V[i][j] =
+              addVector(mesh->V[i][j], multVector(delta_t, acc[i][j]));
+        }
+      }
+    }
+
+#pragma omp parallel for collapse(2) if (inParallel(mesh))                    \
+    reduction(+ : kinetic) reduction(min : low[:3]) reduction(max : high[:3])
+    for (int i = 0; i < mesh->n; i++) {
+      for (int j = 0; j < mesh->m; j++) {
+        if (!isFixedPoint(i, j, mesh, type)) {
+          mesh->P[i][j] =
+              addVector(mesh->P[i][j], multVector(delta_t, mesh->V[i][j]));
+        }
+        if (diag != NULL)
+          addPointDiagnostics(mesh, i, j, &kinetic, low, high);
+      }
+    }
+
+    if (mesh->profile != NULL) {
+      // The fluid force is timed by each thread, the rest is integration
+      double fluid = profileCollectThreads(mesh->profile);
+      profileAdd(mesh->profile, PHASE_FLUID, fluid);
+      profileAdd(mesh->profile, PHASE_INTEGRATION,
+                 profileNow() - vertex_start - fluid);
+    }
+
+    freeMatrix(acc, mesh->n); // Free allocated memory for acceleration matrix
+  }
+  mesh->t += delta_t;
+
+  if (diag != NULL)
+    storePointDiagnostics(mesh, kinetic, low, high);
+
+  if (mesh->profile != NULL) {
+    PROFILE_STOP(mesh->profile, PHASE_STEP, step_start);
+    profileEndStep(mesh->profile, springs);
+  }
+  if (mesh->trace != NULL)
+    traceStepEnd(mesh->trace, mesh->n_springs);
+}
+
+/**
+ * Store the spring diagnostics reduced during the spring loop
+ */
+static void storeSpringDiagnostics(Diagnostics *diag, double potential,
+                                   float max_strain,
+                                   const meshIndex *histogram) {
+  diag->potential_energy = potential;
+  diag->max_strain = max_strain;
+  memcpy(diag->damage_histogram, histogram,
+         DIAG_DAMAGE_BINS * sizeof(meshIndex));
+}
+
+static int compareMeshIndex(const void *a, const void *b) {
+  meshIndex x = *(const meshIndex *)a, y = *(const meshIndex *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Same as computeSpringForces, with a result independent of the number of
+ * threads: the force of every spring is computed first, then each point sums
+ * the forces of its springs in the order of the springs, as a single thread
+ * would do.
+ */
+static void computeSpringForcesDeterministic(Mesh *mesh, Vector **acc,
+                                             meshType type, float delta_t) {
+  const Params *params = &mesh->params;
+  meshIndex number_springs = mesh->total_springs;
+  Vector zero = {0.0f, 0.0f, 0.0f};
+  PROFILE_START(mesh->profile, springs_start);
+
+  // Spring diagnostics, reduced over the springs
+  Diagnostics *diag = mesh->diagnostics;
+  double potential = 0.0;
+  float max_strain = -INFINITY;
+  meshIndex histogram[DIAG_DAMAGE_BINS] = {0};
+
+#pragma omp parallel for schedule(static) if (inParallel(mesh))              \
+    reduction(+ : potential) reduction(max : max_strain)                       \
+    reduction(+ : histogram[:DIAG_DAMAGE_BINS])
+  for (meshIndex k = 0; k < number_springs; k++) {
+    Spring *current = &mesh->springs[k];
+
+    // A broken spring adds +0, which leaves any sum unchanged
+    if (current->isBreak) {
+      mesh->spring_forces[k] = zero;
+      continue;
+    }
+
+    Point A = current->ext_1;
+    Point B = current->ext_2;
+
+    Vector l_i_j_k_l = newVectorFromPoint(mesh->P[B.i][B.j], mesh->P[A.i][A.j]);
+    float current_spring_len = norm(l_i_j_k_l);
+    float original_spring_len =
+        norm(newVectorFromPoint(mesh->P0[A.i][A.j], mesh->P0[B.i][B.j]));
+    float force_magnitude =
+        -current->stiffness * (current_spring_len - original_spring_len);
+    Vector direction = normalize(l_i_j_k_l);
+
+    // Acceleration of A, B gets the opposite
+    mesh->spring_forces[k] =
+        multVector(force_magnitude / params->Mu, direction);
+
+    float strain =
+        (current_spring_len - original_spring_len) / original_spring_len;
+    float potential_energy = 0.5f * current->stiffness *
+                             (current_spring_len - original_spring_len) *
+                             (current_spring_len - original_spring_len);
+
+    // Only this thread handles spring k
+    current->damage += strain * delta_t;
+    if (diag != NULL)
+      addSpringDiagnostics(mesh, current->damage, strain, potential_energy,
+                           &potential, &max_strain, histogram);
+
+    const Params *breaking = breakingParams(mesh, current);
+    if (potential_energy > breaking->ENERGY_THRESHOLD ||
+        current->damage > breaking->DAMAGE_THRESHOLD) {
+      current->isBreak = true;
+      meshIndex slot;
+#pragma omp atomic capture
+      slot = mesh->n_broken++;
+      mesh->broken_springs[slot] = k;
+      TRACE_EVENT(mesh->trace, TRACE_SPRING_BREAK, k, 0, potential_energy,
+                  current->damage);
+    }
+  }
+
+  double springs_end = mesh->profile != NULL ? profileNow() : 0.0;
+
+  // Each point gathers the forces of its springs, by increasing index
+#pragma omp parallel for collapse(2) schedule(static) if (inParallel(mesh))
+  for (int i = 0; i < mesh->n; i++) {
+    for (int j = 0; j < mesh->m; j++) {
+      if (isFixedPoint(i, j, mesh, type))
+        continue;
+
+      unsigned int point = i * mesh->m + j;
+      for (meshIndex s = mesh->point_springs_start[point];
+           s < mesh->point_springs_start[point + 1]; s++) {
+        meshIndex k = mesh->point_springs[s] >> 1;
+        Vector force = mesh->spring_forces[k];
+        if (mesh->point_springs[s] & 1) // the point is ext_2
+          force = multVector(-1.0f, force);
+        acc[i][j] = addVector(acc[i][j], force);
+      }
+    }
+  }
+
+  // The breaks are listed in the order of the springs
+  qsort(mesh->broken_springs, mesh->n_broken, sizeof(meshIndex),
+        compareMeshIndex);
+
+  if (diag != NULL)
+    storeSpringDiagnostics(diag, potential, max_strain, histogram);
+
+  if (mesh->profile != NULL) {
+    profileAdd(mesh->profile, PHASE_SPRINGS, springs_end - springs_start);
+    profileAdd(mesh->profile, PHASE_MERGE, profileNow() - springs_end);
+  }
+}
+
+/**
+ * Compute the forces of the springs of the stencil, one direction after the
+ * other: the force of the spring leaving every point is computed, then every
+ * point adds it and the opposite of the force of the spring ending on it.
+ * The damage, broken bits and points are read in order, and the result does
+ * not depend on the number of threads.
+ */
+static void computeSpringForcesStencil(Mesh *mesh, Vector **acc,
+                                       meshType type, float delta_t) {
+  const Params *params = &mesh->params;
+  Stencil *stencil = mesh->stencil;
+  const int n = mesh->n, m = mesh->m;
+  const Vector zero = {0.0f, 0.0f, 0.0f};
+  PROFILE_START(mesh->profile, springs_start);
+
+  // Spring diagnostics, reduced over the springs
+  Diagnostics *diag = mesh->diagnostics;
+  double potential = 0.0;
+  float max_strain = -INFINITY;
+  meshIndex histogram[DIAG_DAMAGE_BINS] = {0};
+
+#pragma omp parallel if (inParallel(mesh)) reduction(+ : potential)          \
+    reduction(max : max_strain) reduction(+ : histogram[:DIAG_DAMAGE_BINS])
+  for (unsigned int d = 0; d < STENCIL_DIRECTIONS; d++) {
+    const int di = STENCIL_OFFSET[d][0], dj = STENCIL_OFFSET[d][1];
+    const float stiffness = stencilStiffness(params, d);
+    float *damage = stencil->damage + (size_t)d * n * m;
+    Vector *force = stencil->force;
+
+#pragma omp for collapse(2) schedule(static)
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < m; j++) {
+        unsigned int p = i * m + j;
+        int k = i + di, l = j + dj; // other end of the spring
+        force[p] = zero;
+        if (k < 0 || k >= n || l >= m || STENCIL_BROKEN(stencil, d, p))
+          continue;
+
+        Vector l_i_j_k_l = newVectorFromPoint(mesh->P[k][l], mesh->P[i][j]);
+        float current_spring_len = norm(l_i_j_k_l);
+        float original_spring_len =
+            norm(newVectorFromPoint(mesh->P0[i][j], mesh->P0[k][l]));
+        float elongation = current_spring_len - original_spring_len;
+        force[p] = multVector(-stiffness * elongation / params->Mu,
+                              normalize(l_i_j_k_l));
+
+        float strain = elongation / original_spring_len;
+        float potential_energy = 0.5f * stiffness * elongation * elongation;
+        damage[p] += strain * delta_t;
+        if (diag != NULL)
+          addSpringDiagnostics(mesh, damage[p], strain, potential_energy,
+                               &potential, &max_strain, histogram);
+
+        if (potential_energy > params->ENERGY_THRESHOLD ||
+            damage[p] > params->DAMAGE_THRESHOLD) {
+          stencilBreak(stencil, d, p);
+          meshIndex slot;
+#pragma omp atomic capture
+          slot = mesh->n_broken++;
+          mesh->broken_springs[slot] = (meshIndex)d * n * m + p;
+          TRACE_EVENT(mesh->trace, TRACE_SPRING_BREAK, d * n * m + p, 0,
+                      potential_energy, damage[p]);
+        }
+      }
+    }
+
+    // The forces of the direction are all known after the implicit barrier
+#pragma omp for collapse(2) schedule(static)
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < m; j++) {
+        if (isFixedPoint(i, j, mesh, type))
+          continue;
+        acc[i][j] = addVector(acc[i][j], force[i * m + j]);
+        int k = i - di, l = j - dj; // start of the spring ending on (i, j)
+        if (k >= 0 && k < n && l >= 0)
+          acc[i][j] =
+              addVector(acc[i][j], multVector(-1.0f, force[k * m + l]));
+      }
+    }
+  }
+
+  // The breaks are listed in the order of the springs
+  qsort(mesh->broken_springs, mesh->n_broken, sizeof(meshIndex),
+        compareMeshIndex);
+
+  if (diag != NULL)
+    storeSpringDiagnostics(diag, potential, max_strain, histogram);
+
+  PROFILE_STOP(mesh->profile, PHASE_SPRINGS, springs_start);
+}
+
+/**
+ * Spring forces, external forces and integration tile by tile. Every thread
+ * computes the forces of its tiles in their buffers, then, after a single
+ * barrier, moves the points of the same tiles, each one getting the sum of
+ * the buffers of the tiles around it. The positions are only read before
+ * the barrier and only written after it, and the sums are done in the same
+ * order whatever the number of threads.
+ */
+static void updateTiles(Mesh *mesh, meshType type, float delta_t,
+                        double *kinetic, float *low, float *high) {
+  const Params *params = &mesh->params;
+  const Tiling *tiling = mesh->tiling;
+  const int size = tiling->size, pitch = tiling->pitch;
+  const int rows = tiling->rows, cols = tiling->cols;
+  const int n = mesh->n, m = mesh->m;
+  PROFILE_START(mesh->profile, forces_start);
+  double forces_end = 0.0;
+
+  // Diagnostics, reduced over the springs then over the points
+  Diagnostics *diag = mesh->diagnostics;
+  double potential = 0.0, kinetic_sum = 0.0;
+  float max_strain = -INFINITY;
+  meshIndex histogram[DIAG_DAMAGE_BINS] = {0};
+  float lo[3] = {low[0], low[1], low[2]};
+  float hi[3] = {high[0], high[1], high[2]};
+
+#pragma omp parallel if (inParallel(mesh))
+  {
+#pragma omp for schedule(static) reduction(+ : potential)                     \
+    reduction(max : max_strain) reduction(+ : histogram[:DIAG_DAMAGE_BINS])
+    for (int t = 0; t < rows * cols; t++) {
+      Vector *acc = tileBuffer(tiling, t);
+      int i0 = t / cols * size, j0 = t % cols * size;
+      memset(acc, 0, (size_t)pitch * pitch * sizeof(Vector));
+
+      // Springs anchored in the tile, their other end may be in the halo
+      for (meshIndex s = tiling->springs_start[t];
+           s < tiling->springs_start[t + 1]; s++) {
+        meshIndex k = tiling->springs[s];
+        Spring *current = &mesh->springs[k];
+        if (current->isBreak)
+          continue;
+
+        Point A = current->ext_1;
+        Point B = current->ext_2;
+        Vector l_i_j_k_l =
+            newVectorFromPoint(mesh->P[B.i][B.j], mesh->P[A.i][A.j]);
+        float current_spring_len = norm(l_i_j_k_l);
+        float original_spring_len =
+            norm(newVectorFromPoint(mesh->P0[A.i][A.j], mesh->P0[B.i][B.j]));
+        float force_magnitude =
+            -current->stiffness * (current_spring_len - original_spring_len);
+        Vector force = multVector(force_magnitude / params->Mu,
+                                  normalize(l_i_j_k_l));
+
+        Vector *acc_a = &acc[((int)A.i - i0 + TILE_HALO) * pitch +
+                             (int)A.j - j0 + TILE_HALO];
+        Vector *acc_b = &acc[((int)B.i - i0 + TILE_HALO) * pitch +
+                             (int)B.j - j0 + TILE_HALO];
+        *acc_a = addVector(*acc_a, force);
+        *acc_b = addVector(*acc_b, multVector(-1.0f, force));
+
+        float strain =
+            (current_spring_len - original_spring_len) / original_spring_len;
+        float potential_energy = 0.5f * current->stiffness *
+                                 (current_spring_len - original_spring_len) *
+                                 (current_spring_len - original_spring_len);
+
+        // Only the owner of the tile handles spring k
+        current->damage += strain * delta_t;
+        if (diag != NULL)
+          addSpringDiagnostics(mesh, current->damage, strain,
+                               potential_energy, &potential, &max_strain,
+                               histogram);
+
+        if (potential_energy > params->ENERGY_THRESHOLD ||
+            current->damage > params->DAMAGE_THRESHOLD) {
+          current->isBreak = true;
+          meshIndex slot;
+#pragma omp atomic capture
+          slot = mesh->n_broken++;
+          mesh->broken_springs[slot] = k;
+          TRACE_EVENT(mesh->trace, TRACE_SPRING_BREAK, k, 0, potential_energy,
+                      current->damage);
+        }
+      }
+
+      // The other forces, while no point has moved yet
+      for (int i = i0; i < i0 + size && i < n; i++) {
+        for (int j = j0; j < j0 + size && j < m; j++) {
+          if (isFixedPoint(i, j, mesh, type))
+            continue;
+          Vector *acc_p =
+              &acc[(i - i0 + TILE_HALO) * pitch + j - j0 + TILE_HALO];
+          *acc_p = addVector(*acc_p, externalAcceleration(mesh, type, i, j));
+        }
+      }
+    }
+
+#pragma omp master
+    forces_end = mesh->profile != NULL ? profileNow() : 0.0;
+
+    // Same schedule, each thread moves the points of its tiles
+#pragma omp for schedule(static) reduction(+ : kinetic_sum)                   \
+    reduction(min : lo[:3]) reduction(max : hi[:3])
+    for (int t = 0; t < rows * cols; t++) {
+      int ti = t / cols, tj = t % cols;
+      for (int i = ti * size; i < (ti + 1) * size && i < n; i++) {
+        for (int j = tj * size; j < (tj + 1) * size && j < m; j++) {
+          if (!isFixedPoint(i, j, mesh, type)) {
+            // The halos of the tiles around reach the points near the edges
+            Vector a = {0.0f, 0.0f, 0.0f};
+            for (int ni = ti - 1; ni <= ti + 1; ni++) {
+              for (int nj = tj - 1; nj <= tj + 1; nj++) {
+                int li = i - ni * size + TILE_HALO;
+                int lj = j - nj * size + TILE_HALO;
+                if (ni < 0 || ni >= rows || nj < 0 || nj >= cols || li < 0 ||
+                    li >= pitch || lj < 0 || lj >= pitch)
+                  continue;
+                a = addVector(a,
+                              tileBuffer(tiling, ni * cols + nj)[li * pitch +
+                                                                  lj]);
+              }
+            }
+            mesh->V[i][j] = addVector(mesh->V[i][j], multVector(delta_t, a));
+            mesh->P[i][j] =
+                addVector(mesh->P[i][j], multVector(delta_t, mesh->V[i][j]));
+          }
+          if (diag != NULL)
+            addPointDiagnostics(mesh, i, j, &kinetic_sum, lo, hi);
+        }
+      }
+    }
+  }
+
+  // The breaks are listed in the order of the springs
+  qsort(mesh->broken_springs, mesh->n_broken, sizeof(meshIndex),
+        compareMeshIndex);
+
+  *kinetic = kinetic_sum;
+  for (int c = 0; c < 3; c++) {
+    low[c] = lo[c];
+    high[c] = hi[c];
+  }
+  if (diag != NULL)
+    storeSpringDiagnostics(diag, potential, max_strain, histogram);
+
+  if (mesh->profile != NULL) {
+    // The fluid force is timed by each thread within the forces
+    double fluid = profileCollectThreads(mesh->profile);
+    profileAdd(mesh->profile, PHASE_SPRINGS,
+               forces_end - forces_start - fluid);
+    profileAdd(mesh->profile, PHASE_FLUID, fluid);
+    profileAdd(mesh->profile, PHASE_INTEGRATION, profileNow() - forces_end);
+  }
+}
+
+/**
+ * True if the point p is in the region
+ */
+static inline bool inRegion(const Region *region, Point p) {
+  return p.i >= region->i0 && p.i < region->i1 && p.j >= region->j0 &&
+         p.j < region->j1;
+}
+
+/**
+ * Place of the spring k, whose ext_1 is on the line i, in the scratch
+ */
+static inline meshIndex scratchSpring(const TemporalScratch *scratch,
+                                      unsigned int i, meshIndex k) {
+  unsigned int r = i - scratch->region.i0;
+  return scratch->offset[r] + (k - scratch->first[r]);
+}
+
+/**
+ * Place in the scratch of the spring k ending on the line i: its ext_1 is on
+ * the line after, or on one of the TEMPORAL_HALO lines before or on the
+ * line i, the last one whose springs in the scratch start at k or before
+ */
+static inline meshIndex scratchSpringEnding(const TemporalScratch *scratch,
+                                            unsigned int i, meshIndex k) {
+  const Region *region = &scratch->region;
+  unsigned int r = i + 1 < region->i1 ? i + 1 - region->i0 : i - region->i0;
+  while (r > 0 && scratch->first[r] > k)
+    r--;
+  return scratch->offset[r] + (k - scratch->first[r]);
+}
+
+/**
+ * Advance the tile t `steps` updates in the scratch of the calling thread,
+ * view being the mesh whose points are those of the scratch, and keep its
+ * points and springs in mesh->temporal. The update u computes the points up
+ * to (steps - u - 1) * TEMPORAL_HALO around the tile from those up to
+ * (steps - u) * TEMPORAL_HALO, so the tile ends where the whole grid would
+ * be after `steps` updates of the deterministic mode. Each point and spring
+ * is computed by the same operations in the same order as in this mode.
+ */
+static void advanceTile(Mesh *mesh, Mesh *view, TemporalScratch *scratch,
+                        unsigned int t, meshType type, float delta_t,
+                        unsigned int steps) {
+  const Params *params = &mesh->params;
+  TemporalBlocking *temporal = mesh->temporal;
+  const unsigned int n = mesh->n, m = mesh->m;
+  const Vector zero = {0.0f, 0.0f, 0.0f};
+
+  // The points and springs of the tile and of its halo at the start
+  Region outer = tileRegion(temporal, t, steps * TEMPORAL_HALO, n, m);
+  setScratchRegion(scratch, outer, n, m);
+  size_t width = (outer.j1 - outer.j0) * sizeof(Vector);
+  for (unsigned int i = outer.i0; i < outer.i1; i++) {
+    memcpy(&view->P[i][outer.j0], &mesh->P[i][outer.j0], width);
+    memcpy(&view->V[i][outer.j0], &mesh->V[i][outer.j0], width);
+    meshIndex l = scratchSpring(scratch, i, scratch->first[i - outer.i0]);
+    meshIndex end = firstSpringOf(i, outer.j1, n, m);
+    for (meshIndex k = scratch->first[i - outer.i0]; k < end; k++, l++) {
+      scratch->damage[l] = mesh->springs[k].damage;
+      scratch->broken[l] = mesh->springs[k].isBreak;
+    }
+  }
+
+  for (unsigned int u = 0; u < steps; u++) {
+    Region from = tileRegion(temporal, t, (steps - u) * TEMPORAL_HALO, n, m);
+    Region to = tileRegion(temporal, t, (steps - u - 1) * TEMPORAL_HALO, n, m);
+
+    // The springs reaching a point of `to`, whose ext_1 is in `from`
+    for (unsigned int i = from.i0; i < from.i1; i++) {
+      meshIndex end = firstSpringOf(i, from.j1, n, m);
+      for (meshIndex k = firstSpringOf(i, from.j0, n, m); k < end; k++) {
+        const Spring *current = &mesh->springs[k];
+        Point A = current->ext_1;
+        Point B = current->ext_2;
+        if (!inRegion(&to, A) && !inRegion(&to, B))
+          continue;
+
+        meshIndex l = scratchSpring(scratch, i, k);
+        if (scratch->broken[l]) {
+          scratch->forces[l] = zero;
+          continue;
+        }
+
+        Vector l_i_j_k_l =
+            newVectorFromPoint(view->P[B.i][B.j], view->P[A.i][A.j]);
+        float current_spring_len = norm(l_i_j_k_l);
+        float original_spring_len =
+            norm(newVectorFromPoint(mesh->P0[A.i][A.j], mesh->P0[B.i][B.j]));
+        float force_magnitude =
+            -current->stiffness * (current_spring_len - original_spring_len);
+        Vector direction = normalize(l_i_j_k_l);
+        scratch->forces[l] =
+            multVector(force_magnitude / params->Mu, direction);
+
+        float strain =
+            (current_spring_len - original_spring_len) / original_spring_len;
+        float potential_energy = 0.5f * current->stiffness *
+                                 (current_spring_len - original_spring_len) *
+                                 (current_spring_len - original_spring_len);
+        scratch->damage[l] += strain * delta_t;
+        if (potential_energy > params->ENERGY_THRESHOLD ||
+            scratch->damage[l] > params->DAMAGE_THRESHOLD) {
+          scratch->broken[l] = true;
+
+          // Only the tile of ext_1 reports the break
+          if (A.i / temporal->size * temporal->cols + A.j / temporal->size ==
+              t) {
+            meshIndex slot;
+#pragma omp atomic capture
+            slot = mesh->n_broken++;
+            mesh->broken_springs[slot] = k;
+#pragma omp atomic
+            temporal->broken_at[u]++;
+          }
+        }
+      }
+    }
+
+    // Velocities, the points summing the forces of their springs in order
+    for (unsigned int i = to.i0; i < to.i1; i++) {
+      for (unsigned int j = to.j0; j < to.j1; j++) {
+        if (isFixedPoint(i, j, view, type))
+          continue;
+
+        Vector acc = zero;
+        unsigned int point = i * m + j;
+        for (meshIndex s = mesh->point_springs_start[point];
+             s < mesh->point_springs_start[point + 1]; s++) {
+          meshIndex k = mesh->point_springs[s] >> 1;
+          Vector force;
+          if (mesh->point_springs[s] & 1) { // the point is ext_2
+            force = scratch->forces[scratchSpringEnding(scratch, i, k)];
+            force = multVector(-1.0f, force);
+          } else {
+            force = scratch->forces[scratchSpring(scratch, i, k)];
+          }
+          acc = addVector(acc, force);
+        }
+        acc = addVector(springAcceleration(view, i, j, acc),
+                        externalAcceleration(view, type, i, j));
+        view->V[i][j] = addVector(view->V[i][j], multVector(delta_t, acc));
+      }
+    }
+
+    // Then the positions
+    for (unsigned int i = to.i0; i < to.i1; i++) {
+      for (unsigned int j = to.j0; j < to.j1; j++) {
+        if (!isFixedPoint(i, j, view, type))
+          view->P[i][j] =
+              addVector(view->P[i][j], multVector(delta_t, view->V[i][j]));
+      }
+    }
+  }
+
+  // The points of the tile and the springs it owns
+  Region tile = tileRegion(temporal, t, 0, n, m);
+  width = (tile.j1 - tile.j0) * sizeof(Vector);
+  for (unsigned int i = tile.i0; i < tile.i1; i++) {
+    memcpy(&temporal->P[i][tile.j0], &view->P[i][tile.j0], width);
+    memcpy(&temporal->V[i][tile.j0], &view->V[i][tile.j0], width);
+    meshIndex end = firstSpringOf(i, tile.j1, n, m);
+    for (meshIndex k = firstSpringOf(i, tile.j0, n, m); k < end; k++) {
+      meshIndex l = scratchSpring(scratch, i, k);
+      temporal->damage[k] = scratch->damage[l];
+      temporal->broken[k] = scratch->broken[l];
+    }
+  }
+}
+
+/**
+ * `steps` updates of the deterministic mode, each tile being advanced
+ * through all of them at once, see advanceTile. The tiles read the state at
+ * the start of the block, which is replaced once they are all done. The
+ * diagnostics and the trace are not recorded, and each update is timed as
+ * an equal share of the block.
+ */
+static void advanceBlock(Mesh *mesh, float delta_t, meshType type,
+                         unsigned int steps) {
+  PROFILE_START(mesh->profile, block_start);
+  TemporalBlocking *temporal = mesh->temporal;
+  const unsigned int n_tiles = temporal->rows * temporal->cols;
+  meshIndex springs = mesh->n_springs;
+  mesh->n_broken = 0;
+  memset(temporal->broken_at, 0, steps * sizeof(meshIndex));
+
+#pragma omp parallel if (inParallel(mesh))
+  {
+    TemporalScratch *scratch = newTemporalScratch(temporal, mesh->n, mesh->m);
+    Mesh view = *mesh;
+    view.P = scratch->P;
+    view.V = scratch->V;
+    view.profile = NULL;
+
+#pragma omp for schedule(dynamic)
+    for (unsigned int t = 0; t < n_tiles; t++) {
+      advanceTile(mesh, &view, scratch, t, type, delta_t, steps);
+    }
+    freeTemporalScratch(scratch);
+  }
+
+  // The state at the end of the block replaces the one at its start
+  Vector **P = mesh->P, **V = mesh->V;
+  mesh->P = temporal->P;
+  mesh->V = temporal->V;
+  temporal->P = P;
+  temporal->V = V;
+#pragma omp parallel for schedule(static) if (inParallel(mesh))
+  for (meshIndex k = 0; k < mesh->total_springs; k++) {
+    mesh->springs[k].damage = temporal->damage[k];
+    mesh->springs[k].isBreak = temporal->broken[k];
+  }
+
+  // The breaks are listed in the order of the springs
+  qsort(mesh->broken_springs, mesh->n_broken, sizeof(meshIndex),
+        compareMeshIndex);
+  mesh->n_springs -= mesh->n_broken;
+  updateFaceStates(mesh);
+  for (unsigned int u = 0; u < steps; u++) {
+    mesh->t += delta_t;
+  }
+
+  if (mesh->profile != NULL) {
+    double share = (profileNow() - block_start) / steps;
+    for (unsigned int u = 0; u < steps; u++) {
+      profileAdd(mesh->profile, PHASE_STEP, share);
+      profileEndStep(mesh->profile, springs);
+      springs -= temporal->broken_at[u];
+    }
+  }
+}
+
+/**
+ * Initialize the mesh with the triangles and quads of an OBJ file, its
+ * points being reordered with the policy, see surface.h. The points are the
+ * line 0 of the mesh, and the highest ones are fixed whatever the type, which
+ * only gives the forces. Return -1, and log why, if the file can not be used.
+ */
+int initMeshFromObj(Mesh *mesh, meshType type, const Params *params,
+                    const char *filename, reorderPolicy policy) {
+  if (params->TILE_SIZE > 0 || params->TEMPORAL_STEPS > 1 ||
+      params->STENCIL) {
+    log_error("An imported mesh has no grid for the tiles or the stencil");
+    return -1;
+  }
+  Vector *points;
+  Surface *surface = readObj(filename, &points);
+  if (surface == NULL)
+    return -1;
+  reorderSurface(surface, points, policy);
+
+  const unsigned int M = surface->n_points;
+  mesh->params = *params;
+  mesh->params.N = 1;
+  mesh->params.M = M;
+  mesh->profile = NULL;
+  mesh->diagnostics = NULL;
+  mesh->trace = NULL;
+  mesh->tiling = NULL;
+  mesh->temporal = NULL;
+  mesh->stencil = NULL;
+  mesh->surface = surface;
+  mesh->refinement = NULL;
+  mesh->mass = NULL;
+  mesh->scene = NULL;
+  mesh->i0 = 0;
+  mesh->j0 = 0;
+  mesh->n = 1;
+  mesh->m = M;
+  mesh->t = 0.0f;
+
+  mesh->P = getMatrix(1, M);
+  mesh->P0 = getMatrix(1, M);
+  mesh->V = getMatrix(1, M);
+#pragma omp parallel for schedule(static)
+  for (unsigned int j = 0; j < M; j++) {
+    mesh->P[0][j] = points[j];
+    mesh->P0[0][j] = points[j];
+    mesh->V[0][j] = newVector(0.0f, 0.0f, 0.0f);
+  }
+  free(points);
+
+  meshIndex nb_springs =
+      surfaceSprings(surface, params, &mesh->springs, &mesh->face_springs);
+  mesh->total_springs = nb_springs;
+  mesh->n_springs = nb_springs;
+  mesh->broken_springs =
+      (meshIndex *)malloc(nb_springs * sizeof(meshIndex));
+  mesh->n_broken = 0;
+  newFaceStates(mesh, surface->n_faces);
+  linkSpringFaces(mesh, SPRINGS_PER_FACE);
+
+  mesh->point_springs_start = NULL;
+  mesh->point_springs = NULL;
+  mesh->spring_forces = NULL;
+  if (params->DETERMINISTIC)
+    listPointSprings(mesh, nb_springs);
+
+  log_info("%s: %u points, %u faces, %" PRI_MESH_INDEX " springs, %s order",
+           filename, M, surface->n_faces, nb_springs,
+           reorderPolicyName(policy));
+  return 0;
+}
+
+/**
+ * Line and column in the grid of params of the point i, j, fractions for
+ * the points of a refined grid
+ */
+static void gridCoordinates(const Mesh *mesh, unsigned int i, unsigned int j,
+                            float *gi, float *gj) {
+  const Refinement *refinement = mesh->refinement;
+  if (refinement == NULL) {
+    *gi = i + mesh->i0;
+    *gj = j + mesh->j0;
+    return;
+  }
+  const float side = (float)(1u << refinement->levels);
+  *gi = (refinement->points[j] / refinement->m) / side;
+  *gj = (refinement->points[j] % refinement->m) / side;
+}
+
+/**
+ * Build the points, springs and faces of the mesh from its refinement. The
+ * positions, velocities and damage of the mesh being replaced, if any, are
+ * carried to the new one, see carryPoints and carrySprings.
+ */
+static void buildAdaptiveMesh(Mesh *mesh, meshType type) {
+  const Refinement *refinement = mesh->refinement;
+  const Params *params = &mesh->params;
+  const unsigned int M = refinement->n_points;
+  const float spacing = params->SPACING / (1u << refinement->levels);
+  Vector origin = {0.0f, 0.0f, 0.0f};
+
+  Vector **P = getMatrix(1, M);
+  Vector **P0 = getMatrix(1, M);
+  Vector **V = getMatrix(1, M);
+  for (unsigned int j = 0; j < M; j++) {
+    unsigned int k = refinement->points[j];
+    P0[0][j] = initialPosition(type, origin, spacing, k / refinement->m,
+                               k % refinement->m);
+  }
+  if (mesh->P != NULL) {
+    carryPoints(refinement, mesh->P[0], mesh->V[0], P[0], V[0]);
+    freeMatrix(mesh->P, mesh->n);
+    freeMatrix(mesh->P0, mesh->n);
+    freeMatrix(mesh->V, mesh->n);
+  } else {
+    memcpy(P[0], P0[0], M * sizeof(Vector));
+  }
+  mesh->P = P;
+  mesh->P0 = P0;
+  mesh->V = V;
+  mesh->m = M;
+  free(mesh->mass);
+  mesh->mass = (float *)malloc(M * sizeof(float));
+  refinementMasses(refinement, mesh->mass);
+
+  freeSurface(mesh->surface);
+  mesh->surface = refinementSurface(refinement);
+  for (unsigned int j = 0; j < M; j++) {
+    float gi, gj;
+    gridCoordinates(mesh, 0, j, &gi, &gj);
+    mesh->surface->fixed[j] = isFixedAt(type, params, gi, gj, P0[0][j]);
+  }
+
+  Spring *springs;
+  free(mesh->face_springs);
+  meshIndex nb_springs =
+      refinementSprings(refinement, params, &springs, &mesh->face_springs);
+  if (mesh->springs != NULL)
+    carrySprings(refinement, springs, nb_springs, mesh->springs,
+                 mesh->total_springs);
+  free(mesh->springs);
+  mesh->springs = springs;
+  mesh->total_springs = nb_springs;
+
+  // The broken springs stay broken, and their faces too
+  free(mesh->broken_springs);
+  free(mesh->spring_faces);
+  free(mesh->broken_faces);
+  mesh->broken_springs =
+      (meshIndex *)malloc(nb_springs * sizeof(meshIndex));
+  newFaceStates(mesh, mesh->surface->n_faces);
+  linkSpringFaces(mesh, SPRINGS_PER_FACE);
+  mesh->n_broken = 0;
+  for (meshIndex k = 0; k < nb_springs; k++) {
+    if (springs[k].isBreak)
+      mesh->broken_springs[mesh->n_broken++] = k;
+  }
+  mesh->n_springs = nb_springs - mesh->n_broken;
+  updateFaceStates(mesh);
+  mesh->n_broken = 0;
+
+  free(mesh->point_springs_start);
+  free(mesh->point_springs);
+  free(mesh->spring_forces);
+  mesh->point_springs_start = NULL;
+  mesh->point_springs = NULL;
+  mesh->spring_forces = NULL;
+  if (params->DETERMINISTIC)
+    listPointSprings(mesh, nb_springs);
+}
+
+/**
+ * Initialize the mesh with the grid of params, whose faces are then split
+ * where the cloth folds or stretches, see adaptMesh. The points are the line
+ * 0 of the mesh, and params keeps the size of the grid.
+ */
+int initMeshAdaptive(Mesh *mesh, meshType type, const Params *params) {
+  if (params->TILE_SIZE > 0 || params->TEMPORAL_STEPS > 1 ||
+      params->STENCIL) {
+    log_error("A refined grid has no tiles or stencil");
+    return -1;
+  }
+  if (type != CURTAIN && type != TABLE_CLOTH && type != SOFT && type != FLAG) {
+    log_error("Type of mesh not handled");
+    return -1;
+  }
+
+  mesh->params = *params;
+  mesh->profile = NULL;
+  mesh->diagnostics = NULL;
+  mesh->trace = NULL;
+  mesh->tiling = NULL;
+  mesh->temporal = NULL;
+  mesh->stencil = NULL;
+  mesh->surface = NULL;
+  mesh->refinement =
+      newRefinement(params->N, params->M, params->REFINE_LEVELS);
+  mesh->mass = NULL;
+  mesh->scene = NULL;
+  mesh->i0 = 0;
+  mesh->j0 = 0;
+  mesh->n = 1;
+  mesh->m = 0;
+  mesh->t = 0.0f;
+  mesh->P = NULL;
+  mesh->P0 = NULL;
+  mesh->V = NULL;
+  mesh->springs = NULL;
+  mesh->total_springs = 0;
+  mesh->broken_springs = NULL;
+  mesh->point_springs_start = NULL;
+  mesh->point_springs = NULL;
+  mesh->spring_forces = NULL;
+  mesh->face_springs = NULL;
+  mesh->spring_faces = NULL;
+  mesh->broken_faces = NULL;
+  buildAdaptiveMesh(mesh, type);
+  return 0;
+}
+
+/**
+ * Split the faces of a refined mesh where it folds or stretches, and merge
+ * them back where it relaxed, see adaptRefinement. The points and springs
+ * are rebuilt if a face changed, which is then returned true.
+ */
+bool adaptMesh(Mesh *mesh, meshType type) {
+  if (mesh->refinement == NULL ||
+      !adaptRefinement(mesh->refinement, mesh->surface, mesh->P[0],
+                       mesh->P0[0], mesh->springs, mesh->face_springs,
+                       mesh->broken_faces, &mesh->params))
+    return false;
+  buildAdaptiveMesh(mesh, type);
+  return true;
+}
+
+/**
+ * Initialize the mesh with n_bodies grids, the body b being of the type
+ * types[b] with the params params[b] and moved by offsets[b]. Their points,
+ * springs and faces are packed in those of the mesh, see Scene, which keeps
+ * the params of the first body for the update.
+ */
+int initMeshScene(Mesh *mesh, unsigned int n_bodies, const meshType *types,
+                  const Params *params, const Vector *offsets) {
+  for (unsigned int b = 0; b < n_bodies; b++) {
+    if (params[b].TILE_SIZE > 0 || params[b].TEMPORAL_STEPS > 1 ||
+        params[b].STENCIL) {
+      log_error("A scene has no grid for the tiles or the stencil");
+      return -1;
+    }
+    if (!checkGridParams(types[b], &params[b]))
+      return -1;
+  }
+
+  Scene *scene = (Scene *)malloc(sizeof(Scene));
+  scene->n_bodies = n_bodies;
+  scene->bodies = (Body *)malloc(n_bodies * sizeof(Body));
+  unsigned int n_points = 0;
+  meshIndex n_springs = 0, n_faces = 0;
+  for (unsigned int b = 0; b < n_bodies; b++) {
+    Body *body = &scene->bodies[b];
+    body->type = types[b];
+    body->mesh = (Mesh *)malloc(sizeof(Mesh));
+    initMesh(body->mesh, types[b], &params[b]); // checked above
+    body->first_point = n_points;
+    body->first_spring = n_springs;
+    body->first_face = n_faces;
+    n_points += body->mesh->n * body->mesh->m;
+    n_springs += body->mesh->total_springs;
+    n_faces += body->mesh->n_faces;
+  }
+  scene->point_body = (unsigned int *)malloc(n_points * sizeof(unsigned int));
+
+  const unsigned int M = n_points;
+  mesh->params = params[0];
+  mesh->params.N = 1;
+  mesh->params.M = M;
+  mesh->profile = NULL;
+  mesh->diagnostics = NULL;
+  mesh->trace = NULL;
+  mesh->tiling = NULL;
+  mesh->temporal = NULL;
+  mesh->stencil = NULL;
+  mesh->refinement = NULL;
+  mesh->mass = NULL;
+  mesh->scene = scene;
+  mesh->i0 = 0;
+  mesh->j0 = 0;
+  mesh->n = 1;
+  mesh->m = M;
+  mesh->t = 0.0f;
+  mesh->P = getMatrix(1, M);
+  mesh->P0 = getMatrix(1, M);
+  mesh->V = getMatrix(1, M);
+  mesh->springs = (Spring *)malloc(n_springs * sizeof(Spring));
+  mesh->total_springs = n_springs;
+  mesh->n_springs = n_springs;
+  mesh->broken_springs =
+      (meshIndex *)malloc(n_springs * sizeof(meshIndex));
+  mesh->n_broken = 0;
+  mesh->face_springs = (meshIndex *)malloc(
+      (size_t)n_faces * SPRINGS_PER_FACE * sizeof(meshIndex));
+
+  // The faces of the grids are those of a surface, so that the scene is
+  // written and drawn as an imported mesh
+  Surface *surface = (Surface *)calloc(1, sizeof(Surface));
+  surface->n_points = M;
+  surface->n_faces = n_faces;
+  surface->faces = malloc(n_faces * sizeof(*surface->faces));
+  surface->fixed = (bool *)malloc(M * sizeof(bool));
+  mesh->surface = surface;
+
+  bool same_mass = true;
+  for (unsigned int b = 0; b < n_bodies; b++) {
+    const Body *body = &scene->bodies[b];
+    Mesh *view = body->mesh;
+    const unsigned int n = view->n, m = view->m;
+
+    // The fixed points are found before the grid is moved
+    for (unsigned int i = 0; i < n; i++) {
+      for (unsigned int j = 0; j < m; j++) {
+        unsigned int p = body->first_point + i * m + j;
+        surface->fixed[p] = isFixedPoint(i, j, view, body->type);
+        mesh->P[0][p] = addVector(view->P[i][j], offsets[b]);
+        mesh->P0[0][p] = addVector(view->P0[i][j], offsets[b]);
+        mesh->V[0][p] = view->V[i][j];
+        scene->point_body[p] = b;
+      }
+    }
+
+    for (meshIndex k = 0; k < view->total_springs; k++) {
+      Spring spring = view->springs[k];
+      spring.ext_1 = (Point){0, body->first_point + spring.ext_1.i * m +
+                                    spring.ext_1.j};
+      spring.ext_2 = (Point){0, body->first_point + spring.ext_2.i * m +
+                                    spring.ext_2.j};
+      mesh->springs[body->first_spring + k] = spring;
+    }
+
+    for (meshIndex f = 0; f < view->n_faces; f++) {
+      unsigned int i = f / (m - 1), j = f % (m - 1);
+      unsigned int corner = body->first_point + i * m + j;
+      unsigned int *face = surface->faces[body->first_face + f];
+      face[0] = corner;
+      face[1] = corner + m;
+      face[2] = corner + m + 1;
+      face[3] = corner + 1;
+      for (unsigned int e = 0; e < SPRINGS_PER_FACE; e++) {
+        meshIndex spring = view->face_springs[f * SPRINGS_PER_FACE + e];
+        mesh->face_springs[(body->first_face + f) * SPRINGS_PER_FACE + e] =
+            spring == NO_SPRING ? NO_SPRING : body->first_spring + spring;
+      }
+    }
+
+    // The lines of the grid become views of the points of the scene
+    freeMatrix(view->P, n);
+    freeMatrix(view->P0, n);
+    freeMatrix(view->V, n);
+    view->P = (Vector **)malloc(n * sizeof(Vector *));
+    view->P0 = (Vector **)malloc(n * sizeof(Vector *));
+    view->V = (Vector **)malloc(n * sizeof(Vector *));
+    for (unsigned int i = 0; i < n; i++) {
+      view->P[i] = &mesh->P[0][body->first_point + i * m];
+      view->P0[i] = &mesh->P0[0][body->first_point + i * m];
+      view->V[i] = &mesh->V[0][body->first_point + i * m];
+    }
+    same_mass = same_mass && view->params.Mu == params[0].Mu;
+  }
+
+  // The spring forces are divided by the Mu of the scene
+  if (!same_mass) {
+    mesh->mass = (float *)malloc(M * sizeof(float));
+    for (unsigned int p = 0; p < M; p++) {
+      const Mesh *view = scene->bodies[scene->point_body[p]].mesh;
+      mesh->mass[p] = view->params.Mu / params[0].Mu;
+    }
+  }
+
+  linkSurfaceFaces(surface);
+  newFaceStates(mesh, n_faces);
+  linkSpringFaces(mesh, 4); // the structural springs of the grids
+
+  mesh->point_springs_start = NULL;
+  mesh->point_springs = NULL;
+  mesh->spring_forces = NULL;
+  if (params[0].DETERMINISTIC)
+    listPointSprings(mesh, n_springs);
+
+  log_info("Scene of %u bodies: %u points, %" PRI_MESH_INDEX
+           " faces, %" PRI_MESH_INDEX " springs",
+           n_bodies, M, n_faces, n_springs);
+  return 0;
+}
+
+/**
+ * Copy the springs and the time of a scene to the grids of its bodies, and
+ * break their faces accordingly, before they are written
+ */
+void syncSceneBodies(Mesh *mesh) {
+  const Scene *scene = mesh->scene;
+  for (unsigned int b = 0; b < scene->n_bodies; b++) {
+    const Body *body = &scene->bodies[b];
+    Mesh *view = body->mesh;
+    view->t = mesh->t;
+    view->n_springs = 0;
+    for (meshIndex k = 0; k < view->total_springs; k++) {
+      const Spring *spring = &mesh->springs[body->first_spring + k];
+      view->springs[k].isBreak = spring->isBreak;
+      view->springs[k].damage = spring->damage;
+      if (!spring->isBreak)
+        view->n_springs++;
+    }
+    for (meshIndex f = 0; f < view->n_faces; f++) {
+      if (!isMeshFaceIntact(mesh, body->first_face + f))
+        breakFace(view, f);
+    }
+  }
+}
+
+/**
+ * De-allocate the bodies of a scene, whose points are those of the scene
+ */
+static void freeScene(Scene *scene) {
+  if (scene == NULL)
+    return;
+  for (unsigned int b = 0; b < scene->n_bodies; b++) {
+    Mesh *view = scene->bodies[b].mesh;
+    free(view->P);
+    free(view->P0);
+    free(view->V);
+    view->P = view->P0 = view->V = NULL;
+    freeMesh(view);
+  }
+  free(scene->bodies);
+  free(scene->point_body);
+  free(scene);
+}
+
+/**
+ * Update the spring k in the default mode: its forces are added to acc, its
+ * damage and breaking and the diagnostics of the calling thread updated
+ */
+static inline void updateSpring(Mesh *mesh, meshIndex k, meshType type,
+                                float delta_t, Vector **local_acc,
+                                double *potential, float *max_strain,
+                                meshIndex *histogram) {
+  const Params *params = &mesh->params;
+  Diagnostics *diag = mesh->diagnostics;
+  Spring *current = &mesh->springs[k];
+
+  // Skip broken springs
+  if (current->isBreak)
+    return;
+
+  // Get the points connected by the spring
+  Point A = current->ext_1;
+  Point B = current->ext_2;
+
+  // Get the current positions of the spring's endpoints
+  Vector current_position = mesh->P[A.i][A.j];
+  Vector target_current_position = mesh->P[B.i][B.j];
+
+  // Compute the vector representing the spring's displacement
+  Vector l_i_j_k_l =
+      newVectorFromPoint(target_current_position, current_position);
+  float current_spring_len = norm(l_i_j_k_l);
+
+  // Compute the original length of the spring
+  float original_spring_len =
+      norm(newVectorFromPoint(mesh->P0[A.i][A.j], mesh->P0[B.i][B.j]));
+
+  // Calculate the spring force magnitude using Hooke's Law
+  float force_magnitude =
+      -current->stiffness * (current_spring_len - original_spring_len);
+
+  // Calculate the direction of the spring force
+  Vector direction = normalize(l_i_j_k_l);
+
+  // Apply force to endpoint A if it's not a fixed point
+  if (!isFixedPoint(A.i, A.j, mesh, type)) {
+    // Accumulate the force into the thread-local acceleration matrix
+    local_acc[A.i][A.j] =
+        addVector(local_acc[A.i][A.j],
+                  multVector(force_magnitude / params->Mu, direction));
+  }
+
+  // Apply force to endpoint B if it's not a fixed point
+  if (!isFixedPoint(B.i, B.j, mesh, type)) {
+    // Accumulate the opposing force into the thread-local acceleration matrix
+    local_acc[B.i][B.j] =
+        addVector(local_acc[B.i][B.j],
+                  multVector(-force_magnitude / params->Mu, direction));
+  }
+
+  // Calculate strain and potential energy for damage and breakage checks
+  float strain =
+      (current_spring_len - original_spring_len) / original_spring_len;
+  float potential_energy = 0.5f * current->stiffness *
+                           (current_spring_len - original_spring_len) *
+                           (current_spring_len - original_spring_len);
+
+// Atomically update the damage on the spring
+#pragma omp atomic
+  current->damage += strain * delta_t;
+  if (diag != NULL)
+    addSpringDiagnostics(mesh, current->damage, strain, potential_energy,
+                         potential, max_strain, histogram);
+
+  // Check if the spring should break based on energy or damage thresholds
+
+  // Method using a len criteria
+  // float ratio = current_spring_len / original_spring_len ;
+  // if ( ratio >= 1.5f  )
+  // {
+  //     #pragma omp critical
+  //     {
+  //         current->isBreak = true;
+  //         mesh->n_springs--;
+  //     }
+  // }
+
+  // Method using a more complex criteria based on energy and damage
+  const Params *breaking = breakingParams(mesh, current);
+  if (potential_energy > breaking->ENERGY_THRESHOLD ||
+      current->damage > breaking->DAMAGE_THRESHOLD) {
+    // Only the thread handling spring k writes it, the list of the springs
+    // broken during this update is shared
+    current->isBreak = true;
+    meshIndex slot;
+#pragma omp atomic capture
+    slot = mesh->n_broken++;
+    mesh->broken_springs[slot] = k;
+    TRACE_EVENT(mesh->trace, TRACE_SPRING_BREAK, k, 0, potential_energy,
+                current->damage);
+  }
+}
+
+/**
+ * Compute forces applied to each spring and update acceleration matrix
+ */
+void computeSpringForces(Mesh *mesh, Vector **acc, meshType type,
+                         float delta_t) {
+  const Params *params = &mesh->params;
+  if (mesh->stencil != NULL) {
+    computeSpringForcesStencil(mesh, acc, type, delta_t);
+    return;
+  }
+  if (params->DETERMINISTIC) {
+    computeSpringForcesDeterministic(mesh, acc, type, delta_t);
+    return;
+  }
+
+  PROFILE_START(mesh->profile, springs_start);
+  double springs_end = 0.0;
+  SpringSums sums;
+  resetSpringSums(&sums);
+
+  // The spring pass of the default update, see updateTeam
+#pragma omp parallel if (inParallel(mesh))
+  {
+    bool alone = omp_get_num_threads() == 1;
+    Vector **local_acc = alone ? acc : getMatrix(mesh->n, mesh->m);
+    addSpringForces(mesh, type, delta_t, acc, local_acc, &sums, &springs_end);
+    if (!alone)
+      freeMatrix(local_acc, mesh->n);
+  }
+
+  if (mesh->diagnostics != NULL)
+    storeSpringDiagnostics(mesh->diagnostics, sums.potential,
+                           sums.max_strain, sums.histogram);
+
+  if (mesh->profile != NULL) {
+    profileAdd(mesh->profile, PHASE_SPRINGS, springs_end - springs_start);
+    profileAdd(mesh->profile, PHASE_MERGE, profileNow() - springs_end);
+  }
+}
+
+/**
+ * Compute the force generated by the fluid at point i,j
+ */
+Vector computeFluidForce(Mesh *mesh, unsigned int i, unsigned int j,
+                         Vector u_fluid) {
+  Vector f_fluid = {0.0f, 0.0f, 0.0f};
+  Vector n_ij = {0.0f, 0.0f, 0.0f};
+
+  // The normal of an imported mesh is that of the faces of the point
+  if (mesh->surface != NULL) {
+    n_ij = surfaceNormal(mesh->surface, mesh->P[0], j);
+    if (n_ij.x == 0.0f && n_ij.y == 0.0f && n_ij.z == 0.0f) {
+      log_hot_error("Cannot compute normal vector for %d, %d", i, j);
+      TRACE_EVENT(mesh->trace, TRACE_NORMAL_FAILURE, i, j, 0, 0.0f);
+    }
+    float scal = scalar_product(
+        n_ij, addVector(u_fluid, multVector(-1.0f, mesh->V[i][j])));
+    return multVector(scal * mesh->params.C_VI, n_ij);
+  }
+
+  // Compute the normal force
+  unsigned int nb_springs = 0;
+  Spring *R =
+      getPossibleSprings(i, j, mesh->n, mesh->m, &nb_springs, &mesh->params);
+
+  if (nb_springs > 2) {
+    // First vector
+    Vector a = newVectorFromPoint(mesh->P[R[0].ext_1.i][R[0].ext_1.j],
+                                  mesh->P[R[0].ext_2.i][R[0].ext_2.j]);
+
+    unsigned int k = 0;
+    for (k = 1; k < nb_springs;
+         k++) // find a non colinear vector among his neighbors
+    {
+      // Second Vector
+      Vector b = newVectorFromPoint(mesh->P[R[k].ext_1.i][R[k].ext_1.j],
+                                    mesh->P[R[k].ext_2.i][R[k].ext_2.j]);
+
+      // Check for colinearity
+      if (!isCollinear(a, b)) {
+        n_ij = normalize(crossProduct(a, b));
+        break;
+      }
+    }
+    if (k == nb_springs) // there is no non colinear vector between his spring
+                         // neighborhood
+    {
+      log_hot_error("Cannot compute normal vector for %d, %d", i, j);
+      TRACE_EVENT(mesh->trace, TRACE_NORMAL_FAILURE, i, j, nb_springs, 0.0f);
+    }
+  } else {
+    log_hot_error("Cannot find correct possible springs for %d, %d", i, j);
+    TRACE_EVENT(mesh->trace, TRACE_NORMAL_FAILURE, i, j, nb_springs, 0.0f);
+  }
+
+  float scal = scalar_product(
+      n_ij, addVector(u_fluid, multVector(-1.0f, mesh->V[i][j])));
+  f_fluid = multVector(scal * mesh->params.C_VI, n_ij);
+
+  free(R);
+
+  return f_fluid;
+}
+
+/**
+ * De-allocate the arrays of a mesh, not the mesh itself
+ */
+static void freeMeshArrays(Mesh *mesh) {
+  freeMatrix(mesh->P, mesh->n);
+  freeMatrix(mesh->V, mesh->n);
+  freeMatrix(mesh->P0, mesh->n);
+  free(mesh->springs);
+  free(mesh->broken_springs);
+  free(mesh->point_springs_start);
+  free(mesh->point_springs);
+  free(mesh->spring_forces);
+  freeTiling(mesh->tiling);
+  freeTemporalBlocking(mesh->temporal, mesh->n);
+  freeStencil(mesh->stencil);
+  freeSurface(mesh->surface);
+  freeRefinement(mesh->refinement);
+  free(mesh->mass);
+  freeScene(mesh->scene);
+  free(mesh->face_springs);
+  free(mesh->spring_faces);
+  free(mesh->broken_faces);
+}
+
+/**
+ * De-allocate correctly a mesh
+ */
+void freeMesh(Mesh *mesh) {
+  freeMeshArrays(mesh);
+  free(mesh);
+}
+
+/**
+ * Return true if none of the springs of the edges of the face is broken, the
+ * face being numbered as in face_springs
+ */
+bool isMeshFaceIntact(const Mesh *mesh, meshIndex face) {
+  return !((mesh->broken_faces[face / 64] >> (face % 64)) & 1);
+}
+
+/**
+ * Return true if none of the structural springs of the face (i, j) is broken
+ */
+bool isFaceIntact(const Mesh *mesh, unsigned int i, unsigned int j) {
+  return isMeshFaceIntact(mesh, i * (mesh->m - 1) + j);
+}
+
+/**
+ * Return a vector of force depending on the meshtype, these are customs forces
+ * that are not listed in the initial documentation
+ */
+Vector computeAddForces(Mesh *mesh, meshType type, unsigned int i,
+                        unsigned int j) {
+  Vector res = {0, 0, 0};
+  float coef = 2.0f;
+
+  switch (type) {
+  case CURTAIN:
+    /* No additionnal forces to add*/
+    break;
+
+  case TABLE_CLOTH:
+    /* No additionnal forces to add*/
+    break;
+
+  case SOFT:
+    res.y = 0.1f;
+
+    // Apply a force to point onto the left and right edge of the soft
+    float gi, gj;
+    gridCoordinates(mesh, i, j, &gi, &gj);
+    if (gi < mesh->params.N / 2) {
+      res.x += -coef * mesh->P[i][j].y;
+      // if( j >= mesh->m - 4)
+      //     res.z += coef;
+    } else {
+      res.x += coef * mesh->P[i][j].y;
+    }
+
+    // apply a force to little square a t the bottom right of the soft
+    // if ( j <= 4)
+    // {
+    //     res.y -= coef;
+    // }
+
+    break;
+  case FLAG:
+    /* No additionnal forces to add*/
+    break;
+
+  default:
+    break;
+  }
+
+  // Return null vector
+  return res;
 }
\ No newline at end of file
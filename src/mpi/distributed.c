@@ -0,0 +1,272 @@
+#include "../../include/distributed.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Range [start, end) of the block c when `count` points are split in `parts`
+ * blocks, the first ones getting one more point if needed
+ */
+static void blockRange(unsigned int count, int parts, int c,
+                       unsigned int *start, unsigned int *end) {
+  unsigned int base = count / parts, extra = count % parts;
+  *start = c * base + (c < extra ? c : extra);
+  *end = *start + base + (c < extra ? 1 : 0);
+}
+
+/**
+ * Split the grid of params over the ranks of comm and create the block of
+ * the calling rank. NULL on every rank if a block is too small for the halo
+ * or the grid can not be built with params.
+ */
+Distributed *newDistributed(MPI_Comm comm, meshType type,
+                            const Params *params) {
+  if (!checkGridParams(type, params))
+    return NULL;
+  Distributed *dist = (Distributed *)malloc(sizeof(Distributed));
+  int periods[2] = {0, 0};
+
+  MPI_Comm_size(comm, &dist->size);
+  dist->dims[0] = dist->dims[1] = 0;
+  MPI_Dims_create(dist->size, 2, dist->dims);
+  MPI_Cart_create(comm, 2, dist->dims, periods, 0, &dist->comm);
+  MPI_Comm_rank(dist->comm, &dist->rank);
+  MPI_Cart_coords(dist->comm, dist->rank, 2, dist->coords);
+  MPI_Cart_shift(dist->comm, 0, 1, &dist->lower[0], &dist->upper[0]);
+  MPI_Cart_shift(dist->comm, 1, 1, &dist->lower[1], &dist->upper[1]);
+
+  blockRange(params->N, dist->dims[0], dist->coords[0], &dist->own_i0,
+             &dist->own_i1);
+  blockRange(params->M, dist->dims[1], dist->coords[1], &dist->own_j0,
+             &dist->own_j1);
+
+  // A halo must come from a single neighbour
+  int too_small = dist->own_i1 - dist->own_i0 < DIST_HALO ||
+                  dist->own_j1 - dist->own_j0 < DIST_HALO;
+  MPI_Allreduce(MPI_IN_PLACE, &too_small, 1, MPI_INT, MPI_LOR, dist->comm);
+  if (too_small) {
+    if (dist->rank == 0)
+      log_error("Error: %ux%u points cannot be split in %dx%d blocks of at "
+                "least %dx%d points",
+                params->N, params->M, dist->dims[0], dist->dims[1], DIST_HALO,
+                DIST_HALO);
+    MPI_Comm_free(&dist->comm);
+    free(dist);
+    return NULL;
+  }
+
+  // The block and the halos of its neighbours
+  unsigned int i0 =
+      dist->own_i0 - (dist->lower[0] != MPI_PROC_NULL ? DIST_HALO : 0);
+  unsigned int i1 =
+      dist->own_i1 + (dist->upper[0] != MPI_PROC_NULL ? DIST_HALO : 0);
+  unsigned int j0 =
+      dist->own_j0 - (dist->lower[1] != MPI_PROC_NULL ? DIST_HALO : 0);
+  unsigned int j1 =
+      dist->own_j1 + (dist->upper[1] != MPI_PROC_NULL ? DIST_HALO : 0);
+  dist->mesh = (Mesh *)malloc(sizeof(Mesh));
+  initMeshBlock(dist->mesh, type, params, i0, j0, i1 - i0, j1 - j0);
+
+  MPI_Type_contiguous(sizeof(Vector) / sizeof(float), MPI_FLOAT,
+                      &dist->vector);
+  MPI_Type_commit(&dist->vector);
+  MPI_Type_vector(dist->mesh->n, DIST_HALO, dist->mesh->m, dist->vector,
+                  &dist->column);
+  MPI_Type_commit(&dist->column);
+  return dist;
+}
+
+/**
+ * Address of the element `offset` of a matrix, the matrix itself if there
+ * is no neighbour to exchange with (the buffer is then not used)
+ */
+static Vector *haloBuffer(Vector **matrix, long offset, int neighbour) {
+  return neighbour != MPI_PROC_NULL ? matrix[0] + offset : matrix[0];
+}
+
+/**
+ * Replace the halo of a matrix by the points owned by the neighbours. The
+ * lines are exchanged first, then the columns of every line, which brings
+ * the corners of the diagonal neighbours.
+ */
+static void exchangeHalo(Distributed *dist, Vector **matrix) {
+  const long m = dist->mesh->m;
+  const long li0 = dist->own_i0 - dist->mesh->i0;
+  const long li1 = dist->own_i1 - dist->mesh->i0;
+  const long lj0 = dist->own_j0 - dist->mesh->j0;
+  const long lj1 = dist->own_j1 - dist->mesh->j0;
+  const int lines = DIST_HALO * m;
+
+  // First owned lines to the lower neighbour, last ones to the upper one
+  MPI_Sendrecv(matrix[0] + li0 * m, lines, dist->vector, dist->lower[0], 0,
+               haloBuffer(matrix, li1 * m, dist->upper[0]), lines,
+               dist->vector, dist->upper[0], 0, dist->comm,
+               MPI_STATUS_IGNORE);
+  MPI_Sendrecv(matrix[0] + (li1 - DIST_HALO) * m, lines, dist->vector,
+               dist->upper[0], 1,
+               haloBuffer(matrix, (li0 - DIST_HALO) * m, dist->lower[0]),
+               lines, dist->vector, dist->lower[0], 1, dist->comm,
+               MPI_STATUS_IGNORE);
+
+  // Same for the columns
+  MPI_Sendrecv(matrix[0] + lj0, 1, dist->column, dist->lower[1], 2,
+               haloBuffer(matrix, lj1, dist->upper[1]), 1, dist->column,
+               dist->upper[1], 2, dist->comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(matrix[0] + lj1 - DIST_HALO, 1, dist->column, dist->upper[1],
+               3, haloBuffer(matrix, lj0 - DIST_HALO, dist->lower[1]), 1,
+               dist->column, dist->lower[1], 3, dist->comm,
+               MPI_STATUS_IGNORE);
+}
+
+/**
+ * Update the block, then bring the new halo. The halo points are moved by
+ * updatePosition with only part of their springs, and replaced here.
+ */
+void distributedUpdate(Distributed *dist, float delta_t, meshType type) {
+  updatePosition(dist->mesh, delta_t, type);
+  exchangeHalo(dist, dist->mesh->P);
+  exchangeHalo(dist, dist->mesh->V);
+}
+
+/**
+ * Springs broken in the whole grid, each one counted by the owner of its
+ * ext_1. To be called by every rank.
+ */
+meshIndex distributedBrokenSprings(const Distributed *dist) {
+  const Mesh *mesh = dist->mesh;
+  unsigned long long broken = 0;
+  for (meshIndex k = 0; k < mesh->total_springs; k++) {
+    const Spring *s = &mesh->springs[k];
+    unsigned int i = s->ext_1.i + mesh->i0, j = s->ext_1.j + mesh->j0;
+    if (s->isBreak && i >= dist->own_i0 && i < dist->own_i1 &&
+        j >= dist->own_j0 && j < dist->own_j1)
+      broken++;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &broken, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                dist->comm);
+  return broken;
+}
+
+/**
+ * Write the piece of the calling rank: its points, plus the next line and
+ * column to close the faces with the neighbours, and the faces whose first
+ * point it owns
+ */
+static int writePiece(const Distributed *dist, const char *filename) {
+  const Mesh *mesh = dist->mesh;
+  FILE *file = fopen(filename, "w");
+  if (file == NULL) {
+    log_error("Error: Could not open file %s.", filename);
+    return -1;
+  }
+
+  unsigned int li0 = dist->own_i0 - mesh->i0, li1 = dist->own_i1 - mesh->i0;
+  unsigned int lj0 = dist->own_j0 - mesh->j0, lj1 = dist->own_j1 - mesh->j0;
+  unsigned int pi1 = li1 < mesh->n ? li1 + 1 : li1;
+  unsigned int pj1 = lj1 < mesh->m ? lj1 + 1 : lj1;
+  unsigned int fi1 = li1 < mesh->n - 1 ? li1 : mesh->n - 1;
+  unsigned int fj1 = lj1 < mesh->m - 1 ? lj1 : mesh->m - 1;
+  unsigned int width = pj1 - lj0;
+  unsigned int points = (pi1 - li0) * width;
+  unsigned int cells = (fi1 - li0) * (fj1 - lj0);
+
+  fprintf(file, "<?xml version=\"1.0\"?>\n"
+                "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" "
+                "byte_order=\"LittleEndian\">\n<UnstructuredGrid>\n");
+  fprintf(file, "<Piece NumberOfPoints=\"%u\" NumberOfCells=\"%u\">\n", points,
+          cells);
+
+  fprintf(file, "<Points>\n<DataArray type=\"Float32\" "
+                "NumberOfComponents=\"3\" format=\"ascii\">\n");
+  for (unsigned int i = li0; i < pi1; i++) {
+    for (unsigned int j = lj0; j < pj1; j++) {
+      fprintf(file, "%f %f %f\n", mesh->P[i][j].x, mesh->P[i][j].y,
+              mesh->P[i][j].z);
+    }
+  }
+  fprintf(file, "</DataArray>\n</Points>\n<Cells>\n");
+
+  // Faces as quadrilaterals, numbered in the piece
+  fprintf(file, "<DataArray type=\"Int32\" Name=\"connectivity\" "
+                "format=\"ascii\">\n");
+  for (unsigned int i = li0; i < fi1; i++) {
+    for (unsigned int j = lj0; j < fj1; j++) {
+      unsigned int id1 = (i - li0) * width + j - lj0;
+      fprintf(file, "%u %u %u %u\n", id1, id1 + 1, id1 + width + 1,
+              id1 + width);
+    }
+  }
+  fprintf(file, "</DataArray>\n<DataArray type=\"Int32\" Name=\"offsets\" "
+                "format=\"ascii\">\n");
+  for (unsigned int k = 1; k <= cells; k++) {
+    fprintf(file, "%u\n", 4 * k);
+  }
+  fprintf(file, "</DataArray>\n<DataArray type=\"UInt8\" Name=\"types\" "
+                "format=\"ascii\">\n");
+  for (unsigned int k = 0; k < cells; k++) {
+    fprintf(file, "9\n");
+  }
+  fprintf(file, "</DataArray>\n</Cells>\n");
+
+  fprintf(file, "<CellData Scalars=\"face_state\">\n<DataArray "
+                "type=\"Int32\" Name=\"face_state\" format=\"ascii\">\n");
+  for (unsigned int i = li0; i < fi1; i++) {
+    for (unsigned int j = lj0; j < fj1; j++) {
+      fprintf(file, "%d\n", isFaceIntact(mesh, i, j) ? 1 : 0);
+    }
+  }
+  fprintf(file, "</DataArray>\n</CellData>\n</Piece>\n</UnstructuredGrid>\n"
+                "</VTKFile>\n");
+  fclose(file);
+  return 0;
+}
+
+/**
+ * Write directory/name_ITER_RANK.vtu on every rank, and the
+ * directory/name_ITER.pvtu listing them on rank 0. Return -1 if a rank
+ * failed, on every rank.
+ */
+int writeDistributedVTK(const Distributed *dist, const char *directory,
+                        const char *name, unsigned int iteration) {
+  char filename[512];
+  snprintf(filename, sizeof(filename), "%s/%s_%03u_%d.vtu", directory, name,
+           iteration, dist->rank);
+  int failed = writePiece(dist, filename) != 0;
+
+  if (dist->rank == 0) {
+    snprintf(filename, sizeof(filename), "%s/%s_%03u.pvtu", directory, name,
+             iteration);
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+      log_error("Error: Could not open file %s.", filename);
+      failed = 1;
+    } else {
+      fprintf(file, "<?xml version=\"1.0\"?>\n"
+                    "<VTKFile type=\"PUnstructuredGrid\" version=\"0.1\" "
+                    "byte_order=\"LittleEndian\">\n"
+                    "<PUnstructuredGrid GhostLevel=\"0\">\n"
+                    "<PCellData Scalars=\"face_state\">\n"
+                    "<PDataArray type=\"Int32\" Name=\"face_state\"/>\n"
+                    "</PCellData>\n<PPoints>\n<PDataArray type=\"Float32\" "
+                    "NumberOfComponents=\"3\"/>\n</PPoints>\n");
+      for (int r = 0; r < dist->size; r++) {
+        fprintf(file, "<Piece Source=\"%s_%03u_%d.vtu\"/>\n", name, iteration,
+                r);
+      }
+      fprintf(file, "</PUnstructuredGrid>\n</VTKFile>\n");
+      fclose(file);
+    }
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, dist->comm);
+  return failed ? -1 : 0;
+}
+
+void freeDistributed(Distributed *dist) {
+  if (dist == NULL)
+    return;
+  freeMesh(dist->mesh);
+  MPI_Type_free(&dist->column);
+  MPI_Type_free(&dist->vector);
+  MPI_Comm_free(&dist->comm);
+  free(dist);
+}
@@ -0,0 +1,77 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/distributed.h"
+#include "../../include/utils.h"
+
+/**
+ * Entry point of the MPI variant, built by `make mpi`:
+ *
+ *   mpirun -np 4 ./bin/app_mpi <type> [--sink=vtk|none] [--tile=SIZE]
+ *
+ * Every rank updates its block of the grid and, every STEP updates, writes
+ * its piece of vtk_mpi_<type>/mesh_<type>_ITER.pvtu.
+ */
+int main(int argc, char **argv) {
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  meshType type = parseArguments(argc, argv);
+  Options options;
+  parseOptions(argc, argv, &options);
+  if (options.sink == SINK_SHM || options.profile != NULL ||
+      options.diagnostics != NULL || options.trace != NULL ||
+      options.stencil || options.obj != NULL || options.refine > 0 ||
+      options.temporal > 1) {
+    if (rank == 0)
+      log_error("Only --sink=vtk|none and --tile are available with MPI");
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  // The blocks only read the positions of their halo at the start of an
+  // update: the normals are those of the deterministic or tiled update
+  Params params = defaultParams();
+  customs_params(&params, type);
+  params.TILE_SIZE = options.tile_size;
+  params.DETERMINISTIC = params.TILE_SIZE == 0;
+
+  Distributed *dist = newDistributed(MPI_COMM_WORLD, type, &params);
+  if (dist == NULL) {
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+  if (rank == 0)
+    log_info("%ux%u points on %d ranks in %dx%d blocks", params.N, params.M,
+             dist->size, dist->dims[0], dist->dims[1]);
+
+  const char *type_name = getTypeName(type);
+  char directory[256], name[256];
+  snprintf(directory, sizeof(directory), "vtk_mpi_%s", type_name);
+  snprintf(name, sizeof(name), "mesh_%s", type_name);
+  if (options.sink == SINK_VTK && rank == 0)
+    createDirectory(directory);
+  MPI_Barrier(dist->comm);
+
+  double start_time = MPI_Wtime();
+  for (unsigned int i = 0; i < params.NB_UPDATES; i++) {
+    if (i % params.STEP == 0 && options.sink == SINK_VTK)
+      writeDistributedVTK(dist, directory, name, i);
+    distributedUpdate(dist, params.DELTA_T, type);
+  }
+  MPI_Barrier(dist->comm);
+  double elapsed_time = MPI_Wtime() - start_time;
+
+  meshIndex broken = distributedBrokenSprings(dist);
+  if (rank == 0) {
+    log_info("File generation completed in %.3f seconds", elapsed_time);
+    log_info("%" PRI_MESH_INDEX " springs broken", broken);
+  }
+
+  freeDistributed(dist);
+  MPI_Finalize();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include "../include/output.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+
+void initOutputPolicy(OutputPolicy *policy, float tolerance, unsigned int min,
+                      unsigned int max) {
+  policy->tolerance = tolerance;
+  policy->min = min > 0 ? min : 1;
+  policy->max = max > policy->min ? max : policy->min;
+  policy->last = 0;
+  policy->n_frames = 0;
+  policy->n_springs = 0;
+  policy->n_points = 0;
+  policy->reference = NULL;
+  policy->rebuilt = false;
+  policy->times = NULL;
+}
+
+/**
+ * Write the frame, update and time of every frame in filename, as CSV.
+ * Return 0, or -1 if it can not be opened.
+ */
+int recordFrameTimes(OutputPolicy *policy, const char *filename) {
+  policy->times = fopen(filename, "w");
+  if (policy->times == NULL) {
+    log_error("Error: Could not open file %s.", filename);
+    return -1;
+  }
+  fprintf(policy->times, "frame,update,time,file\n");
+  return 0;
+}
+
+/**
+ * Largest squared distance of a point of the mesh to its position in the
+ * last frame
+ */
+static float maxSquaredDisplacement(const OutputPolicy *policy,
+                                    const Mesh *mesh) {
+  const Vector *P = mesh->P[0];
+  float high = 0.0f;
+#pragma omp parallel for schedule(static) reduction(max : high)
+  for (unsigned int p = 0; p < policy->n_points; p++) {
+    Vector d = newVectorFromPoint(policy->reference[p], P[p]);
+    float squared = scalar_product(d, d);
+    if (squared > high)
+      high = squared;
+  }
+  return high;
+}
+
+/**
+ * Whether a frame is written at this update
+ */
+bool isFrameDue(OutputPolicy *policy, const Mesh *mesh, unsigned int update) {
+  if (policy->n_frames == 0)
+    return true;
+  unsigned int since = update - policy->last;
+  if (since >= policy->max)
+    return true;
+  if (policy->tolerance <= 0.0f || since < policy->min)
+    return false;
+  if (policy->rebuilt || mesh->n_springs != policy->n_springs ||
+      mesh->n * mesh->m != policy->n_points)
+    return true;
+  float tolerance = policy->tolerance * mesh->params.SPACING;
+  return maxSquaredDisplacement(policy, mesh) > tolerance * tolerance;
+}
+
+/**
+ * Keep the state of the mesh at the frame written at this update, in the
+ * file name, and record its time
+ */
+void frameWritten(OutputPolicy *policy, const Mesh *mesh, unsigned int update,
+                  const char *name) {
+  if (policy->times != NULL)
+    fprintf(policy->times, "%u,%u,%f,%s\n", policy->n_frames, update, mesh->t,
+            name);
+  policy->n_frames++;
+  policy->last = update;
+  policy->n_springs = mesh->n_springs;
+  policy->rebuilt = false;
+  if (policy->tolerance <= 0.0f)
+    return;
+
+  unsigned int n_points = mesh->n * mesh->m;
+  if (n_points != policy->n_points) {
+    free(policy->reference);
+    policy->reference = (Vector *)malloc(n_points * sizeof(Vector));
+    policy->n_points = n_points;
+  }
+  memcpy(policy->reference, mesh->P[0], n_points * sizeof(Vector));
+}
+
+/**
+ * Updates that can run before the next frame may be due
+ */
+unsigned int updatesBeforeCheck(const OutputPolicy *policy,
+                                unsigned int update) {
+  unsigned int since = update - policy->last;
+  if (policy->tolerance <= 0.0f)
+    return policy->max - since;
+  return since < policy->min ? policy->min - since : 1;
+}
+
+void closeOutputPolicy(OutputPolicy *policy) {
+  if (policy->times != NULL)
+    fclose(policy->times);
+  free(policy->reference);
+}
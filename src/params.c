@@ -1,30 +1,118 @@
-#include "params.h"
-
-// Initialize variables with default values, which work for the CURTAIN and
-// TABLE_CLOTH cases.
-unsigned int M = 50;
-unsigned int N = 50;
-float SPACING = 1.0f;
-
-// MESH CONST
-float Mu = 1.00f;
-float C_DIS = 0.90f;
-float C_VI = 0.1f;
-
-// SPRINGS CONST
-int MAX_SPRINGS_PER_POINT = 12;
-float STIFFNESS_H = 20.0f;
-float STIFFNESS_V = 20.0f;
-float STIFFNESS_D = 20.0f;
-float ENERGY_THRESHOLD = 100000.0f; // 0.90f correct value
-float DAMAGE_THRESHOLD = 100000.0f;
-
-// RADIUS
-float RADIUS = 13.0f;
-
-float DELTA_T = 0.1f;
-unsigned int NB_UPDATES = 5000;
-int STEP = 20;
-
-Vector GRAVITY = {0.0f, -0.1f, 0.0f};
-Vector FLUID = {0.0f, 0.0f, 0.1f};
\ No newline at end of file
+#include "params.h"
+#include <math.h>
+#include <string.h>
+
+// Fields of Params that can be set from their name
+static const ParamInfo PARAMS_INFO[] = {
+    {"M", offsetof(Params, M), true, true},
+    {"N", offsetof(Params, N), true, true},
+    {"SPACING", offsetof(Params, SPACING), false, true},
+    {"Mu", offsetof(Params, Mu), false, false},
+    {"C_DIS", offsetof(Params, C_DIS), false, false},
+    {"C_VI", offsetof(Params, C_VI), false, false},
+    {"STIFFNESS_H", offsetof(Params, STIFFNESS_H), false, true},
+    {"STIFFNESS_V", offsetof(Params, STIFFNESS_V), false, true},
+    {"STIFFNESS_D", offsetof(Params, STIFFNESS_D), false, true},
+    {"ENERGY_THRESHOLD", offsetof(Params, ENERGY_THRESHOLD), false, false},
+    {"DAMAGE_THRESHOLD", offsetof(Params, DAMAGE_THRESHOLD), false, false},
+    {"RADIUS", offsetof(Params, RADIUS), false, false},
+    {"DELTA_T", offsetof(Params, DELTA_T), false, false},
+    {"NB_UPDATES", offsetof(Params, NB_UPDATES), true, false},
+    {"STEP", offsetof(Params, STEP), true, false},
+    {"GRAVITY.x", offsetof(Params, GRAVITY.x), false, false},
+    {"GRAVITY.y", offsetof(Params, GRAVITY.y), false, false},
+    {"GRAVITY.z", offsetof(Params, GRAVITY.z), false, false},
+    {"FLUID.x", offsetof(Params, FLUID.x), false, false},
+    {"FLUID.y", offsetof(Params, FLUID.y), false, false},
+    {"FLUID.z", offsetof(Params, FLUID.z), false, false},
+    {"DETERMINISTIC", offsetof(Params, DETERMINISTIC), true, true},
+    {"TILE_SIZE", offsetof(Params, TILE_SIZE), true, true},
+    {"TEMPORAL_STEPS", offsetof(Params, TEMPORAL_STEPS), true, true},
+    {"TEMPORAL_TILE", offsetof(Params, TEMPORAL_TILE), true, true},
+    {"STENCIL", offsetof(Params, STENCIL), true, true},
+    {"PARALLEL_THRESHOLD", offsetof(Params, PARALLEL_THRESHOLD), true, false},
+    {"REFINE_LEVELS", offsetof(Params, REFINE_LEVELS), true, true},
+    {"REFINE_STRAIN", offsetof(Params, REFINE_STRAIN), false, false},
+    {"REFINE_CURVATURE", offsetof(Params, REFINE_CURVATURE), false, false},
+};
+
+/**
+ * Return the default values, which work for the CURTAIN and TABLE_CLOTH cases.
+ */
+Params defaultParams(void) {
+  Params params = {
+      // SPACE CONST
+      .M = 50,
+      .N = 50,
+      .SPACING = 1.0f,
+
+      // MESH CONST
+      .Mu = 1.00f,
+      .C_DIS = 0.90f,
+      .C_VI = 0.1f,
+
+      // SPRINGS CONST
+      .MAX_SPRINGS_PER_POINT = 12,
+      .STIFFNESS_H = 20.0f,
+      .STIFFNESS_V = 20.0f,
+      .STIFFNESS_D = 20.0f,
+      .ENERGY_THRESHOLD = 100000.0f, // 0.90f correct value
+      .DAMAGE_THRESHOLD = 100000.0f,
+
+      // RADIUS
+      .RADIUS = 13.0f,
+
+      .DELTA_T = 0.1f,
+      .NB_UPDATES = 5000,
+      .STEP = 20,
+
+      .GRAVITY = {0.0f, -0.1f, 0.0f},
+      .FLUID = {0.0f, 0.0f, 0.1f},
+
+      .DETERMINISTIC = 0,
+      .TILE_SIZE = 0,
+      .TEMPORAL_STEPS = 0,
+      .TEMPORAL_TILE = 32,
+      .STENCIL = 0,
+      .PARALLEL_THRESHOLD = 1024,
+
+      .REFINE_LEVELS = 0,
+      .REFINE_STRAIN = 0.05f,
+      .REFINE_CURVATURE = 0.2f,
+  };
+  return params;
+}
+
+/**
+ * Return the description of the field `name` of Params, NULL if there is none
+ */
+const ParamInfo *findParam(const char *name) {
+  for (size_t k = 0; k < sizeof(PARAMS_INFO) / sizeof(PARAMS_INFO[0]); k++) {
+    if (strcmp(PARAMS_INFO[k].name, name) == 0)
+      return &PARAMS_INFO[k];
+  }
+  return NULL;
+}
+
+/**
+ * Set a field of params, integer fields are rounded
+ */
+void setParam(Params *params, const ParamInfo *info, float value) {
+  char *field = (char *)params + info->offset;
+  if (info->isInteger) {
+    *(unsigned int *)field = (unsigned int)lroundf(value);
+  } else {
+    *(float *)field = value;
+  }
+}
+
+/**
+ * Return a field of params
+ */
+float getParam(const Params *params, const ParamInfo *info) {
+  const char *field = (const char *)params + info->offset;
+  if (info->isInteger) {
+    return (float)*(const unsigned int *)field;
+  }
+  return *(const float *)field;
+}
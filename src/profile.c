@@ -0,0 +1,216 @@
+#include "../include/profile.h"
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    "step",      "springs",   "merge",  "fluid",      "integration",
+    "vtk_format", "vtk_write", "render", "image_write"};
+
+/**
+ * Return an empty profile, sized for the current number of threads
+ */
+Profile *newProfile(void) {
+  Profile *profile = (Profile *)calloc(1, sizeof(Profile));
+  profile->n_threads = omp_get_max_threads();
+  profile->threads = (ThreadTimer *)aligned_alloc(
+      64, profile->n_threads * sizeof(ThreadTimer));
+  memset(profile->threads, 0, profile->n_threads * sizeof(ThreadTimer));
+  profile->allocated = allocTotals();
+  return profile;
+}
+
+/**
+ * Monotonic time in seconds
+ */
+double profileNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Add a duration to a phase of the current step
+ */
+void profileAdd(Profile *profile, profilePhase phase, double elapsed) {
+  profile->phases[phase].current += elapsed;
+  profile->phases[phase].occurred = 1;
+}
+
+/**
+ * Return the longest per-thread time accumulated in profile->threads, which
+ * is the wall time of the phase, and reset them
+ */
+double profileCollectThreads(Profile *profile) {
+  double longest = 0.0;
+  for (int t = 0; t < profile->n_threads; t++) {
+    longest = fmax(longest, profile->threads[t].elapsed);
+    profile->threads[t].elapsed = 0.0;
+  }
+  return longest;
+}
+
+/**
+ * Append a sample to a phase
+ */
+static void addSample(PhaseSamples *phase, double sample) {
+  if (phase->count == phase->capacity) {
+    phase->capacity = phase->capacity == 0 ? 1024 : 2 * phase->capacity;
+    phase->samples =
+        (double *)realloc(phase->samples, phase->capacity * sizeof(double));
+  }
+  phase->samples[phase->count++] = sample;
+}
+
+/**
+ * Close the current step: every phase timed during the step gets a sample,
+ * and so do the allocations if they are counted
+ */
+void profileEndStep(Profile *profile, meshIndex springs) {
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    PhaseSamples *phase = &profile->phases[p];
+    if (!phase->occurred)
+      continue;
+
+    addSample(phase, phase->current);
+    phase->current = 0.0;
+    phase->occurred = 0;
+  }
+  if (allocCounted()) {
+    // The growth of the arrays of samples counts as any other allocation
+    AllocTotals totals = allocTotals();
+    addSample(&profile->allocations,
+              (double)(totals.calls - profile->allocated.calls));
+    addSample(&profile->allocated_bytes,
+              (double)(totals.bytes - profile->allocated.bytes));
+    profile->allocated = totals;
+  }
+  profile->steps++;
+  profile->springs += springs;
+}
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+typedef struct PhaseStats {
+  double total, min, mean, p99, max;
+} PhaseStats;
+
+static PhaseStats phaseStats(const PhaseSamples *phase) {
+  PhaseStats stats = {0.0, 0.0, 0.0, 0.0, 0.0};
+  if (phase->count == 0)
+    return stats;
+
+  double *sorted = (double *)malloc(phase->count * sizeof(double));
+  memcpy(sorted, phase->samples, phase->count * sizeof(double));
+  qsort(sorted, phase->count, sizeof(double), compareDouble);
+
+  for (unsigned int k = 0; k < phase->count; k++) {
+    stats.total += sorted[k];
+  }
+  stats.min = sorted[0];
+  stats.max = sorted[phase->count - 1];
+  stats.mean = stats.total / phase->count;
+  stats.p99 = sorted[(unsigned int)ceil(0.99 * phase->count) - 1];
+  free(sorted);
+  return stats;
+}
+
+/**
+ * Write the report of the run in filename, as JSON if its extension is .json
+ * and as CSV otherwise. elapsed is the wall time of the whole loop, the
+ * startup being reported apart. Return 0 on success, -1 otherwise.
+ */
+int writeProfileReport(const Profile *profile, const char *filename,
+                       const char *mesh_name, unsigned int n, unsigned int m,
+                       double elapsed) {
+  FILE *file = fopen(filename, "w");
+  if (file == NULL)
+    return -1;
+
+  const char *extension = strrchr(filename, '.');
+  int json = extension != NULL && strcmp(extension, ".json") == 0;
+  double steps_per_s = profile->steps / elapsed;
+  double springs_per_s = profile->springs / elapsed;
+
+  if (json) {
+    fprintf(file,
+            "{\n  \"mesh\": \"%s\",\n  \"n\": %u,\n  \"m\": %u,\n"
+            "  \"threads\": %d,\n  \"steps\": %u,\n  \"wall_s\": %.9f,\n"
+            "  \"startup_s\": %.9f,\n"
+            "  \"steps_per_s\": %.3f,\n  \"springs_per_s\": %.1f,\n"
+            "  \"phases\": [\n",
+            mesh_name, n, m, profile->n_threads, profile->steps, elapsed,
+            profile->startup, steps_per_s, springs_per_s);
+  } else {
+    fprintf(file,
+            "# mesh=%s n=%u m=%u threads=%d steps=%u wall_s=%.9f "
+            "startup_s=%.9f steps_per_s=%.3f springs_per_s=%.1f\n",
+            mesh_name, n, m, profile->n_threads, profile->steps, elapsed,
+            profile->startup, steps_per_s, springs_per_s);
+    fprintf(file, "phase,calls,total_s,min_s,mean_s,p99_s,max_s\n");
+  }
+
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    PhaseStats stats = phaseStats(&profile->phases[p]);
+    if (json) {
+      fprintf(file,
+              "    {\"name\": \"%s\", \"calls\": %u, \"total_s\": %.9f, "
+              "\"min_s\": %.9f, \"mean_s\": %.9f, \"p99_s\": %.9f, "
+              "\"max_s\": %.9f}%s\n",
+              PHASE_NAMES[p], profile->phases[p].count, stats.total,
+              stats.min, stats.mean, stats.p99, stats.max,
+              p == PHASE_COUNT - 1 ? "" : ",");
+    } else {
+      fprintf(file, "%s,%u,%.9f,%.9f,%.9f,%.9f,%.9f\n", PHASE_NAMES[p],
+              profile->phases[p].count, stats.total, stats.min, stats.mean,
+              stats.p99, stats.max);
+    }
+  }
+
+  if (json)
+    fprintf(file, "  ]%s\n", allocCounted() ? "," : "\n}");
+
+  // Allocations per step, against the regressions of the update loop
+  if (allocCounted()) {
+    PhaseStats calls = phaseStats(&profile->allocations);
+    PhaseStats bytes = phaseStats(&profile->allocated_bytes);
+    if (json) {
+      fprintf(file,
+              "  \"allocations\": {\"calls\": %.0f, \"bytes\": %.0f, "
+              "\"calls_per_step\": %.3f, \"calls_per_step_p99\": %.0f, "
+              "\"calls_per_step_max\": %.0f, \"bytes_per_step\": %.1f, "
+              "\"bytes_per_step_max\": %.0f, \"peak_rss_kib\": %ld}\n}\n",
+              calls.total, bytes.total, calls.mean, calls.p99, calls.max,
+              bytes.mean, bytes.max, peakResidentKiB());
+    } else {
+      fprintf(file,
+              "# allocations calls=%.0f bytes=%.0f calls_per_step=%.3f "
+              "calls_per_step_p99=%.0f calls_per_step_max=%.0f "
+              "bytes_per_step=%.1f bytes_per_step_max=%.0f "
+              "peak_rss_kib=%ld\n",
+              calls.total, bytes.total, calls.mean, calls.p99, calls.max,
+              bytes.mean, bytes.max, peakResidentKiB());
+    }
+  }
+  fclose(file);
+  return 0;
+}
+
+/**
+ * De-allocate a profile
+ */
+void freeProfile(Profile *profile) {
+  if (profile == NULL)
+    return;
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    free(profile->phases[p].samples);
+  }
+  free(profile->allocations.samples);
+  free(profile->allocated_bytes.samples);
+  free(profile->threads);
+  free(profile);
+}
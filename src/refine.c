@@ -0,0 +1,737 @@
+#include "../include/refine.h"
+#include "../include/log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Part of the thresholds under which four faces are merged back, so that a
+// face is not split and merged again at every adaptation
+#define REFINE_HYSTERESIS 0.5f
+
+// Candidate spring between the points a < b
+typedef struct Candidate {
+  unsigned int a, b;
+  unsigned int kind;
+  bool along_i; // along the lines of the grid, STIFFNESS_H, else STIFFNESS_V
+  float side;   // side of its faces, in lattice steps
+  float damage; // damage it starts with, if it replaces no spring
+} Candidate;
+
+enum { KIND_STRUCTURAL, KIND_SHEAR, KIND_FLEXION };
+
+// Spring of the mesh before an adaptation, by the lattice index of its points
+typedef struct OldSpring {
+  uint64_t key;
+  meshIndex spring;
+} OldSpring;
+
+static int compareLeaves(const void *a, const void *b) {
+  const Leaf *x = (const Leaf *)a, *y = (const Leaf *)b;
+  if (x->i != y->i)
+    return x->i < y->i ? -1 : 1;
+  return x->j < y->j ? -1 : x->j > y->j;
+}
+
+static int compareCandidates(const void *a, const void *b) {
+  const Candidate *x = (const Candidate *)a, *y = (const Candidate *)b;
+  if (x->a != y->a)
+    return x->a < y->a ? -1 : 1;
+  return x->b < y->b ? -1 : x->b > y->b;
+}
+
+static int compareOldSprings(const void *a, const void *b) {
+  const OldSpring *x = (const OldSpring *)a, *y = (const OldSpring *)b;
+  return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int compareUnsigned(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+  return x < y ? -1 : x > y;
+}
+
+unsigned int leafSide(const Refinement *refinement, const Leaf *leaf) {
+  return 1u << (refinement->levels - leaf->level);
+}
+
+/**
+ * Number the corners of the leaves in the order of the lattice
+ */
+static void numberPoints(Refinement *refinement) {
+  size_t size = (size_t)refinement->n * refinement->m;
+  unsigned int *point_of = refinement->point_of;
+  memset(point_of, 0xff, size * sizeof(unsigned int));
+  for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+    const Leaf *leaf = &refinement->leaves[l];
+    unsigned int side = leafSide(refinement, leaf);
+    size_t corner = (size_t)leaf->i * refinement->m + leaf->j;
+    point_of[corner] = 0;
+    point_of[corner + side] = 0;
+    point_of[corner + (size_t)side * refinement->m] = 0;
+    point_of[corner + (size_t)side * refinement->m + side] = 0;
+  }
+
+  unsigned int n_points = 0;
+  for (size_t k = 0; k < size; k++) {
+    if (point_of[k] != REFINE_NONE)
+      n_points++;
+  }
+  free(refinement->points);
+  refinement->points = (unsigned int *)malloc(n_points * sizeof(unsigned int));
+  refinement->n_points = 0;
+  for (size_t k = 0; k < size; k++) {
+    if (point_of[k] == REFINE_NONE)
+      continue;
+    point_of[k] = refinement->n_points;
+    refinement->points[refinement->n_points++] = (unsigned int)k;
+  }
+}
+
+/**
+ * The faces of the N x M grid, which can each be split `levels` times
+ */
+Refinement *newRefinement(unsigned int N, unsigned int M, unsigned int levels) {
+  Refinement *refinement = (Refinement *)calloc(1, sizeof(Refinement));
+  refinement->levels = levels;
+  refinement->n = ((N - 1) << levels) + 1;
+  refinement->m = ((M - 1) << levels) + 1;
+  refinement->n_leaves = (N - 1) * (M - 1);
+  refinement->leaves = (Leaf *)malloc(refinement->n_leaves * sizeof(Leaf));
+  for (unsigned int i = 0; i < N - 1; i++) {
+    for (unsigned int j = 0; j < M - 1; j++) {
+      Leaf leaf = {i << levels, j << levels, 0, 0.0f};
+      refinement->leaves[i * (M - 1) + j] = leaf;
+    }
+  }
+  refinement->point_of = (unsigned int *)malloc(
+      (size_t)refinement->n * refinement->m * sizeof(unsigned int));
+  numberPoints(refinement);
+  return refinement;
+}
+
+/**
+ * Point at the lattice coordinates (i, j), REFINE_NONE if there is none
+ */
+static unsigned int pointAt(const Refinement *refinement, unsigned int i,
+                            unsigned int j) {
+  return refinement->point_of[(size_t)i * refinement->m + j];
+}
+
+/**
+ * The four corners of a leaf, in the order of its edges
+ */
+static void leafCorners(const Refinement *refinement, const Leaf *leaf,
+                        unsigned int corners[4]) {
+  unsigned int side = leafSide(refinement, leaf);
+  corners[0] = pointAt(refinement, leaf->i, leaf->j);
+  corners[1] = pointAt(refinement, leaf->i + side, leaf->j);
+  corners[2] = pointAt(refinement, leaf->i + side, leaf->j + side);
+  corners[3] = pointAt(refinement, leaf->i, leaf->j + side);
+}
+
+/**
+ * The leaves as the quads of a surface, its fixed points left to the caller
+ */
+Surface *refinementSurface(const Refinement *refinement) {
+  Surface *surface = (Surface *)calloc(1, sizeof(Surface));
+  surface->n_points = refinement->n_points;
+  surface->n_faces = refinement->n_leaves;
+  surface->faces = malloc(surface->n_faces * sizeof(*surface->faces));
+  for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+    leafCorners(refinement, &refinement->leaves[l], surface->faces[l]);
+  }
+  surface->fixed = (bool *)calloc(surface->n_points, sizeof(bool));
+  linkSurfaceFaces(surface);
+  return surface;
+}
+
+/**
+ * The points around the leaf l, from its corner (i, j) in the order of its
+ * edges: its corners and the corners of the finer leaves on its edges.
+ * Return their number, at most REFINE_OUTLINE.
+ */
+unsigned int leafOutline(const Refinement *refinement, unsigned int l,
+                         unsigned int *points) {
+  const Leaf *leaf = &refinement->leaves[l];
+  unsigned int side = leafSide(refinement, leaf);
+  // Start and direction of each edge, around the leaf
+  const int edges[4][4] = {{0, 0, 1, 0},
+                           {(int)side, 0, 0, 1},
+                           {(int)side, (int)side, -1, 0},
+                           {0, (int)side, 0, -1}};
+  unsigned int count = 0;
+  for (unsigned int e = 0; e < 4; e++) {
+    unsigned int i = leaf->i + edges[e][0], j = leaf->j + edges[e][1];
+    for (unsigned int t = 0; t < side; t++) {
+      unsigned int point = pointAt(refinement, i + t * edges[e][2],
+                                   j + t * edges[e][3]);
+      if (point != REFINE_NONE)
+        points[count++] = point;
+    }
+  }
+  return count;
+}
+
+/**
+ * Append the segments of the edges of the leaf l, from one point of the
+ * lattice to the next along the edge
+ */
+static unsigned int leafEdges(const Refinement *refinement, unsigned int l,
+                              Candidate *candidates) {
+  const Leaf *leaf = &refinement->leaves[l];
+  float side = (float)leafSide(refinement, leaf);
+  unsigned int outline[REFINE_OUTLINE];
+  unsigned int count = leafOutline(refinement, l, outline);
+  for (unsigned int k = 0; k < count; k++) {
+    unsigned int a = outline[k], b = outline[(k + 1) % count];
+    // Along the lines if both points are on the same column
+    bool along_i = refinement->points[a] % refinement->m ==
+                   refinement->points[b] % refinement->m;
+    Candidate edge = {a < b ? a : b, a < b ? b : a, KIND_STRUCTURAL,
+                      along_i, side, leaf->damage};
+    candidates[k] = edge;
+  }
+  return count;
+}
+
+/**
+ * Build the springs of the refined grid, sorted by their points, and the
+ * springs of the edges of every leaf in face_springs, SPRINGS_PER_FACE per
+ * leaf. The segments of the edges are the structural springs, the diagonals
+ * of the leaves the shear ones, and two segments in line the flexion ones.
+ * Return the number of springs.
+ *
+ * A square of springs resists a stretch the same whatever its side, so the
+ * springs of every level have the stiffness of those of the grid, the mass
+ * of the points following the area of their leaves, see refinementMasses. A
+ * segment of the edge between two leaves of different levels holds a strip
+ * as wide as the mean of their sides, and is stiffer by the ratio of this
+ * width to its length.
+ */
+meshIndex refinementSprings(const Refinement *refinement,
+                            const Params *params, Spring **springs,
+                            meshIndex **face_springs) {
+  const unsigned int n_points = refinement->n_points;
+
+  // Segments of the edges and diagonals of every leaf
+  Candidate *candidates = (Candidate *)malloc(
+      (size_t)refinement->n_leaves * (SPRINGS_PER_FACE + 2) *
+      sizeof(Candidate));
+  meshIndex n_candidates = 0;
+  for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+    const Leaf *leaf = &refinement->leaves[l];
+    unsigned int c[4];
+    leafCorners(refinement, leaf, c);
+    n_candidates += leafEdges(refinement, l, candidates + n_candidates);
+    float side = (float)leafSide(refinement, leaf);
+    Candidate first = {c[0], c[2], KIND_SHEAR, false, side, leaf->damage};
+    Candidate second = {c[1] < c[3] ? c[1] : c[3], c[1] < c[3] ? c[3] : c[1],
+                        KIND_SHEAR, false, side, leaf->damage};
+    candidates[n_candidates++] = first;
+    candidates[n_candidates++] = second;
+  }
+
+  // An edge between two leaves holds both, the widest damage is kept
+  qsort(candidates, n_candidates, sizeof(Candidate), compareCandidates);
+  meshIndex n_springs = 0;
+  for (meshIndex c = 0; c < n_candidates; c++) {
+    if (n_springs > 0 && candidates[c].a == candidates[n_springs - 1].a &&
+        candidates[c].b == candidates[n_springs - 1].b) {
+      Candidate *kept = &candidates[n_springs - 1];
+      kept->side = 0.5f * (kept->side + candidates[c].side);
+      kept->damage = fmaxf(kept->damage, candidates[c].damage);
+      continue;
+    }
+    candidates[n_springs++] = candidates[c];
+  }
+
+  // Neighbours of every point along the lattice, +i, -i, +j, -j, to join
+  // two segments in line by a flexion spring
+  unsigned int(*next)[4] = malloc(n_points * sizeof(*next));
+  meshIndex(*segment)[4] = malloc(n_points * sizeof(*segment));
+  memset(next, 0xff, n_points * sizeof(*next));
+  for (meshIndex s = 0; s < n_springs; s++) {
+    if (candidates[s].kind != KIND_STRUCTURAL)
+      continue;
+    unsigned int a = candidates[s].a, b = candidates[s].b; // b after a
+    unsigned int d = candidates[s].along_i ? 0 : 2;
+    next[a][d] = b;
+    segment[a][d] = s;
+    next[b][d + 1] = a;
+    segment[b][d + 1] = s;
+  }
+  meshIndex n_flexion = 0;
+  for (unsigned int p = 0; p < n_points; p++) {
+    for (unsigned int d = 0; d < 4; d += 2) {
+      n_flexion += next[p][d] != REFINE_NONE && next[p][d + 1] != REFINE_NONE;
+    }
+  }
+  candidates = (Candidate *)realloc(
+      candidates, (size_t)(n_springs + n_flexion) * sizeof(Candidate));
+  meshIndex n_all = n_springs;
+  for (unsigned int p = 0; p < n_points; p++) {
+    for (unsigned int d = 0; d < 4; d += 2) {
+      if (next[p][d] == REFINE_NONE || next[p][d + 1] == REFINE_NONE)
+        continue;
+      const Candidate *after = &candidates[segment[p][d]];
+      const Candidate *before = &candidates[segment[p][d + 1]];
+      Candidate flexion = {next[p][d + 1],
+                           next[p][d],
+                           KIND_FLEXION,
+                           d == 0,
+                           0.5f * (after->side + before->side),
+                           fmaxf(after->damage, before->damage)};
+      candidates[n_all++] = flexion;
+    }
+  }
+  free(next);
+  free(segment);
+  qsort(candidates, n_all, sizeof(Candidate), compareCandidates);
+
+  *springs = (Spring *)malloc(n_all * sizeof(Spring));
+  for (meshIndex s = 0; s < n_all; s++) {
+    const Candidate *c = &candidates[s];
+    float base = c->kind == KIND_SHEAR ? params->STIFFNESS_D
+                 : c->along_i          ? params->STIFFNESS_H
+                                       : params->STIFFNESS_V;
+    float scale = 1.0f;
+    if (c->kind == KIND_STRUCTURAL) {
+      unsigned int la = refinement->points[c->a];
+      unsigned int lb = refinement->points[c->b];
+      float length = c->along_i ? (float)((lb - la) / refinement->m)
+                                : (float)(lb - la);
+      scale *= c->side / length;
+    }
+    Point a = {0, c->a}, b = {0, c->b};
+    (*springs)[s] = newSpring(a, b, base * scale);
+    (*springs)[s].damage = c->damage;
+  }
+
+  // Segments of the edges of each leaf, in the order around it
+  *face_springs = (meshIndex *)malloc(
+      (size_t)refinement->n_leaves * SPRINGS_PER_FACE * sizeof(meshIndex));
+  Candidate edges[SPRINGS_PER_FACE];
+  for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+    meshIndex *slots = *face_springs + (size_t)l * SPRINGS_PER_FACE;
+    unsigned int count = leafEdges(refinement, l, edges);
+    for (unsigned int k = 0; k < SPRINGS_PER_FACE; k++) {
+      const Candidate *found =
+          k < count ? (const Candidate *)bsearch(&edges[k], candidates, n_all,
+                                                 sizeof(Candidate),
+                                                 compareCandidates)
+                    : NULL;
+      slots[k] = found != NULL ? (meshIndex)(found - candidates) : NO_SPRING;
+    }
+  }
+
+  free(candidates);
+  return n_all;
+}
+
+/**
+ * Mass of every point relative to the points of the grid, the mean area of
+ * the leaves it is a corner of, relative to a face of the grid
+ */
+void refinementMasses(const Refinement *refinement, float *mass) {
+  const float S = (float)(1u << refinement->levels);
+  unsigned int *count =
+      (unsigned int *)calloc(refinement->n_points, sizeof(unsigned int));
+  memset(mass, 0, refinement->n_points * sizeof(float));
+  for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+    const Leaf *leaf = &refinement->leaves[l];
+    float side = leafSide(refinement, leaf) / S;
+    unsigned int c[4];
+    leafCorners(refinement, leaf, c);
+    for (unsigned int k = 0; k < 4; k++) {
+      mass[c[k]] += side * side;
+      count[c[k]]++;
+    }
+  }
+  for (unsigned int p = 0; p < refinement->n_points; p++) {
+    mass[p] /= count[p];
+  }
+  free(count);
+}
+
+/**
+ * Largest strain of the edges and diagonals of a leaf, and smallest cosine
+ * of the angle between its normal and the normals at its corners
+ */
+static void leafIndicators(const Refinement *refinement, const Leaf *leaf,
+                           const Surface *surface, const Vector *P,
+                           const Vector *P0, float *strain, float *cosine) {
+  unsigned int c[4];
+  leafCorners(refinement, leaf, c);
+  const unsigned int pairs[6][2] = {{0, 1}, {1, 2}, {2, 3},
+                                    {3, 0}, {0, 2}, {1, 3}};
+  *strain = 0.0f;
+  for (unsigned int k = 0; k < 6; k++) {
+    unsigned int a = c[pairs[k][0]], b = c[pairs[k][1]];
+    float rest = norm(newVectorFromPoint(P0[a], P0[b]));
+    float length = norm(newVectorFromPoint(P[a], P[b]));
+    *strain = fmaxf(*strain, fabsf(length - rest) / rest);
+  }
+
+  Vector normal =
+      normalize(crossProduct(newVectorFromPoint(P[c[0]], P[c[2]]),
+                             newVectorFromPoint(P[c[1]], P[c[3]])));
+  *cosine = 1.0f;
+  for (unsigned int k = 0; k < 4; k++) {
+    *cosine = fminf(*cosine,
+                    scalar_product(normal, surfaceNormal(surface, P, c[k])));
+  }
+}
+
+/**
+ * True if a point of the lattice lies on the edges of the square of the
+ * given side at (i, j), elsewhere than every `step` lattice steps
+ */
+static bool hasPointsBetween(const Refinement *refinement, unsigned int i,
+                             unsigned int j, unsigned int side,
+                             unsigned int step) {
+  for (unsigned int t = 1; t < side; t++) {
+    if (t % step == 0)
+      continue;
+    if (pointAt(refinement, i + t, j) != REFINE_NONE ||
+        pointAt(refinement, i + t, j + side) != REFINE_NONE ||
+        pointAt(refinement, i, j + t) != REFINE_NONE ||
+        pointAt(refinement, i + side, j + t) != REFINE_NONE)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Append the four quarters of a leaf
+ */
+static unsigned int splitLeaf(const Refinement *refinement, const Leaf *leaf,
+                              Leaf *leaves) {
+  unsigned int half = leafSide(refinement, leaf) / 2;
+  for (unsigned int q = 0; q < 4; q++) {
+    Leaf quarter = {leaf->i + (q / 2) * half, leaf->j + (q % 2) * half,
+                    leaf->level + 1, leaf->damage};
+    leaves[q] = quarter;
+  }
+  return 4;
+}
+
+/**
+ * Set the leaves, sorted, and number their points
+ */
+static void setLeaves(Refinement *refinement, Leaf *leaves,
+                      unsigned int n_leaves) {
+  free(refinement->leaves);
+  refinement->leaves = leaves;
+  refinement->n_leaves = n_leaves;
+  qsort(leaves, n_leaves, sizeof(Leaf), compareLeaves);
+  numberPoints(refinement);
+}
+
+/**
+ * Split the leaves next to a leaf two levels finer, until there is none
+ */
+static void balanceLeaves(Refinement *refinement) {
+  bool split = true;
+  while (split) {
+    split = false;
+    Leaf *leaves = (Leaf *)malloc(4 * refinement->n_leaves * sizeof(Leaf));
+    unsigned int n_leaves = 0;
+    for (unsigned int l = 0; l < refinement->n_leaves; l++) {
+      const Leaf *leaf = &refinement->leaves[l];
+      unsigned int side = leafSide(refinement, leaf);
+      if (side >= 4 &&
+          hasPointsBetween(refinement, leaf->i, leaf->j, side, side / 2)) {
+        n_leaves += splitLeaf(refinement, leaf, leaves + n_leaves);
+        split = true;
+      } else {
+        leaves[n_leaves++] = *leaf;
+      }
+    }
+    setLeaves(refinement, leaves, n_leaves);
+  }
+}
+
+/**
+ * Split the leaves whose strain is over params->REFINE_STRAIN or whose
+ * normal is further than params->REFINE_CURVATURE radians from the normal
+ * at one of its corners, and merge back the groups of four leaves that are
+ * intact and under half these thresholds. The leaves and points before are
+ * kept in old_leaves and old_points. Return false if no leaf changed.
+ */
+bool adaptRefinement(Refinement *refinement, const Surface *surface,
+                     const Vector *P, const Vector *P0, const Spring *springs,
+                     const meshIndex *face_springs,
+                     const uint64_t *broken_faces, const Params *params) {
+  const unsigned int n = refinement->n_leaves;
+  const float split_cosine = cosf(params->REFINE_CURVATURE);
+  const float merge_cosine = cosf(REFINE_HYSTERESIS * params->REFINE_CURVATURE);
+
+  // What every leaf asks for: split, merge, or keep
+  enum { KEEP, SPLIT, MERGE };
+  unsigned char *wish = (unsigned char *)malloc(n);
+  unsigned int n_split = 0, n_merge = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(+ : n_split, n_merge)
+  for (unsigned int l = 0; l < n; l++) {
+    Leaf *leaf = &refinement->leaves[l];
+    float damage = 0.0f;
+    unsigned int count = 0;
+    for (unsigned int k = 0; k < SPRINGS_PER_FACE; k++) {
+      meshIndex spring = face_springs[(size_t)l * SPRINGS_PER_FACE + k];
+      if (spring != NO_SPRING) {
+        damage += springs[spring].damage;
+        count++;
+      }
+    }
+    leaf->damage = count > 0 ? damage / count : 0.0f;
+
+    float strain, cosine;
+    leafIndicators(refinement, leaf, surface, P, P0, &strain, &cosine);
+    bool intact = !((broken_faces[l / 64] >> (l % 64)) & 1);
+    wish[l] = KEEP;
+    if (leaf->level < refinement->levels &&
+        (strain > params->REFINE_STRAIN || cosine < split_cosine)) {
+      wish[l] = SPLIT;
+      n_split++;
+    } else if (leaf->level > 0 && intact &&
+               strain < REFINE_HYSTERESIS * params->REFINE_STRAIN &&
+               cosine > merge_cosine) {
+      wish[l] = MERGE;
+      n_merge++;
+    }
+  }
+
+  // Four leaves of the same parent merge if they all ask to, and if no
+  // leaf next to the parent is more than one level finer than it
+  unsigned int *merged = (unsigned int *)malloc(n * sizeof(unsigned int));
+  unsigned int n_merged = 0;
+  if (n_merge >= 4) {
+    unsigned int *group = (unsigned int *)malloc(n * sizeof(unsigned int));
+    for (unsigned int l = 0; l < n; l++) {
+      if (wish[l] != MERGE)
+        continue;
+      const Leaf *leaf = &refinement->leaves[l];
+      unsigned int parent = 2 * leafSide(refinement, leaf);
+      if (leaf->i % parent == 0 && leaf->j % parent == 0)
+        group[n_merged++] = l; // the first quarter of its parent
+    }
+    unsigned int n_groups = n_merged;
+    n_merged = 0;
+    for (unsigned int g = 0; g < n_groups; g++) {
+      const Leaf *first = &refinement->leaves[group[g]];
+      unsigned int side = leafSide(refinement, first);
+      bool all = true;
+      for (unsigned int q = 1; q < 4 && all; q++) {
+        Leaf key = {first->i + (q / 2) * side, first->j + (q % 2) * side, 0,
+                    0.0f};
+        const Leaf *quarter = (const Leaf *)bsearch(
+            &key, refinement->leaves, n, sizeof(Leaf), compareLeaves);
+        all = quarter != NULL && quarter->level == first->level &&
+              wish[quarter - refinement->leaves] == MERGE;
+      }
+      if (all &&
+          !hasPointsBetween(refinement, first->i, first->j, 2 * side, side))
+        merged[n_merged++] = group[g];
+    }
+    free(group);
+  }
+
+  if (n_split == 0 && n_merged == 0) {
+    free(wish);
+    free(merged);
+    return false;
+  }
+
+  // Keep the leaves and points before, then build the new leaves
+  free(refinement->old_leaves);
+  free(refinement->old_points);
+  refinement->old_n_leaves = n;
+  refinement->old_leaves = (Leaf *)malloc(n * sizeof(Leaf));
+  memcpy(refinement->old_leaves, refinement->leaves, n * sizeof(Leaf));
+  refinement->old_n_points = refinement->n_points;
+  refinement->old_points = refinement->points;
+  refinement->points = NULL;
+
+  Leaf *leaves = (Leaf *)malloc((n + 3 * n_split) * sizeof(Leaf));
+  unsigned int n_leaves = 0;
+  for (unsigned int m = 0; m < n_merged; m++) {
+    const Leaf *first = &refinement->leaves[merged[m]];
+    unsigned int side = leafSide(refinement, first);
+    Leaf parent = {first->i, first->j, first->level - 1, 0.0f};
+    for (unsigned int q = 0; q < 4; q++) {
+      Leaf key = {first->i + (q / 2) * side, first->j + (q % 2) * side, 0,
+                  0.0f};
+      Leaf *quarter = (Leaf *)bsearch(&key, refinement->leaves, n,
+                                      sizeof(Leaf), compareLeaves);
+      parent.damage = fmaxf(parent.damage, quarter->damage);
+      wish[quarter - refinement->leaves] = MERGE + 1; // done
+    }
+    leaves[n_leaves++] = parent;
+  }
+  for (unsigned int l = 0; l < n; l++) {
+    if (wish[l] == SPLIT)
+      n_leaves += splitLeaf(refinement, &refinement->leaves[l],
+                            leaves + n_leaves);
+    else if (wish[l] != MERGE + 1)
+      leaves[n_leaves++] = refinement->leaves[l];
+  }
+  free(wish);
+  free(merged);
+
+  setLeaves(refinement, leaves, n_leaves);
+  if (n_split > 0)
+    balanceLeaves(refinement);
+  return true;
+}
+
+/**
+ * Point before the last adaptation at a lattice index, REFINE_NONE if none
+ */
+static unsigned int oldPointAt(const Refinement *refinement, unsigned int k) {
+  const unsigned int *found = (const unsigned int *)bsearch(
+      &k, refinement->old_points, refinement->old_n_points,
+      sizeof(unsigned int), compareUnsigned);
+  return found != NULL ? (unsigned int)(found - refinement->old_points)
+                       : REFINE_NONE;
+}
+
+/**
+ * Positions and velocities of the points after an adaptation: those of the
+ * points that were already there, interpolated in the leaf they were in for
+ * the others
+ */
+void carryPoints(const Refinement *refinement, const Vector *old_P,
+                 const Vector *old_V, Vector *P, Vector *V) {
+  const unsigned int m = refinement->m;
+#pragma omp parallel for schedule(static)
+  for (unsigned int p = 0; p < refinement->n_points; p++) {
+    unsigned int k = refinement->points[p];
+    unsigned int old = oldPointAt(refinement, k);
+    if (old != REFINE_NONE) {
+      P[p] = old_P[old];
+      V[p] = old_V[old];
+      continue;
+    }
+
+    // The old leaf of the level with a corner at (ci, cj), the points on
+    // the last line or column being in the leaves before them
+    unsigned int i = k / m, j = k % m;
+    unsigned int ci = i < refinement->n - 1 ? i : i - 1;
+    unsigned int cj = j < m - 1 ? j : j - 1;
+    for (unsigned int level = refinement->levels + 1; level-- > 0;) {
+      unsigned int side = 1u << (refinement->levels - level);
+      Leaf key = {ci - ci % side, cj - cj % side, 0, 0.0f};
+      const Leaf *leaf = (const Leaf *)bsearch(
+          &key, refinement->old_leaves, refinement->old_n_leaves,
+          sizeof(Leaf), compareLeaves);
+      if (leaf == NULL || leaf->level != level)
+        continue;
+
+      unsigned int c[4] = {
+          oldPointAt(refinement, key.i * m + key.j),
+          oldPointAt(refinement, (key.i + side) * m + key.j),
+          oldPointAt(refinement, (key.i + side) * m + key.j + side),
+          oldPointAt(refinement, key.i * m + key.j + side)};
+      float u = (float)(i - key.i) / side, v = (float)(j - key.j) / side;
+      float w[4] = {(1 - u) * (1 - v), u * (1 - v), u * v, (1 - u) * v};
+      Vector position = {0.0f, 0.0f, 0.0f}, velocity = {0.0f, 0.0f, 0.0f};
+      for (unsigned int q = 0; q < 4; q++) {
+        position = addVector(position, multVector(w[q], old_P[c[q]]));
+        velocity = addVector(velocity, multVector(w[q], old_V[c[q]]));
+      }
+      P[p] = position;
+      V[p] = velocity;
+      break;
+    }
+  }
+}
+
+/**
+ * Key of the spring between the lattice indices a and b
+ */
+static uint64_t springKey(unsigned int a, unsigned int b) {
+  return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+}
+
+/**
+ * Old spring between the lattice points (ai, aj) and (bi, bj), NULL if
+ * there is none or they are out of the lattice
+ */
+static const OldSpring *findOldSpring(const Refinement *refinement,
+                                      const OldSpring *old,
+                                      meshIndex n_old, long ai, long aj,
+                                      long bi, long bj) {
+  const long n = refinement->n, m = refinement->m;
+  if (ai < 0 || aj < 0 || bi < 0 || bj < 0 || ai >= n || bi >= n ||
+      aj >= m || bj >= m)
+    return NULL;
+  OldSpring key = {springKey(ai * m + aj, bi * m + bj), 0};
+  return (const OldSpring *)bsearch(&key, old, n_old, sizeof(OldSpring),
+                                    compareOldSprings);
+}
+
+/**
+ * Carry the damage and the state of the springs before an adaptation to
+ * the springs after it. A spring keeps those of the same spring before, or
+ * of the spring twice as long it is half of, or of the two springs it joins.
+ * The others keep the damage of the leaf they were built in.
+ */
+void carrySprings(const Refinement *refinement, Spring *springs,
+                  meshIndex n_springs, const Spring *old_springs,
+                  meshIndex old_n_springs) {
+  const unsigned int m = refinement->m;
+  OldSpring *old =
+      (OldSpring *)malloc(old_n_springs * sizeof(OldSpring));
+  for (meshIndex s = 0; s < old_n_springs; s++) {
+    old[s].key = springKey(refinement->old_points[old_springs[s].ext_1.j],
+                           refinement->old_points[old_springs[s].ext_2.j]);
+    old[s].spring = s;
+  }
+  qsort(old, old_n_springs, sizeof(OldSpring), compareOldSprings);
+
+#pragma omp parallel for schedule(static)
+  for (meshIndex s = 0; s < n_springs; s++) {
+    Spring *spring = &springs[s];
+    unsigned int a = refinement->points[spring->ext_1.j];
+    unsigned int b = refinement->points[spring->ext_2.j];
+    long ai = a / m, aj = a % m, bi = b / m, bj = b % m;
+    long di = bi - ai, dj = bj - aj;
+
+    const OldSpring *same =
+        findOldSpring(refinement, old, old_n_springs, ai, aj, bi, bj);
+    if (same == NULL) // half of a spring
+      same = findOldSpring(refinement, old, old_n_springs, ai, aj, bi + di,
+                           bj + dj);
+    if (same == NULL)
+      same = findOldSpring(refinement, old, old_n_springs, ai - di, aj - dj,
+                           bi, bj);
+    if (same != NULL) {
+      spring->damage = old_springs[same->spring].damage;
+      spring->isBreak = old_springs[same->spring].isBreak;
+      continue;
+    }
+
+    if (di % 2 != 0 || dj % 2 != 0)
+      continue;
+    const OldSpring *first = findOldSpring(refinement, old, old_n_springs, ai,
+                                           aj, ai + di / 2, aj + dj / 2);
+    const OldSpring *second = findOldSpring(
+        refinement, old, old_n_springs, ai + di / 2, aj + dj / 2, bi, bj);
+    if (first != NULL && second != NULL) { // two springs joined
+      const Spring *x = &old_springs[first->spring];
+      const Spring *y = &old_springs[second->spring];
+      spring->damage = fmaxf(x->damage, y->damage);
+      spring->isBreak = x->isBreak || y->isBreak;
+    }
+  }
+  free(old);
+}
+
+void freeRefinement(Refinement *refinement) {
+  if (refinement == NULL)
+    return;
+  free(refinement->leaves);
+  free(refinement->points);
+  free(refinement->point_of);
+  free(refinement->old_leaves);
+  free(refinement->old_points);
+  free(refinement);
+}
@@ -0,0 +1,389 @@
+#include "../include/render.h"
+#include "../include/log.h"
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define BAND_ROWS 16     // rows of the image rasterized by one task
+#define AMBIENT 0.25f    // lighting of a face seen edge-on
+#define NEAR_PLANE 1e-3f // distance under which a point is not drawn
+#define FIT_MARGIN 1.2f  // room left around the mesh, which sags and waves
+
+static const float BACKGROUND = 0.96f;
+static const float CLOTH_COLOR[3] = {0.85f, 0.70f, 0.50f};
+static const float BROKEN_COLOR[3] = {0.90f, 0.15f, 0.15f};
+
+// Side from which the camera looks at the mesh when its eye is not given
+static const Vector FIT_DIRECTION = {0.4f, 0.6f, 1.0f};
+
+Camera defaultCamera(void) {
+  Camera camera = {.up = {0.0f, 1.0f, 0.0f},
+                   .has_eye = false,
+                   .has_target = false,
+                   .fov = RENDER_DEFAULT_FOV,
+                   .width = RENDER_DEFAULT_WIDTH,
+                   .height = RENDER_DEFAULT_HEIGHT};
+  return camera;
+}
+
+bool parseImageFormat(const char *name, imageFormat *format) {
+  if (strcmp(name, "png") == 0) {
+    *format = IMAGE_PNG;
+  } else if (strcmp(name, "ppm") == 0) {
+    *format = IMAGE_PPM;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *imageFormatName(imageFormat format) {
+  return format == IMAGE_PNG ? "png" : "ppm";
+}
+
+bool parseColorMode(const char *name, colorMode *mode) {
+  if (strcmp(name, "state") == 0) {
+    *mode = COLOR_STATE;
+  } else if (strcmp(name, "strain") == 0) {
+    *mode = COLOR_STRAIN;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Look at the center of the initial positions of the mesh, from far enough
+ * to see all of them and the room they need to move
+ */
+void fitCamera(Camera *camera, const Mesh *mesh) {
+  const Vector *P0 = mesh->P0[0];
+  Vector low = P0[0], high = P0[0];
+  for (unsigned int p = 1; p < mesh->n * mesh->m; p++) {
+    low = newVector(fminf(low.x, P0[p].x), fminf(low.y, P0[p].y),
+                    fminf(low.z, P0[p].z));
+    high = newVector(fmaxf(high.x, P0[p].x), fmaxf(high.y, P0[p].y),
+                     fmaxf(high.z, P0[p].z));
+  }
+  if (!camera->has_target)
+    camera->target = multVector(0.5f, addVector(low, high));
+  if (!camera->has_eye) {
+    float radius = 0.5f * norm(newVectorFromPoint(low, high));
+    float distance =
+        FIT_MARGIN * radius / tanf(camera->fov * (float)M_PI / 360.0f);
+    camera->eye = addVector(camera->target,
+                            multVector(distance, normalize(FIT_DIRECTION)));
+  }
+}
+
+Renderer *newRenderer(const Camera *camera, colorMode color,
+                      imageFormat format) {
+  Renderer *renderer = (Renderer *)malloc(sizeof(Renderer));
+  size_t n_pixels = (size_t)camera->width * camera->height;
+  renderer->camera = *camera;
+  renderer->color = color;
+  renderer->format = format;
+  renderer->pixels = (unsigned char *)malloc(3 * n_pixels);
+  renderer->depth = (float *)malloc(n_pixels * sizeof(float));
+  renderer->n_points = 0;
+  renderer->screen = NULL;
+  renderer->shade = NULL;
+  renderer->n_faces = 0;
+  renderer->colors = NULL;
+  return renderer;
+}
+
+/**
+ * Points around the face f of the mesh, at most REFINE_OUTLINE, returns
+ * their number. The faces of a refined grid also go through the corners of
+ * their finer neighbours, so that no crack is drawn between them.
+ */
+static unsigned int faceCorners(const Mesh *mesh, meshIndex f,
+                                unsigned int *c) {
+  if (mesh->refinement != NULL)
+    return leafOutline(mesh->refinement, f, c);
+  if (mesh->surface != NULL) {
+    memcpy(c, mesh->surface->faces[f], 4 * sizeof(unsigned int));
+    return faceSize(mesh->surface, f);
+  }
+  unsigned int i = f / (mesh->m - 1), j = f % (mesh->m - 1);
+  c[0] = i * mesh->m + j;
+  c[1] = i * mesh->m + j + 1;
+  c[2] = (i + 1) * mesh->m + j + 1;
+  c[3] = (i + 1) * mesh->m + j;
+  return 4;
+}
+
+/**
+ * Normal of the grid at the point (i, j), from its neighbours on each axis
+ */
+static Vector gridNormal(const Mesh *mesh, unsigned int i, unsigned int j) {
+  unsigned int i0 = i > 0 ? i - 1 : i, i1 = i + 1 < mesh->n ? i + 1 : i;
+  unsigned int j0 = j > 0 ? j - 1 : j, j1 = j + 1 < mesh->m ? j + 1 : j;
+  Vector a = newVectorFromPoint(mesh->P[i0][j], mesh->P[i1][j]);
+  Vector b = newVectorFromPoint(mesh->P[i][j0], mesh->P[i][j1]);
+  return normalize(crossProduct(a, b));
+}
+
+/**
+ * Color of the face f, its first component negative if it is not drawn
+ */
+static void faceColor(const Renderer *renderer, const Mesh *mesh,
+                      meshIndex f, float color[3]) {
+  bool intact = isMeshFaceIntact(mesh, f);
+  if (renderer->color == COLOR_STATE) {
+    memcpy(color, intact ? CLOTH_COLOR : BROKEN_COLOR, 3 * sizeof(float));
+    return;
+  }
+  if (!intact) {
+    color[0] = -1.0f;
+    return;
+  }
+
+  // Largest strain of the edges, from blue to red through green
+  unsigned int c[REFINE_OUTLINE];
+  unsigned int size = faceCorners(mesh, f, c);
+  const Vector *P = mesh->P[0], *P0 = mesh->P0[0];
+  float strain = 0.0f;
+  for (unsigned int k = 0; k < size; k++) {
+    unsigned int a = c[k], b = c[(k + 1) % size];
+    float rest = norm(newVectorFromPoint(P0[a], P0[b]));
+    float length = norm(newVectorFromPoint(P[a], P[b]));
+    strain = fmaxf(strain, fabsf(length - rest) / rest);
+  }
+  float t = fminf(strain / RENDER_STRAIN_SCALE, 1.0f);
+  color[0] = t;
+  color[1] = 1.0f - fabsf(2.0f * t - 1.0f);
+  color[2] = 1.0f - t;
+}
+
+/**
+ * Draw the part of the triangle a, b, c between the rows y0 and y1 - 1
+ */
+static void drawTriangle(Renderer *renderer, unsigned int a, unsigned int b,
+                         unsigned int c, const float color[3], int y0,
+                         int y1) {
+  const Vector A = renderer->screen[a], B = renderer->screen[b],
+               C = renderer->screen[c];
+  if (A.z <= 0.0f || B.z <= 0.0f || C.z <= 0.0f)
+    return;
+  int top = (int)ceilf(fminf(A.y, fminf(B.y, C.y)) - 0.5f);
+  int bottom = (int)floorf(fmaxf(A.y, fmaxf(B.y, C.y)) - 0.5f);
+  if (top < y0)
+    top = y0;
+  if (bottom >= y1)
+    bottom = y1 - 1;
+  if (top > bottom)
+    return;
+  float area = (B.x - A.x) * (C.y - A.y) - (B.y - A.y) * (C.x - A.x);
+  if (area == 0.0f)
+    return;
+  int left = (int)ceilf(fminf(A.x, fminf(B.x, C.x)) - 0.5f);
+  int right = (int)floorf(fmaxf(A.x, fmaxf(B.x, C.x)) - 0.5f);
+  if (left < 0)
+    left = 0;
+  if (right >= (int)renderer->camera.width)
+    right = (int)renderer->camera.width - 1;
+
+  const float *shade = renderer->shade;
+  for (int y = top; y <= bottom; y++) {
+    float py = y + 0.5f;
+    for (int x = left; x <= right; x++) {
+      float px = x + 0.5f;
+      // Barycentric coordinates of the center of the pixel
+      float wa = ((B.x - px) * (C.y - py) - (B.y - py) * (C.x - px)) / area;
+      float wb = ((C.x - px) * (A.y - py) - (C.y - py) * (A.x - px)) / area;
+      float wc = ((A.x - px) * (B.y - py) - (A.y - py) * (B.x - px)) / area;
+      if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+        continue;
+      size_t pixel = (size_t)y * renderer->camera.width + x;
+      float z = wa * A.z + wb * B.z + wc * C.z;
+      if (z <= renderer->depth[pixel])
+        continue;
+      renderer->depth[pixel] = z;
+      float light = wa * shade[a] + wb * shade[b] + wc * shade[c];
+      for (unsigned int k = 0; k < 3; k++) {
+        renderer->pixels[3 * pixel + k] =
+            (unsigned char)(255.0f * color[k] * light + 0.5f);
+      }
+    }
+  }
+}
+
+/**
+ * Draw the faces of the mesh in the pixels of the renderer. Each point is
+ * projected and lit once, then every band of rows of the image is drawn by
+ * one thread from all the faces, so no pixel is shared and the image does
+ * not depend on the number of threads.
+ */
+void renderMesh(Renderer *renderer, const Mesh *mesh) {
+  const Camera *camera = &renderer->camera;
+  const unsigned int n_points = mesh->n * mesh->m;
+  const meshIndex n_faces =
+      mesh->surface != NULL ? mesh->surface->n_faces
+                            : (mesh->n - 1) * (mesh->m - 1);
+  if (renderer->n_points < n_points) {
+    free(renderer->screen);
+    free(renderer->shade);
+    renderer->screen = (Vector *)malloc(n_points * sizeof(Vector));
+    renderer->shade = (float *)malloc(n_points * sizeof(float));
+    renderer->n_points = n_points;
+  }
+  if (renderer->n_faces < n_faces) {
+    free(renderer->colors);
+    renderer->colors = (float(*)[3])malloc(n_faces * sizeof(float[3]));
+    renderer->n_faces = n_faces;
+  }
+
+  // Axes of the camera, the light coming from the eye
+  Vector forward = normalize(newVectorFromPoint(camera->eye, camera->target));
+  Vector right = normalize(crossProduct(forward, camera->up));
+  Vector up = crossProduct(right, forward);
+  float focal =
+      0.5f * camera->height / tanf(camera->fov * (float)M_PI / 360.0f);
+
+#pragma omp parallel for schedule(static)
+  for (unsigned int p = 0; p < n_points; p++) {
+    Vector d = newVectorFromPoint(camera->eye, mesh->P[0][p]);
+    float z = scalar_product(d, forward);
+    if (z < NEAR_PLANE) {
+      renderer->screen[p].z = 0.0f;
+    } else {
+      renderer->screen[p] =
+          newVector(0.5f * camera->width + focal * scalar_product(d, right) / z,
+                    0.5f * camera->height - focal * scalar_product(d, up) / z,
+                    1.0f / z);
+    }
+    Vector normal = mesh->surface != NULL
+                        ? surfaceNormal(mesh->surface, mesh->P[0], p)
+                        : gridNormal(mesh, p / mesh->m, p % mesh->m);
+    renderer->shade[p] =
+        AMBIENT + (1.0f - AMBIENT) * fabsf(scalar_product(normal, forward));
+  }
+
+#pragma omp parallel for schedule(static)
+  for (meshIndex f = 0; f < n_faces; f++) {
+    faceColor(renderer, mesh, f, renderer->colors[f]);
+  }
+
+  const int height = (int)camera->height;
+  const int n_bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+  const unsigned char background = (unsigned char)(255.0f * BACKGROUND);
+#pragma omp parallel for schedule(dynamic)
+  for (int band = 0; band < n_bands; band++) {
+    int y0 = band * BAND_ROWS;
+    int y1 = y0 + BAND_ROWS < height ? y0 + BAND_ROWS : height;
+    size_t first = (size_t)y0 * camera->width;
+    size_t count = (size_t)(y1 - y0) * camera->width;
+    memset(renderer->pixels + 3 * first, background, 3 * count);
+    memset(renderer->depth + first, 0, count * sizeof(float));
+
+    for (meshIndex f = 0; f < n_faces; f++) {
+      const float *color = renderer->colors[f];
+      if (color[0] < 0.0f)
+        continue;
+      unsigned int c[REFINE_OUTLINE];
+      unsigned int size = faceCorners(mesh, f, c);
+      for (unsigned int k = 1; k + 1 < size; k++) {
+        drawTriangle(renderer, c[0], c[k], c[k + 1], color, y0, y1);
+      }
+    }
+  }
+}
+
+/**
+ * Write a PNG chunk of the given type and data
+ */
+static void writeChunk(FILE *file, const char *type, const unsigned char *data,
+                       uint32_t size) {
+  unsigned char header[8] = {size >> 24, size >> 16, size >> 8, size};
+  memcpy(header + 4, type, 4);
+  uLong crc = crc32(crc32(0L, Z_NULL, 0), header + 4, 4);
+  if (size > 0) // IEND has no data, and crc32 of NULL restarts at 0
+    crc = crc32(crc, data, size);
+  unsigned char footer[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+  fwrite(header, 1, 8, file);
+  if (size > 0)
+    fwrite(data, 1, size, file);
+  fwrite(footer, 1, 4, file);
+}
+
+/**
+ * Write the pixels as a PNG image. Each row is stored as its difference
+ * with the pixel on its left, which the flat colors of the cloth and of the
+ * background turn into long runs of zeros.
+ */
+static void writePNG(const Renderer *renderer, FILE *file) {
+  const unsigned int width = renderer->camera.width;
+  const unsigned int height = renderer->camera.height;
+  const size_t row = 1 + 3 * (size_t)width;
+  unsigned char *filtered = (unsigned char *)malloc(row * height);
+#pragma omp parallel for schedule(static)
+  for (unsigned int y = 0; y < height; y++) {
+    const unsigned char *pixels = renderer->pixels + 3 * (size_t)y * width;
+    unsigned char *line = filtered + y * row;
+    line[0] = 1; // the Sub filter
+    for (size_t k = 0; k < 3 * (size_t)width; k++) {
+      line[1 + k] = pixels[k] - (k >= 3 ? pixels[k - 3] : 0);
+    }
+  }
+  uLongf size = compressBound(row * height);
+  unsigned char *compressed = (unsigned char *)malloc(size);
+  compress2(compressed, &size, filtered, row * height, Z_BEST_SPEED);
+
+  static const unsigned char SIGNATURE[8] = {0x89, 'P',  'N',  'G',
+                                             '\r', '\n', 0x1a, '\n'};
+  unsigned char header[13] = {width >> 24,  width >> 16,  width >> 8,  width,
+                              height >> 24, height >> 16, height >> 8, height,
+                              8, // bits per sample
+                              2, // RGB
+                              0, 0, 0};
+  fwrite(SIGNATURE, 1, 8, file);
+  writeChunk(file, "IHDR", header, 13);
+  writeChunk(file, "IDAT", compressed, (uint32_t)size);
+  writeChunk(file, "IEND", NULL, 0);
+  free(filtered);
+  free(compressed);
+}
+
+/**
+ * Render the mesh and write the image in output_filename, in the format of
+ * the renderer
+ */
+void convertMeshToImage(Renderer *renderer, const Mesh *mesh,
+                        const char *output_filename) {
+  PROFILE_START(mesh->profile, render_start);
+  renderMesh(renderer, mesh);
+  PROFILE_STOP(mesh->profile, PHASE_RENDER, render_start);
+
+  PROFILE_START(mesh->profile, write_start);
+  FILE *file = fopen(output_filename, "wb");
+  if (file == NULL) {
+    log_error("Error: Could not open file %s.\n", output_filename);
+    return;
+  }
+  if (renderer->format == IMAGE_PNG) {
+    writePNG(renderer, file);
+  } else {
+    fprintf(file, "P6\n%u %u\n255\n", renderer->camera.width,
+            renderer->camera.height);
+    fwrite(renderer->pixels, 3,
+           (size_t)renderer->camera.width * renderer->camera.height, file);
+  }
+  fclose(file);
+  PROFILE_STOP(mesh->profile, PHASE_IMAGE_WRITE, write_start);
+}
+
+void freeRenderer(Renderer *renderer) {
+  if (renderer == NULL)
+    return;
+  free(renderer->pixels);
+  free(renderer->depth);
+  free(renderer->screen);
+  free(renderer->shade);
+  free(renderer->colors);
+  free(renderer);
+}
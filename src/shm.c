@@ -0,0 +1,229 @@
+#include "../include/shm.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Size of a slot rounded up to a cache line so two slots never share one,
+ * the header taking a whole line
+ */
+static uint64_t slotSize(unsigned int n, unsigned int m) {
+  uint64_t size = sizeof(ShmSlot) + 3ull * n * m * sizeof(float) +
+                  (uint64_t)(n - 1) * (m - 1);
+  return (size + SHM_CACHE_LINE - 1) & ~(uint64_t)(SHM_CACHE_LINE - 1);
+}
+
+/**
+ * Size of the shared segment of `slots` frames of a mesh of n lines and m
+ * columns
+ */
+size_t shmSegmentSize(unsigned int n, unsigned int m, unsigned int slots) {
+  return sizeof(ShmHeader) + slots * slotSize(n, m);
+}
+
+/**
+ * Return the address of the slot k of the segment
+ */
+static ShmSlot *getSlot(const ShmHeader *header, uint64_t k) {
+  unsigned char *base = (unsigned char *)header + sizeof(ShmHeader);
+  return (ShmSlot *)(base + k * header->slot_size);
+}
+
+/**
+ * Create (or recreate) the shared segment `name` sized for the mesh and
+ * `slots` frames. Return NULL on failure.
+ */
+ShmPublisher *shmOpenPublisher(const char *name, const Mesh *mesh,
+                               unsigned int slots) {
+  if (slots < 2) {
+    log_error("A shared-memory ring buffer needs at least 2 slots");
+    return NULL;
+  }
+  // The name is kept to unlink the segment, it must not be truncated
+  if (strlen(name) >= SHM_NAME_MAX) {
+    log_error("The name of a shared memory has less than %d characters",
+              SHM_NAME_MAX);
+    return NULL;
+  }
+
+  uint64_t slot_size = slotSize(mesh->n, mesh->m);
+  size_t size = shmSegmentSize(mesh->n, mesh->m, slots);
+
+  shm_unlink(name); // drop a segment left by a previous run
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd == -1) {
+    log_error("Cannot create shared memory %s", name);
+    return NULL;
+  }
+  if (ftruncate(fd, size) == -1) {
+    log_error("Cannot resize shared memory %s", name);
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps the segment alive
+  if (base == MAP_FAILED) {
+    log_error("Cannot map shared memory %s", name);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  ShmPublisher *pub = (ShmPublisher *)malloc(sizeof(ShmPublisher));
+  snprintf(pub->name, sizeof(pub->name), "%s", name);
+  pub->size = size;
+  pub->header = (ShmHeader *)base;
+
+  // ftruncate zero-filled the segment: every seq is 0 and head is 0
+  pub->header->n = mesh->n;
+  pub->header->m = mesh->m;
+  pub->header->slots = slots;
+  pub->header->slot_size = slot_size;
+  pub->header->version = SHM_VERSION;
+  // The magic is written last so a reader never sees a half-built header
+  atomic_thread_fence(memory_order_release);
+  pub->header->magic = SHM_MAGIC;
+
+  log_info("Shared memory %s created: %u slots of %lu bytes", name, slots,
+           (unsigned long)slot_size);
+  return pub;
+}
+
+/**
+ * Copy the current state of the mesh into the next slot of the ring. The
+ * writer never waits: a reader caught in the slot will see the seq change.
+ */
+void shmPublishFrame(ShmPublisher *pub, const Mesh *mesh, unsigned int step) {
+  ShmHeader *header = pub->header;
+  uint64_t frame = atomic_load_explicit(&header->head, memory_order_relaxed);
+  ShmSlot *slot = getSlot(header, frame % header->slots);
+
+  // Odd seq: the slot is being written
+  uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+  atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  slot->frame = frame;
+  slot->step = step;
+  slot->n_springs = mesh->n_springs;
+  slot->t = mesh->t;
+
+  float *positions = (float *)(slot + 1);
+  for (unsigned int i = 0; i < mesh->n; i++) {
+    memcpy(positions + 3ull * i * mesh->m, mesh->P[i],
+           mesh->m * sizeof(Vector));
+  }
+
+  unsigned char *faces =
+      (unsigned char *)(positions + 3ull * mesh->n * mesh->m);
+  for (unsigned int i = 0; i < mesh->n - 1; i++) {
+    for (unsigned int j = 0; j < mesh->m - 1; j++) {
+      *faces++ = isFaceIntact(mesh, i, j) ? 1 : 0;
+    }
+  }
+
+  // Even seq: the slot is consistent again, then advertise it
+  atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+  atomic_store_explicit(&header->head, frame + 1, memory_order_release);
+}
+
+/**
+ * Unmap and remove the shared segment
+ */
+void shmClosePublisher(ShmPublisher *pub) {
+  if (pub == NULL)
+    return;
+  munmap(pub->header, pub->size);
+  shm_unlink(pub->name);
+  free(pub);
+}
+
+/**
+ * Map read-only an existing segment. Return NULL if it does not exist or is
+ * not a frame ring buffer.
+ */
+ShmReader *shmOpenReader(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd == -1) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ShmHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  const ShmHeader *header = (const ShmHeader *)base;
+  if (header->magic != SHM_MAGIC || header->version != SHM_VERSION) {
+    munmap(base, st.st_size);
+    return NULL;
+  }
+  atomic_thread_fence(memory_order_acquire);
+
+  ShmReader *reader = (ShmReader *)malloc(sizeof(ShmReader));
+  reader->size = st.st_size;
+  reader->header = header;
+  return reader;
+}
+
+/**
+ * Return the number of frames published so far, the latest being head - 1
+ */
+uint64_t shmLatestFrame(const ShmReader *reader) {
+  return atomic_load_explicit(
+      &((ShmHeader *)reader->header)->head, memory_order_acquire);
+}
+
+/**
+ * Start reading the frame `frame` in place. Return false if the frame is
+ * being written or has already been overwritten by a newer one.
+ */
+bool shmBeginRead(const ShmReader *reader, uint64_t frame,
+                  ShmFrameView *view) {
+  const ShmHeader *header = reader->header;
+  ShmSlot *slot = getSlot(header, frame % header->slots);
+
+  uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+  if (seq & 1)
+    return false;
+
+  view->seq = seq;
+  view->slot = slot;
+  view->frame = slot->frame;
+  view->step = slot->step;
+  view->n_springs = slot->n_springs;
+  view->t = slot->t;
+  view->positions = (const float *)(slot + 1);
+  view->faces = (const unsigned char *)(view->positions +
+                                        3ull * header->n * header->m);
+  return view->frame == frame;
+}
+
+/**
+ * Return true if the frame read since shmBeginRead was not modified meanwhile
+ */
+bool shmEndRead(const ShmFrameView *view) {
+  atomic_thread_fence(memory_order_acquire);
+  ShmSlot *slot = (ShmSlot *)view->slot;
+  return atomic_load_explicit(&slot->seq, memory_order_relaxed) == view->seq;
+}
+
+/**
+ * Unmap the segment, it is left in place for the publisher
+ */
+void shmCloseReader(ShmReader *reader) {
+  if (reader == NULL)
+    return;
+  munmap((void *)reader->header, reader->size);
+  free(reader);
+}
@@ -11,17 +11,18 @@ Spring newSpring(Point ext_a, Point ext_b, float stiff) {
 /**
  * Compute the number of springs needed for the grid n lines, m columns
  */
-unsigned int numberOfSprings(unsigned int n, unsigned int m) {
-  unsigned int n_shear =
+meshIndex numberOfSprings(unsigned int lines, unsigned int columns) {
+  const meshIndex n = lines, m = columns;
+  meshIndex n_shear =
       2 * (n - 1) *
       (m -
        1); // number of springs on the diagonale, HINT: each point on the column
            // has two diagonals except for the last and the first point.
-  unsigned int n_flexion =
+  meshIndex n_flexion =
       (m - 2) * n +
       (n - 2) * m; // number of  2-lenght springs, HINT: each line has n-2
                    // springs of len 2, m-2 for each column
-  unsigned int n_struct =
+  meshIndex n_struct =
       (2 * n - 1) * (m - 1) +
       (n - 1); // number of strings that make a square, HINT: for each point of
                // a column we consider two springs forming a right angle (except
@@ -30,37 +31,133 @@ unsigned int numberOfSprings(unsigned int n, unsigned int m) {
   return n_shear + n_flexion + n_struct; // total number of springs in the mesh
 }
 
+/**
+ * Number of springs fillSprings adds for the first j points of the line i of
+ * a n*m grid
+ */
+static unsigned int lineSprings(unsigned int i, unsigned int j, unsigned int n,
+                                unsigned int m) {
+  unsigned int right = j < m - 1 ? j : m - 1;        // points with (i, j+1)
+  unsigned int right2 = j + 2 < m ? j : (m > 2 ? m - 2 : 0); // with (i, j+2)
+  unsigned int down = i + 1 < n, up = i >= 1, down2 = i + 2 < n;
+  return down * j + right + down * right + up * right + down2 * j + right2;
+}
+
+/**
+ * Index of the first spring fillSprings adds for the point i, j of a n*m
+ * grid when the points are filled line by line: the number of springs of
+ * the points before it
+ */
+meshIndex firstSpringOf(unsigned int i, unsigned int j, unsigned int n,
+                        unsigned int m) {
+  // Lines before i having a line below, one above and two below
+  meshIndex down = i < n - 1 ? i : n - 1;
+  meshIndex up = i > 0 ? i - 1 : 0;
+  meshIndex down2 = i + 2 < n ? i : (n > 2 ? n - 2 : 0);
+  meshIndex right = m - 1, right2 = m > 2 ? m - 2 : 0;
+  return down * (m + right) + (meshIndex)i * (right + right2) + up * right +
+         down2 * m + lineSprings(i, j, n, m);
+}
+
+/**
+ * Springs fillSprings adds for the point i, j of a n*m grid, the bit k being
+ * set for the spring to (i+1, j), (i, j+1), (i+1, j+1), (i-1, j+1), (i+2, j)
+ * and (i, j+2), in the order they are added
+ */
+static unsigned int springMask(int i, int j, int n, int m) {
+  return (i + 1 < n) | (j + 1 < m) << 1 | (i + 1 < n && j + 1 < m) << 2 |
+         (i >= 1 && j + 1 < m) << 3 | (i + 2 < n) << 4 | (j + 2 < m) << 5;
+}
+
+/**
+ * Number of bits set in x
+ */
+static unsigned int bitCount(unsigned int x) {
+  x = x - (x >> 1 & 0x55555555u);
+  x = (x & 0x33333333u) + (x >> 2 & 0x33333333u);
+  return ((x + (x >> 4)) & 0x0f0f0f0fu) * 0x01010101u >> 24;
+}
+
+/**
+ * Springs of the point i, j of a n*m grid filled by fillSprings, as
+ * (index << 1 | 1 if the point is ext_2) in increasing order, only counted
+ * if springs is NULL. Return their number, at most 12.
+ */
+unsigned int gridPointSprings(int i, int j, int n, int m, meshIndex *springs) {
+  // The points whose spring of a kind ends at (i, j), in the order of the
+  // lines; the springs of (i, j) come before those of the last one
+  static const int from[6][3] = {{-2, 0, 4}, {-1, -1, 2}, {-1, 0, 0},
+                                 {0, -2, 5}, {0, -1, 1},  {1, -1, 3}};
+  unsigned int count = 0;
+  for (unsigned int a = 0; a < 6; a++) {
+    if (a == 5) {
+      unsigned int mask = springMask(i, j, n, m);
+      meshIndex k = springs != NULL ? firstSpringOf(i, j, n, m) : 0;
+      for (unsigned int kind = 0; kind < 6; kind++) {
+        if (mask >> kind & 1) {
+          if (springs != NULL)
+            springs[count] = k++ << 1;
+          count++;
+        }
+      }
+    }
+    int pi = i + from[a][0], pj = j + from[a][1];
+    if (pi < 0 || pj < 0 || pi >= n)
+      continue;
+    if (springs != NULL) {
+      // After the springs of (pi, pj) of the kinds before
+      unsigned int before =
+          springMask(pi, pj, n, m) & ((1u << from[a][2]) - 1);
+      meshIndex k = firstSpringOf(pi, pj, n, m) + bitCount(before);
+      springs[count] = k << 1 | 1;
+    }
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Springs of the face (i, j) of a n*m grid in the flat array face_springs
+ */
+static meshIndex *faceSprings(meshIndex *face_springs, int m, int i, int j) {
+  return face_springs + ((size_t)i * (m - 1) + j) * SPRINGS_PER_FACE;
+}
+
 /**
  * Add to the table springs all the possible springs from the index i,j in a n*m
- * matrix and complete the face_index matrix as follow, structural springs index
- * are in position O -> 3, shear springs in position 4, 5, and Flexion springs
- * in position 6 -> 7
+ * matrix and complete the face_springs array as follow, structural springs
+ * index are in position O -> 3, shear springs in position 4, 5, and Flexion
+ * springs in position 6 -> 7. The slots of a face without such a spring are
+ * left as they are.
  */
-void fillSprings(Spring *springs, unsigned int ***face_spring_indices,
-                 unsigned int *spring_index, int i, int j, int n, int m) {
+void fillSprings(Spring *springs, meshIndex *face_springs,
+                 meshIndex *spring_index, int i, int j, int n, int m,
+                 const Params *params) {
   Point current = {i, j};
 
   // Structural Springs (i+1, j) and (i, j+1)
   if (i + 1 < n) {
     Point ext_b = {i + 1, j};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_H);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_H);
 
     if (j < m - 1)
-      face_spring_indices[i][j][0] = *spring_index; // For face (i, j)
+      faceSprings(face_springs, m, i, j)[0] = *spring_index; // For face (i, j)
     if (j - 1 >= 0)
-      face_spring_indices[i][j - 1][1] = *spring_index; // For face (i, j-1)
+      faceSprings(face_springs, m, i, j - 1)[1] =
+          *spring_index; // For face (i, j-1)
 
     (*spring_index)++;
   }
 
   if (j + 1 < m) {
     Point ext_b = {i, j + 1};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_V);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_V);
 
     if (i < n - 1)
-      face_spring_indices[i][j][2] = *spring_index; // For face (i, j)
+      faceSprings(face_springs, m, i, j)[2] = *spring_index; // For face (i, j)
     if (i - 1 >= 0)
-      face_spring_indices[i - 1][j][3] = *spring_index; // For face (i-1, j)
+      faceSprings(face_springs, m, i - 1, j)[3] =
+          *spring_index; // For face (i-1, j)
 
     (*spring_index)++;
   }
@@ -68,22 +165,23 @@ void fillSprings(Spring *springs, unsigned int ***face_spring_indices,
   // Shear Springs (i+1, j+1) and (i-1, j+1)
   if (i + 1 < n && j + 1 < m) {
     Point ext_b = {i + 1, j + 1};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_D);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_D);
 
     // Face (i, j) affected by this shear spring
     if (i < n - 1 && j < m - 1) {
-      face_spring_indices[i][j][4] = *spring_index; // Diagonal spring
+      faceSprings(face_springs, m, i, j)[4] = *spring_index; // Diagonal spring
     }
     (*spring_index)++;
   }
 
   if (i - 1 >= 0 && j + 1 < m) {
     Point ext_b = {i - 1, j + 1};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_D);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_D);
 
     // Face (i-1, j) affected by this shear spring
     if (i - 1 >= 0 && j < m - 1) {
-      face_spring_indices[i - 1][j][5] = *spring_index; // Diagonal spring
+      faceSprings(face_springs, m, i - 1, j)[5] =
+          *spring_index; // Diagonal spring
     }
     (*spring_index)++;
   }
@@ -91,11 +189,11 @@ void fillSprings(Spring *springs, unsigned int ***face_spring_indices,
   // Flexion Springs (i+2, j) and (i, j+2)
   if (i + 2 < n) {
     Point ext_b = {i + 2, j};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_H);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_H);
 
     // Face (i, j) affected by this flexion spring
     if (j < m - 1) {
-      face_spring_indices[i][j][6] =
+      faceSprings(face_springs, m, i, j)[6] =
           *spring_index; // Horizontal spring spanning two cells
     }
     (*spring_index)++;
@@ -103,11 +201,11 @@ void fillSprings(Spring *springs, unsigned int ***face_spring_indices,
 
   if (j + 2 < m) {
     Point ext_b = {i, j + 2};
-    springs[*spring_index] = newSpring(current, ext_b, STIFFNESS_V);
+    springs[*spring_index] = newSpring(current, ext_b, params->STIFFNESS_V);
 
     // Face (i, j) affected by this flexion spring
     if (i < n - 1) {
-      face_spring_indices[i][j][7] =
+      faceSprings(face_springs, m, i, j)[7] =
           *spring_index; // Vertical spring spanning two cells
     }
     (*spring_index)++;
@@ -120,9 +218,10 @@ void fillSprings(Spring *springs, unsigned int ***face_spring_indices,
  * storage springs in the Mesh structure.
  */
 Spring *getPossibleSprings(unsigned int i, unsigned int j, unsigned int n,
-                           unsigned int m, unsigned int *count) {
+                           unsigned int m, unsigned int *count,
+                           const Params *params) {
   Spring *res =
-      (Spring *)malloc(MAX_SPRINGS_PER_POINT *
+      (Spring *)malloc(params->MAX_SPRINGS_PER_POINT *
                        sizeof(Spring)); // 12 springs at most for a single point
 
   unsigned int spring_index = 0;
@@ -140,13 +239,13 @@ Spring *getPossibleSprings(unsigned int i, unsigned int j, unsigned int n,
         Point ext_b = {i_iter, j_iter};
         if (i_iter != i && j_iter != j) {
           // Diagonal springs
-          res[spring_index] = newSpring(current, ext_b, STIFFNESS_D);
+          res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_D);
         } else if (i_iter != i) {
           // Horizontal springs
-          res[spring_index] = newSpring(current, ext_b, STIFFNESS_H);
+          res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_H);
         } else {
           // Vertical springs
-          res[spring_index] = newSpring(current, ext_b, STIFFNESS_V);
+          res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_V);
         }
         spring_index++;
       }
@@ -156,24 +255,24 @@ Spring *getPossibleSprings(unsigned int i, unsigned int j, unsigned int n,
   // spring of len 2.
   if (i >= 2) {
     Point ext_b = {i - 2, j};
-    res[spring_index] = newSpring(current, ext_b, STIFFNESS_H);
+    res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_H);
     spring_index++;
   }
 
   if (i + 2 < n) {
     Point ext_b = {i + 2, j};
-    res[spring_index] = newSpring(current, ext_b, STIFFNESS_H);
+    res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_H);
     spring_index++;
   }
 
   if (j >= 2) {
     Point ext_b = {i, j - 2};
-    res[spring_index] = newSpring(current, ext_b, STIFFNESS_V);
+    res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_V);
     spring_index++;
   }
   if (j + 2 < m) {
     Point ext_b = {i, j + 2};
-    res[spring_index] = newSpring(current, ext_b, STIFFNESS_V);
+    res[spring_index] = newSpring(current, ext_b, params->STIFFNESS_V);
     spring_index++;
   }
 
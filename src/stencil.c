@@ -0,0 +1,80 @@
+#include "../include/stencil.h"
+#include <stdlib.h>
+#include <string.h>
+
+const int STENCIL_OFFSET[STENCIL_DIRECTIONS][2] = {
+    {1, 0}, {0, 1}, {1, 1}, {-1, 1}, {2, 0}, {0, 2},
+};
+
+/**
+ * Stencil of a grid of n lines and m columns, no spring being damaged or
+ * broken. The arrays are first written with the partition of the spring
+ * loops, so that on a NUMA machine they are near the threads using them.
+ */
+Stencil *newStencil(unsigned int n, unsigned int m) {
+  Stencil *stencil = (Stencil *)malloc(sizeof(Stencil));
+  size_t points = (size_t)n * m;
+  stencil->n = n;
+  stencil->m = m;
+  stencil->words = (points + 63) / 64;
+  stencil->damage =
+      (float *)malloc(STENCIL_DIRECTIONS * points * sizeof(float));
+  stencil->broken = (uint64_t *)malloc(STENCIL_DIRECTIONS * stencil->words *
+                                       sizeof(uint64_t));
+  stencil->force = (Vector *)malloc(points * sizeof(Vector));
+
+  for (unsigned int d = 0; d < STENCIL_DIRECTIONS; d++) {
+#pragma omp parallel for schedule(static)
+    for (size_t p = 0; p < points; p++) {
+      stencil->damage[d * points + p] = 0.0f;
+    }
+  }
+  memset(stencil->broken, 0,
+         STENCIL_DIRECTIONS * stencil->words * sizeof(uint64_t));
+#pragma omp parallel for schedule(static)
+  for (size_t p = 0; p < points; p++) {
+    stencil->force[p] = newVector(0.0f, 0.0f, 0.0f);
+  }
+  return stencil;
+}
+
+/**
+ * True if the other end of the spring of direction d leaving (i, j) is in
+ * the grid
+ */
+bool stencilHasSpring(const Stencil *stencil, unsigned int d, int i, int j) {
+  int k = i + STENCIL_OFFSET[d][0];
+  int l = j + STENCIL_OFFSET[d][1];
+  return k >= 0 && k < (int)stencil->n && l < (int)stencil->m;
+}
+
+/**
+ * Stiffness of the springs of direction d, the same as fillSprings gives
+ */
+float stencilStiffness(const Params *params, unsigned int d) {
+  if (STENCIL_OFFSET[d][1] == 0)
+    return params->STIFFNESS_H;
+  if (STENCIL_OFFSET[d][0] == 0)
+    return params->STIFFNESS_V;
+  return params->STIFFNESS_D;
+}
+
+/**
+ * Mark the spring (d, p) as broken. The other bits of its word may be set
+ * at the same time by other threads.
+ */
+void stencilBreak(Stencil *stencil, unsigned int d, unsigned int p) {
+  uint64_t *word = &stencil->broken[d * stencil->words + p / 64];
+  uint64_t bit = (uint64_t)1 << (p % 64);
+#pragma omp atomic
+  *word |= bit;
+}
+
+void freeStencil(Stencil *stencil) {
+  if (stencil == NULL)
+    return;
+  free(stencil->damage);
+  free(stencil->broken);
+  free(stencil->force);
+  free(stencil);
+}
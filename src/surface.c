@@ -0,0 +1,597 @@
+#define _GNU_SOURCE
+#include "../include/surface.h"
+#include "../include/log.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Part of the height of the mesh under its top where the points are fixed
+#define SURFACE_FIXED_TOLERANCE 1e-3f
+
+// Edge of a face, a < b, or candidate spring of a surface
+typedef struct Edge {
+  unsigned int a, b;
+  unsigned int face; // face of the edge, kind of the spring
+} Edge;
+
+// Kinds of springs, the first kept when two link the same points
+enum { KIND_STRUCTURAL, KIND_SHEAR, KIND_FLEXION };
+
+static int compareEdges(const void *a, const void *b) {
+  const Edge *x = (const Edge *)a, *y = (const Edge *)b;
+  if (x->a != y->a)
+    return x->a < y->a ? -1 : 1;
+  if (x->b != y->b)
+    return x->b < y->b ? -1 : 1;
+  if (x->face != y->face)
+    return x->face < y->face ? -1 : 1;
+  return 0;
+}
+
+static int comparePoints(const void *a, const void *b) {
+  const Edge *x = (const Edge *)a, *y = (const Edge *)b;
+  if (x->a != y->a)
+    return x->a < y->a ? -1 : 1;
+  return x->b < y->b ? -1 : x->b > y->b;
+}
+
+/**
+ * Append to a growing array, doubling its capacity when full
+ */
+static void *growArray(void *array, unsigned int count, unsigned int *capacity,
+                       size_t size) {
+  if (count < *capacity)
+    return array;
+  *capacity = *capacity == 0 ? 1024 : 2 * *capacity;
+  return realloc(array, *capacity * size);
+}
+
+/**
+ * Number of a point in an "f" line, "i", "i/t", "i//n" or "i/t/n",
+ * counted from 1 or, if negative, from the last point read
+ */
+static bool parseFacePoint(const char *token, unsigned int n_points,
+                           unsigned int *point) {
+  char *end;
+  long index = strtol(token, &end, 10);
+  if (end == token || (*end != '\0' && *end != '/'))
+    return false;
+  if (index < 0)
+    index += (long)n_points + 1;
+  if (index < 1 || index > (long)n_points)
+    return false;
+  *point = (unsigned int)(index - 1);
+  return true;
+}
+
+/**
+ * Faces of each point, from the faces
+ */
+void linkSurfaceFaces(Surface *surface) {
+  unsigned int n = surface->n_points;
+  free(surface->point_faces_start);
+  free(surface->point_faces);
+  surface->point_faces_start =
+      (unsigned int *)calloc(n + 1, sizeof(unsigned int));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    for (unsigned int k = 0; k < faceSize(surface, f); k++) {
+      surface->point_faces_start[surface->faces[f][k] + 1]++;
+    }
+  }
+  for (unsigned int p = 0; p < n; p++) {
+    surface->point_faces_start[p + 1] += surface->point_faces_start[p];
+  }
+  surface->point_faces = (unsigned int *)malloc(
+      surface->point_faces_start[n] * sizeof(unsigned int));
+  unsigned int *fill = (unsigned int *)malloc(n * sizeof(unsigned int));
+  memcpy(fill, surface->point_faces_start, n * sizeof(unsigned int));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    for (unsigned int k = 0; k < faceSize(surface, f); k++) {
+      surface->point_faces[fill[surface->faces[f][k]]++] = f;
+    }
+  }
+  free(fill);
+}
+
+/**
+ * Faces of each point and the fixed points, from the faces and positions
+ */
+static void finishSurface(Surface *surface, const Vector *points) {
+  unsigned int n = surface->n_points;
+  linkSurfaceFaces(surface);
+
+  // The mesh hangs from its highest points, if it is not flat
+  float low = INFINITY, high = -INFINITY;
+  for (unsigned int p = 0; p < n; p++) {
+    low = fminf(low, points[p].y);
+    high = fmaxf(high, points[p].y);
+  }
+  float top = high - SURFACE_FIXED_TOLERANCE * (high - low);
+  for (unsigned int p = 0; p < n; p++) {
+    surface->fixed[p] = high > low && points[p].y >= top;
+  }
+}
+
+/**
+ * Read the points ("v" lines) and faces ("f" lines) of an OBJ file, the
+ * other lines being ignored. The faces of more than 4 points are split in
+ * triangles. Return NULL, and log why, if the file can not be read or has
+ * no face.
+ */
+Surface *readObj(const char *filename, Vector **points) {
+  FILE *file = fopen(filename, "r");
+  if (file == NULL) {
+    log_error("Error: Could not open %s", filename);
+    return NULL;
+  }
+
+  Surface *surface = (Surface *)calloc(1, sizeof(Surface));
+  unsigned int points_capacity = 0, faces_capacity = 0;
+  *points = NULL;
+
+  char *line = NULL;
+  size_t line_size = 0;
+  unsigned int line_number = 0;
+  bool failed = false;
+  while (!failed && getline(&line, &line_size, file) != -1) {
+    line_number++;
+    if (strncmp(line, "v ", 2) == 0) {
+      Vector v;
+      if (sscanf(line + 2, "%f %f %f", &v.x, &v.y, &v.z) != 3) {
+        log_error("Error: %s:%u: expected 3 coordinates", filename,
+                  line_number);
+        failed = true;
+        break;
+      }
+      *points = (Vector *)growArray(*points, surface->n_points,
+                                    &points_capacity, sizeof(Vector));
+      (*points)[surface->n_points++] = v;
+    } else if (strncmp(line, "f ", 2) == 0) {
+      unsigned int face[64], size = 0;
+      char *save;
+      for (char *token = strtok_r(line + 2, " \t\r\n", &save);
+           token != NULL && size < 64;
+           token = strtok_r(NULL, " \t\r\n", &save)) {
+        if (!parseFacePoint(token, surface->n_points, &face[size++])) {
+          log_error("Error: %s:%u: invalid point %s", filename, line_number,
+                    token);
+          failed = true;
+          break;
+        }
+      }
+      if (!failed && size < 3) {
+        log_error("Error: %s:%u: a face needs 3 points", filename,
+                  line_number);
+        failed = true;
+      }
+
+      // A triangle or a quad, or a fan of triangles
+      for (unsigned int k = 1; !failed && k + 1 < size; k++) {
+        surface->faces = growArray(surface->faces, surface->n_faces,
+                                   &faces_capacity, sizeof(*surface->faces));
+        unsigned int *f = surface->faces[surface->n_faces++];
+        f[0] = face[0];
+        f[1] = face[k];
+        f[2] = face[k + 1];
+        f[3] = SURFACE_NONE;
+        if (size == 4) {
+          f[3] = face[3];
+          break;
+        }
+      }
+    }
+  }
+  free(line);
+  fclose(file);
+
+  if (!failed && surface->n_faces == 0) {
+    log_error("Error: No face in %s", filename);
+    failed = true;
+  }
+  if (failed) {
+    free(*points);
+    *points = NULL;
+    freeSurface(surface);
+    return NULL;
+  }
+
+  surface->fixed = (bool *)malloc(surface->n_points * sizeof(bool));
+  finishSurface(surface, *points);
+  return surface;
+}
+
+bool parseReorderPolicy(const char *name, reorderPolicy *policy) {
+  if (strcmp(name, "none") == 0) {
+    *policy = REORDER_NONE;
+  } else if (strcmp(name, "morton") == 0) {
+    *policy = REORDER_MORTON;
+  } else if (strcmp(name, "rcm") == 0) {
+    *policy = REORDER_RCM;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *reorderPolicyName(reorderPolicy policy) {
+  switch (policy) {
+  case REORDER_MORTON:
+    return "morton";
+  case REORDER_RCM:
+    return "rcm";
+  default:
+    return "none";
+  }
+}
+
+/**
+ * Number of points of a face, 3 or 4
+ */
+unsigned int faceSize(const Surface *surface, unsigned int face) {
+  return surface->faces[face][3] == SURFACE_NONE ? 3 : 4;
+}
+
+// A point and the key it is sorted on
+typedef struct Key {
+  uint64_t key;
+  unsigned int point;
+} Key;
+
+static int compareKeys(const void *a, const void *b) {
+  const Key *x = (const Key *)a, *y = (const Key *)b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  return x->point < y->point ? -1 : x->point > y->point;
+}
+
+/**
+ * Spread the 21 lower bits of x, 2 zeros between each
+ */
+static uint64_t spreadBits(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+/**
+ * Points in the order of the Morton code of their position in the bounding
+ * box, so that points close in space are close in memory
+ */
+static void mortonOrder(const Surface *surface, const Vector *points,
+                        unsigned int *order) {
+  unsigned int n = surface->n_points;
+  float low[3] = {INFINITY, INFINITY, INFINITY};
+  float high[3] = {-INFINITY, -INFINITY, -INFINITY};
+  for (unsigned int p = 0; p < n; p++) {
+    const float c[3] = {points[p].x, points[p].y, points[p].z};
+    for (int d = 0; d < 3; d++) {
+      low[d] = fminf(low[d], c[d]);
+      high[d] = fmaxf(high[d], c[d]);
+    }
+  }
+
+  Key *keys = (Key *)malloc(n * sizeof(Key));
+  for (unsigned int p = 0; p < n; p++) {
+    const float c[3] = {points[p].x, points[p].y, points[p].z};
+    keys[p].key = 0;
+    keys[p].point = p;
+    for (int d = 0; d < 3; d++) {
+      float extent = high[d] - low[d];
+      uint64_t cell =
+          extent > 0.0f ? (uint64_t)((c[d] - low[d]) / extent * 0x1fffff) : 0;
+      keys[p].key |= spreadBits(cell) << d;
+    }
+  }
+  qsort(keys, n, sizeof(Key), compareKeys);
+  for (unsigned int p = 0; p < n; p++) {
+    order[p] = keys[p].point;
+  }
+  free(keys);
+}
+
+/**
+ * Points in the reverse Cuthill-McKee order of the graph of the edges: a
+ * breadth-first search from a point of lowest degree, the neighbours being
+ * visited by increasing degree, then reversed. Neighbours get close numbers,
+ * which keeps the springs short in memory.
+ */
+static void rcmOrder(const Surface *surface, unsigned int *order) {
+  unsigned int n = surface->n_points;
+
+  // Neighbours of every point through the edges of its faces
+  unsigned int *start = (unsigned int *)calloc(n + 1, sizeof(unsigned int));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    unsigned int size = faceSize(surface, f);
+    for (unsigned int k = 0; k < size; k++) {
+      start[surface->faces[f][k] + 1]++;
+      start[surface->faces[f][(k + 1) % size] + 1]++;
+    }
+  }
+  for (unsigned int p = 0; p < n; p++) {
+    start[p + 1] += start[p];
+  }
+  unsigned int *neighbours =
+      (unsigned int *)malloc(start[n] * sizeof(unsigned int));
+  unsigned int *fill = (unsigned int *)malloc(n * sizeof(unsigned int));
+  memcpy(fill, start, n * sizeof(unsigned int));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    unsigned int size = faceSize(surface, f);
+    for (unsigned int k = 0; k < size; k++) {
+      unsigned int a = surface->faces[f][k];
+      unsigned int b = surface->faces[f][(k + 1) % size];
+      neighbours[fill[a]++] = b;
+      neighbours[fill[b]++] = a;
+    }
+  }
+  free(fill);
+
+  // Points by increasing degree, to start each component and sort the
+  // neighbours
+  Key *by_degree = (Key *)malloc(n * sizeof(Key));
+  for (unsigned int p = 0; p < n; p++) {
+    by_degree[p].key = start[p + 1] - start[p];
+    by_degree[p].point = p;
+  }
+  qsort(by_degree, n, sizeof(Key), compareKeys);
+
+  bool *visited = (bool *)calloc(n, sizeof(bool));
+  Key *next = (Key *)malloc((start[n] + 1) * sizeof(Key));
+  unsigned int head = 0, tail = 0;
+  for (unsigned int s = 0; s < n; s++) {
+    unsigned int first = by_degree[s].point;
+    if (visited[first])
+      continue;
+    visited[first] = true;
+    order[tail++] = first;
+
+    while (head < tail) {
+      unsigned int p = order[head++];
+      unsigned int count = 0;
+      for (unsigned int e = start[p]; e < start[p + 1]; e++) {
+        unsigned int q = neighbours[e];
+        if (visited[q])
+          continue;
+        visited[q] = true;
+        next[count].key = start[q + 1] - start[q];
+        next[count++].point = q;
+      }
+      qsort(next, count, sizeof(Key), compareKeys);
+      for (unsigned int c = 0; c < count; c++) {
+        order[tail++] = next[c].point;
+      }
+    }
+  }
+
+  for (unsigned int p = 0; p < n / 2; p++) {
+    unsigned int swap = order[p];
+    order[p] = order[n - 1 - p];
+    order[n - 1 - p] = swap;
+  }
+
+  free(next);
+  free(visited);
+  free(by_degree);
+  free(neighbours);
+  free(start);
+}
+
+/**
+ * Renumber the points of the surface, and move the points, with the given
+ * policy. The faces are then sorted by their first point.
+ */
+void reorderSurface(Surface *surface, Vector *points, reorderPolicy policy) {
+  unsigned int n = surface->n_points;
+  if (policy == REORDER_NONE)
+    return;
+
+  // order[new] = old
+  unsigned int *order = (unsigned int *)malloc(n * sizeof(unsigned int));
+  if (policy == REORDER_MORTON)
+    mortonOrder(surface, points, order);
+  else
+    rcmOrder(surface, order);
+
+  unsigned int *rank = (unsigned int *)malloc(n * sizeof(unsigned int));
+  Vector *moved = (Vector *)malloc(n * sizeof(Vector));
+  for (unsigned int p = 0; p < n; p++) {
+    rank[order[p]] = p;
+    moved[p] = points[order[p]];
+  }
+  memcpy(points, moved, n * sizeof(Vector));
+  free(moved);
+
+  Key *by_point = (Key *)malloc(surface->n_faces * sizeof(Key));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    unsigned int first = UINT_MAX;
+    for (unsigned int k = 0; k < faceSize(surface, f); k++) {
+      surface->faces[f][k] = rank[surface->faces[f][k]];
+      if (surface->faces[f][k] < first)
+        first = surface->faces[f][k];
+    }
+    by_point[f].key = first;
+    by_point[f].point = f;
+  }
+  qsort(by_point, surface->n_faces, sizeof(Key), compareKeys);
+  unsigned int(*faces)[4] = malloc(surface->n_faces * sizeof(*faces));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    memcpy(faces[f], surface->faces[by_point[f].point], sizeof(*faces));
+  }
+  free(surface->faces);
+  surface->faces = faces;
+
+  free(by_point);
+  free(rank);
+  free(order);
+  finishSurface(surface, points);
+}
+
+/**
+ * Point of the face on the other side of the point x from the edge (x, y):
+ * the third point of a triangle, the other neighbour of x in a quad
+ */
+static unsigned int acrossPoint(const Surface *surface, unsigned int face,
+                                unsigned int x, unsigned int y) {
+  const unsigned int *f = surface->faces[face];
+  unsigned int size = faceSize(surface, face);
+  for (unsigned int k = 0; k < size; k++) {
+    if (f[k] != x)
+      continue;
+    unsigned int before = f[(k + size - 1) % size];
+    unsigned int after = f[(k + 1) % size];
+    return before == y ? after : before;
+  }
+  return SURFACE_NONE;
+}
+
+/**
+ * Add a candidate spring between a and b, in increasing order
+ */
+static void addCandidate(Edge *candidates, unsigned int *count,
+                         unsigned int a, unsigned int b, unsigned int kind) {
+  if (a == b || a == SURFACE_NONE || b == SURFACE_NONE)
+    return;
+  Edge *c = &candidates[(*count)++];
+  c->a = a < b ? a : b;
+  c->b = a < b ? b : a;
+  c->face = kind;
+}
+
+/**
+ * Build the springs of the surface, sorted by their points, and the springs
+ * of the edges of every face in face_springs, SPRINGS_PER_FACE per face. Two
+ * springs between the same points are one, of the first kind among
+ * structural, shear and flexion. Return the number of springs.
+ */
+meshIndex surfaceSprings(const Surface *surface, const Params *params,
+                         Spring **springs, meshIndex **face_springs) {
+  // Edges of the faces, the faces sharing an edge being next to each other
+  unsigned int n_edges = 0;
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    n_edges += faceSize(surface, f);
+  }
+  Edge *edges = (Edge *)malloc(n_edges * sizeof(Edge));
+  n_edges = 0;
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    unsigned int size = faceSize(surface, f);
+    for (unsigned int k = 0; k < size; k++) {
+      unsigned int a = surface->faces[f][k];
+      unsigned int b = surface->faces[f][(k + 1) % size];
+      edges[n_edges].a = a < b ? a : b;
+      edges[n_edges].b = a < b ? b : a;
+      edges[n_edges++].face = f;
+    }
+  }
+  qsort(edges, n_edges, sizeof(Edge), compareEdges);
+
+  // One structural spring per edge, a shear spring per diagonal of a quad
+  // and, across an edge of two faces, a flexion spring for each end
+  Edge *candidates = (Edge *)malloc(4 * n_edges * sizeof(Edge));
+  unsigned int count = 0;
+  for (unsigned int e = 0; e < n_edges; e++) {
+    const Edge *edge = &edges[e];
+    bool first = e == 0 || edge->a != edges[e - 1].a ||
+                 edge->b != edges[e - 1].b;
+    if (!first)
+      continue;
+    addCandidate(candidates, &count, edge->a, edge->b, KIND_STRUCTURAL);
+
+    const Edge *other = e + 1 < n_edges ? &edges[e + 1] : NULL;
+    if (other != NULL && other->a == edge->a && other->b == edge->b) {
+      addCandidate(candidates, &count,
+                   acrossPoint(surface, edge->face, edge->a, edge->b),
+                   acrossPoint(surface, other->face, edge->a, edge->b),
+                   KIND_FLEXION);
+      addCandidate(candidates, &count,
+                   acrossPoint(surface, edge->face, edge->b, edge->a),
+                   acrossPoint(surface, other->face, edge->b, edge->a),
+                   KIND_FLEXION);
+    }
+  }
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    if (faceSize(surface, f) == 4) {
+      const unsigned int *q = surface->faces[f];
+      addCandidate(candidates, &count, q[0], q[2], KIND_SHEAR);
+      addCandidate(candidates, &count, q[1], q[3], KIND_SHEAR);
+    }
+  }
+  free(edges);
+
+  qsort(candidates, count, sizeof(Edge), compareEdges);
+  meshIndex n_springs = 0;
+  for (unsigned int c = 0; c < count; c++) {
+    if (n_springs == 0 || candidates[c].a != candidates[n_springs - 1].a ||
+        candidates[c].b != candidates[n_springs - 1].b)
+      candidates[n_springs++] = candidates[c];
+  }
+
+  *springs = (Spring *)malloc(n_springs * sizeof(Spring));
+  for (meshIndex s = 0; s < n_springs; s++) {
+    Point a = {0, candidates[s].a}, b = {0, candidates[s].b};
+    float stiffness = candidates[s].face == KIND_SHEAR ? params->STIFFNESS_D
+                                                       : params->STIFFNESS_H;
+    (*springs)[s] = newSpring(a, b, stiffness);
+  }
+
+  // Structural spring of each edge of the faces, from faces[f][k] in the
+  // slot k, the other slots are NO_SPRING
+  *face_springs = (meshIndex *)malloc(
+      (size_t)surface->n_faces * SPRINGS_PER_FACE * sizeof(meshIndex));
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    unsigned int size = faceSize(surface, f);
+    meshIndex *slots = *face_springs + (size_t)f * SPRINGS_PER_FACE;
+    for (unsigned int k = 0; k < SPRINGS_PER_FACE; k++) {
+      slots[k] = NO_SPRING;
+    }
+    for (unsigned int k = 0; k < size; k++) {
+      unsigned int a = surface->faces[f][k];
+      unsigned int b = surface->faces[f][(k + 1) % size];
+      Edge key = {a < b ? a : b, a < b ? b : a, 0};
+      const Edge *found = (const Edge *)bsearch(
+          &key, candidates, n_springs, sizeof(Edge), comparePoints);
+      if (found != NULL)
+        slots[k] = (meshIndex)(found - candidates);
+    }
+  }
+
+  free(candidates);
+  return n_springs;
+}
+
+/**
+ * Normal at the point p, the sum of the normals of its faces weighted by
+ * their area, zero if they are all flat
+ */
+Vector surfaceNormal(const Surface *surface, const Vector *points,
+                     unsigned int p) {
+  Vector sum = {0.0f, 0.0f, 0.0f};
+  for (unsigned int e = surface->point_faces_start[p];
+       e < surface->point_faces_start[p + 1]; e++) {
+    const unsigned int *f = surface->faces[surface->point_faces[e]];
+    Vector a, b;
+    if (f[3] == SURFACE_NONE) {
+      a = newVectorFromPoint(points[f[0]], points[f[1]]);
+      b = newVectorFromPoint(points[f[0]], points[f[2]]);
+    } else { // the diagonals of a quad
+      a = newVectorFromPoint(points[f[0]], points[f[2]]);
+      b = newVectorFromPoint(points[f[1]], points[f[3]]);
+    }
+    sum = addVector(sum, crossProduct(a, b));
+  }
+  return normalize(sum);
+}
+
+void freeSurface(Surface *surface) {
+  if (surface == NULL)
+    return;
+  free(surface->faces);
+  free(surface->point_faces_start);
+  free(surface->point_faces);
+  free(surface->fixed);
+  free(surface);
+}
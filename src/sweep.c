@@ -0,0 +1,225 @@
+#include "../include/sweep.h"
+#include <math.h>
+#include <omp.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Start an empty sweep (a single simulation) from the params of the type
+ */
+void initSweep(Sweep *sweep, meshType type) {
+  sweep->type = type;
+  sweep->base = defaultParams();
+  customs_params(&sweep->base, type);
+  sweep->n_axes = 0;
+}
+
+/**
+ * Add the parameter `name` to the sweep. values is either a list "a,b,c" or a
+ * range "start:stop:count" of count values evenly spaced. Return 0 on
+ * success, -1 otherwise.
+ */
+int addSweepAxis(Sweep *sweep, const char *name, const char *values) {
+  if (sweep->n_axes == SWEEP_MAX_AXES) {
+    log_error("Too many swept parameters, at most %d", SWEEP_MAX_AXES);
+    return -1;
+  }
+
+  SweepAxis *axis = &sweep->axes[sweep->n_axes];
+  axis->param = findParam(name);
+  if (axis->param == NULL || strcmp(name, "STEP") == 0) {
+    log_error("Parameter %s cannot be swept", name);
+    return -1;
+  }
+
+  float start, stop;
+  unsigned int count;
+  axis->n_values = 0;
+  if (sscanf(values, "%f:%f:%u", &start, &stop, &count) == 3) {
+    if (count == 0 || count > SWEEP_MAX_VALUES) {
+      log_error("Range of %s must have 1 to %d values", name,
+                SWEEP_MAX_VALUES);
+      return -1;
+    }
+    for (unsigned int k = 0; k < count; k++) {
+      axis->values[k] =
+          count == 1 ? start : start + (stop - start) * k / (count - 1);
+    }
+    axis->n_values = count;
+  } else {
+    const char *cursor = values;
+    char *end;
+    while (*cursor != '\0') {
+      if (axis->n_values == SWEEP_MAX_VALUES) {
+        log_error("Too many values for %s, at most %d", name,
+                  SWEEP_MAX_VALUES);
+        return -1;
+      }
+      float value = strtof(cursor, &end);
+      if (end == cursor || (*end != ',' && *end != '\0')) {
+        log_error("Invalid value list for %s: %s", name, values);
+        return -1;
+      }
+      axis->values[axis->n_values++] = value;
+      cursor = *end == ',' ? end + 1 : end;
+    }
+  }
+
+  if (axis->n_values == 0) {
+    log_error("No value given for %s", name);
+    return -1;
+  }
+  sweep->n_axes++;
+  return 0;
+}
+
+/**
+ * Number of simulations of the sweep
+ */
+unsigned int sweepSize(const Sweep *sweep) {
+  unsigned int size = 1;
+  for (unsigned int a = 0; a < sweep->n_axes; a++) {
+    size *= sweep->axes[a].n_values;
+  }
+  return size;
+}
+
+/**
+ * Params of the simulation `index`, the last axis varying the fastest
+ */
+Params sweepParams(const Sweep *sweep, unsigned int index) {
+  Params params = sweep->base;
+  for (int a = sweep->n_axes - 1; a >= 0; a--) {
+    const SweepAxis *axis = &sweep->axes[a];
+    setParam(&params, axis->param, axis->values[index % axis->n_values]);
+    index /= axis->n_values;
+  }
+  return params;
+}
+
+/**
+ * Run the simulation `index` of the sweep on the calling thread only and
+ * summarize its final state. Return 0 on success, -1 if its mesh can not be
+ * built.
+ */
+int runSimulation(const Sweep *sweep, unsigned int index,
+                  SweepResult *result) {
+  struct timespec start_time, end_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  Params params = sweepParams(sweep, index);
+  Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
+  if (initMesh(mesh, sweep->type, &params) != 0) {
+    free(mesh);
+    return -1;
+  }
+
+  for (unsigned int u = 0; u < params.NB_UPDATES; u++) {
+    updatePosition(mesh, params.DELTA_T, sweep->type);
+  }
+
+  result->broken_springs = mesh->total_springs - mesh->n_springs;
+  result->broken_faces = mesh->n_broken_faces;
+
+  result->kinetic_energy = 0.0f;
+  result->max_displacement = 0.0f;
+  result->min_y = INFINITY;
+  result->max_y = -INFINITY;
+  for (unsigned int i = 0; i < mesh->n; i++) {
+    for (unsigned int j = 0; j < mesh->m; j++) {
+      result->kinetic_energy += 0.5f * params.Mu *
+                                scalar_product(mesh->V[i][j], mesh->V[i][j]);
+      result->max_displacement =
+          fmaxf(result->max_displacement,
+                norm(newVectorFromPoint(mesh->P0[i][j], mesh->P[i][j])));
+      result->min_y = fminf(result->min_y, mesh->P[i][j].y);
+      result->max_y = fmaxf(result->max_y, mesh->P[i][j].y);
+    }
+  }
+  freeMesh(mesh);
+
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+  result->elapsed = (end_time.tv_sec - start_time.tv_sec) +
+                    (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+  result->thread = omp_get_thread_num();
+  return 0;
+}
+
+/**
+ * Run every simulation of the sweep, spread over the threads with one
+ * simulation per thread at a time, and write one CSV line per simulation in
+ * output_filename. Return 0 on success, -1 otherwise.
+ */
+int runSweep(const Sweep *sweep, const char *output_filename) {
+  FILE *file = fopen(output_filename, "w");
+  if (file == NULL) {
+    log_error("Error: Could not open file %s.", output_filename);
+    return -1;
+  }
+
+  // Every simulation of the sweep is checked before any of them runs
+  unsigned int size = sweepSize(sweep);
+  for (unsigned int k = 0; k < size; k++) {
+    Params params = sweepParams(sweep, k);
+    if (!checkGridParams(sweep->type, &params)) {
+      log_error("Simulation %u of the sweep can not be built", k);
+      fclose(file);
+      return -1;
+    }
+  }
+  SweepResult *results = (SweepResult *)malloc(size * sizeof(SweepResult));
+  unsigned int done = 0;
+
+  log_info("Starting sweep: %u simulations on %d threads", size,
+           omp_get_max_threads());
+
+  // The parallel regions of updatePosition get a team of one thread
+  omp_set_max_active_levels(1);
+
+  struct timespec start_time, end_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  // Simulations have different costs (sizes, breaks...), hence dynamic
+#pragma omp parallel for schedule(dynamic, 1)
+  for (unsigned int k = 0; k < size; k++) {
+    runSimulation(sweep, k, &results[k]);
+
+    unsigned int finished;
+#pragma omp atomic capture
+    finished = ++done;
+    if (finished % 16 == 0 || finished == size)
+      log_info("Sweep: %u/%u simulations done", finished, size);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+  double elapsed = (end_time.tv_sec - start_time.tv_sec) +
+                   (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+  // Results are written in the order of the simulations
+  fprintf(file, "index");
+  for (unsigned int a = 0; a < sweep->n_axes; a++) {
+    fprintf(file, ",%s", sweep->axes[a].param->name);
+  }
+  fprintf(file, ",broken_springs,broken_faces,kinetic_energy,"
+                "max_displacement,min_y,max_y,elapsed_s,thread\n");
+
+  for (unsigned int k = 0; k < size; k++) {
+    Params params = sweepParams(sweep, k);
+    fprintf(file, "%u", k);
+    for (unsigned int a = 0; a < sweep->n_axes; a++) {
+      fprintf(file, ",%g", getParam(&params, sweep->axes[a].param));
+    }
+    const SweepResult *r = &results[k];
+    fprintf(file,
+            ",%" PRI_MESH_INDEX ",%" PRI_MESH_INDEX ",%g,%g,%g,%g,%.6f,%d\n",
+            r->broken_springs, r->broken_faces, r->kinetic_energy,
+            r->max_displacement, r->min_y, r->max_y, r->elapsed, r->thread);
+  }
+  fclose(file);
+  free(results);
+
+  log_info("Sweep completed in %.3f seconds (%.2f simulations/s), results in "
+           "%s",
+           elapsed, size / elapsed, output_filename);
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/temporal.h"
+#include "../include/spring.h"
+#include <stdlib.h>
+
+/**
+ * Split a grid of n lines and m columns in tiles of size x size points,
+ * advanced up to `steps` updates at once. The results of a block are kept
+ * in arrays of the whole grid.
+ */
+TemporalBlocking *newTemporalBlocking(unsigned int n, unsigned int m,
+                                      meshIndex n_springs, unsigned int steps,
+                                      unsigned int size) {
+  TemporalBlocking *temporal =
+      (TemporalBlocking *)malloc(sizeof(TemporalBlocking));
+  temporal->steps = steps;
+  temporal->size = size;
+  temporal->rows = (n + size - 1) / size;
+  temporal->cols = (m + size - 1) / size;
+  temporal->P = getMatrix(n, m);
+  temporal->V = getMatrix(n, m);
+  temporal->damage = (float *)malloc(n_springs * sizeof(float));
+  temporal->broken = (bool *)malloc(n_springs * sizeof(bool));
+  temporal->broken_at = (meshIndex *)calloc(steps, sizeof(meshIndex));
+  return temporal;
+}
+
+/**
+ * Points of the tile and of `halo` points around it, within the grid
+ */
+Region tileRegion(const TemporalBlocking *temporal, unsigned int tile,
+                  unsigned int halo, unsigned int n, unsigned int m) {
+  unsigned int i0 = tile / temporal->cols * temporal->size;
+  unsigned int j0 = tile % temporal->cols * temporal->size;
+  unsigned int i1 = i0 + temporal->size + halo;
+  unsigned int j1 = j0 + temporal->size + halo;
+  Region region = {i0 > halo ? i0 - halo : 0, i1 < n ? i1 : n,
+                   j0 > halo ? j0 - halo : 0, j1 < m ? j1 : m};
+  return region;
+}
+
+/**
+ * Scratch of a thread, sized for a tile and the halo of a whole block
+ */
+TemporalScratch *newTemporalScratch(const TemporalBlocking *temporal,
+                                    unsigned int n, unsigned int m) {
+  unsigned int side = temporal->size + 2 * TEMPORAL_HALO * temporal->steps;
+  size_t lines = side < n ? side : n;
+  size_t points = lines * (side < m ? side : m);
+  size_t springs = TEMPORAL_MAX_SPRINGS * points;
+
+  TemporalScratch *scratch =
+      (TemporalScratch *)malloc(sizeof(TemporalScratch));
+  scratch->positions = (Vector *)malloc((m + points) * sizeof(Vector));
+  scratch->velocities = (Vector *)malloc((m + points) * sizeof(Vector));
+  scratch->P = (Vector **)calloc(n, sizeof(Vector *));
+  scratch->V = (Vector **)calloc(n, sizeof(Vector *));
+  scratch->damage = (float *)malloc(springs * sizeof(float));
+  scratch->broken = (bool *)malloc(springs * sizeof(bool));
+  scratch->forces = (Vector *)malloc(springs * sizeof(Vector));
+  scratch->first = (meshIndex *)malloc(lines * sizeof(meshIndex));
+  scratch->offset = (meshIndex *)malloc(lines * sizeof(meshIndex));
+  return scratch;
+}
+
+/**
+ * Lay the scratch out for a region of a grid of n lines and m columns: the
+ * row of the line i starts m points after the column 0 of the region, so
+ * that its column j0 is in the copy, and its springs follow those of the
+ * line before, see firstSpringOf
+ */
+void setScratchRegion(TemporalScratch *scratch, Region region, unsigned int n,
+                      unsigned int m) {
+  const unsigned int width = region.j1 - region.j0;
+  meshIndex count = 0;
+  scratch->region = region;
+  for (unsigned int i = region.i0; i < region.i1; i++) {
+    unsigned int r = i - region.i0;
+    size_t row = m + (size_t)r * width - region.j0;
+    scratch->P[i] = scratch->positions + row;
+    scratch->V[i] = scratch->velocities + row;
+    scratch->first[r] = firstSpringOf(i, region.j0, n, m);
+    scratch->offset[r] = count;
+    count += firstSpringOf(i, region.j1, n, m) - scratch->first[r];
+  }
+}
+
+void freeTemporalScratch(TemporalScratch *scratch) {
+  free(scratch->positions);
+  free(scratch->velocities);
+  free(scratch->P);
+  free(scratch->V);
+  free(scratch->damage);
+  free(scratch->broken);
+  free(scratch->forces);
+  free(scratch->first);
+  free(scratch->offset);
+  free(scratch);
+}
+
+void freeTemporalBlocking(TemporalBlocking *temporal, unsigned int n) {
+  if (temporal == NULL)
+    return;
+  freeMatrix(temporal->P, n);
+  freeMatrix(temporal->V, n);
+  free(temporal->damage);
+  free(temporal->broken);
+  free(temporal->broken_at);
+  free(temporal);
+}
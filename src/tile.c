@@ -0,0 +1,77 @@
+#include "../include/tile.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Split a grid of n lines and m columns in tiles of size x size points and
+ * list the springs of each tile. NULL if a spring reaches beyond the halo.
+ */
+Tiling *newTiling(const Spring *springs, meshIndex n_springs,
+                  unsigned int n, unsigned int m, unsigned int size) {
+  Tiling *tiling = (Tiling *)malloc(sizeof(Tiling));
+  tiling->size = size;
+  tiling->rows = (n + size - 1) / size;
+  tiling->cols = (m + size - 1) / size;
+  tiling->pitch = size + 2 * TILE_HALO;
+  unsigned int n_tiles = tiling->rows * tiling->cols;
+
+  // Count then place the springs of every tile, by increasing index
+  tiling->springs_start = (meshIndex *)calloc(n_tiles + 1, sizeof(meshIndex));
+  tiling->springs = (meshIndex *)malloc(n_springs * sizeof(meshIndex));
+  for (meshIndex k = 0; k < n_springs; k++) {
+    const Spring *s = &springs[k];
+    int di = (int)s->ext_2.i - (int)s->ext_1.i;
+    int dj = (int)s->ext_2.j - (int)s->ext_1.j;
+    if (abs(di) > TILE_HALO || abs(dj) > TILE_HALO) {
+      log_error("Spring %" PRI_MESH_INDEX " spans more than the halo of a tile",
+                k);
+      free(tiling->springs_start);
+      free(tiling->springs);
+      free(tiling);
+      return NULL;
+    }
+    unsigned int tile =
+        s->ext_1.i / size * tiling->cols + s->ext_1.j / size;
+    tiling->springs_start[tile + 1]++;
+  }
+  for (unsigned int t = 0; t < n_tiles; t++) {
+    tiling->springs_start[t + 1] += tiling->springs_start[t];
+  }
+
+  meshIndex *fill = (meshIndex *)malloc(n_tiles * sizeof(meshIndex));
+  memcpy(fill, tiling->springs_start, n_tiles * sizeof(meshIndex));
+  for (meshIndex k = 0; k < n_springs; k++) {
+    const Spring *s = &springs[k];
+    unsigned int tile =
+        s->ext_1.i / size * tiling->cols + s->ext_1.j / size;
+    tiling->springs[fill[tile]++] = k;
+  }
+  free(fill);
+
+  // Each buffer is first written by the thread which will own its tile
+  size_t buffer = (size_t)tiling->pitch * tiling->pitch;
+  tiling->acc = (Vector *)malloc(n_tiles * buffer * sizeof(Vector));
+#pragma omp parallel for schedule(static)
+  for (unsigned int t = 0; t < n_tiles; t++) {
+    memset(tileBuffer(tiling, t), 0, buffer * sizeof(Vector));
+  }
+  return tiling;
+}
+
+/**
+ * Accelerations of a tile, (i, j) of the grid being at
+ * [(i - ti * size + TILE_HALO) * pitch + j - tj * size + TILE_HALO]
+ */
+Vector *tileBuffer(const Tiling *tiling, unsigned int tile) {
+  return tiling->acc + (size_t)tile * tiling->pitch * tiling->pitch;
+}
+
+void freeTiling(Tiling *tiling) {
+  if (tiling == NULL)
+    return;
+  free(tiling->springs_start);
+  free(tiling->springs);
+  free(tiling->acc);
+  free(tiling);
+}
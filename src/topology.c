@@ -0,0 +1,193 @@
+#define _GNU_SOURCE
+#include "../include/topology.h"
+#include "../include/log.h"
+#include <omp.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NODE_DIR "/sys/devices/system/node"
+
+/**
+ * Give the node to the CPUs of a list like "0-3,8-11"
+ */
+static void markCpuList(const char *list, int node, int *node_of) {
+  const char *p = list;
+  while (*p != '\0' && *p != '\n') {
+    char *end;
+    long first = strtol(p, &end, 10);
+    long last = first;
+    if (end == p)
+      return;
+    if (*end == '-')
+      last = strtol(end + 1, &end, 10);
+    for (long cpu = first; cpu <= last && cpu < TOPOLOGY_MAX_CPUS; cpu++) {
+      if (cpu >= 0)
+        node_of[cpu] = node;
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+}
+
+/**
+ * Read the CPUs the process may run on and their NUMA node. A machine
+ * without the NUMA sysfs is seen as a single node.
+ */
+void readTopology(Topology *topology) {
+  int node_of[TOPOLOGY_MAX_CPUS];
+  for (int cpu = 0; cpu < TOPOLOGY_MAX_CPUS; cpu++) {
+    node_of[cpu] = 0;
+  }
+
+  topology->n_nodes = 0;
+  char path[128], list[4096];
+  for (int node = 0; node < TOPOLOGY_MAX_CPUS; node++) {
+    snprintf(path, sizeof(path), NODE_DIR "/node%d/cpulist", node);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+      // The nodes are numbered from 0, possibly with holes
+      if (node > 64 && topology->n_nodes > 0)
+        break;
+      continue;
+    }
+    if (fgets(list, sizeof(list), file) != NULL)
+      markCpuList(list, node, node_of);
+    fclose(file);
+    topology->n_nodes = node + 1;
+  }
+  if (topology->n_nodes == 0)
+    topology->n_nodes = 1;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    CPU_SET(0, &allowed);
+
+  topology->n_cpus = 0;
+  for (int cpu = 0; cpu < TOPOLOGY_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      topology->cpus[topology->n_cpus] = cpu;
+      topology->cpu_node[topology->n_cpus] = node_of[cpu];
+      topology->n_cpus++;
+    }
+  }
+}
+
+bool parsePinPolicy(const char *name, pinPolicy *policy) {
+  if (strcmp(name, "none") == 0) {
+    *policy = PIN_NONE;
+  } else if (strcmp(name, "compact") == 0) {
+    *policy = PIN_COMPACT;
+  } else if (strcmp(name, "spread") == 0) {
+    *policy = PIN_SPREAD;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *pinPolicyName(pinPolicy policy) {
+  switch (policy) {
+  case PIN_COMPACT:
+    return "compact";
+  case PIN_SPREAD:
+    return "spread";
+  default:
+    return "none";
+  }
+}
+
+/**
+ * Order in which the threads take the CPUs for a policy
+ */
+static void pinOrder(const Topology *topology, pinPolicy policy, int *order) {
+  int count = 0;
+  if (policy == PIN_SPREAD) {
+    // One CPU of each node in turn, until every CPU is taken
+    int *taken = (int *)calloc(topology->n_nodes, sizeof(int));
+    while (count < topology->n_cpus) {
+      for (int node = 0; node < topology->n_nodes; node++) {
+        int seen = 0;
+        for (int k = 0; k < topology->n_cpus; k++) {
+          if (topology->cpu_node[k] != node)
+            continue;
+          if (seen++ == taken[node]) {
+            order[count++] = topology->cpus[k];
+            taken[node]++;
+            break;
+          }
+        }
+      }
+    }
+    free(taken);
+  } else {
+    // The CPUs of node 0, then of node 1...
+    for (int node = 0; node < topology->n_nodes; node++) {
+      for (int k = 0; k < topology->n_cpus; k++) {
+        if (topology->cpu_node[k] == node)
+          order[count++] = topology->cpus[k];
+      }
+    }
+  }
+}
+
+/**
+ * Pin every thread of the OpenMP team to one CPU. The threads of the
+ * following parallel regions are the same, so they stay pinned. Return -1
+ * if a thread could not be pinned.
+ */
+int pinThreads(const Topology *topology, pinPolicy policy) {
+  if (policy == PIN_NONE || topology->n_cpus == 0)
+    return 0;
+
+  int order[TOPOLOGY_MAX_CPUS];
+  pinOrder(topology, policy, order);
+
+  int failed = 0;
+#pragma omp parallel reduction(+ : failed)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(order[omp_get_thread_num() % topology->n_cpus], &set);
+    failed += sched_setaffinity(0, sizeof(set), &set) != 0;
+  }
+
+  if (failed > 0) {
+    log_error("Error: Could not pin %d threads", failed);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Log the nodes and CPUs available and the CPU each OpenMP thread runs on
+ */
+void logTopology(const Topology *topology, pinPolicy policy) {
+  int n_threads = omp_get_max_threads();
+  log_info("Topology: %d NUMA nodes, %d CPUs, %d OpenMP threads, pinning %s",
+           topology->n_nodes, topology->n_cpus, n_threads,
+           pinPolicyName(policy));
+
+  int *thread_cpu = (int *)malloc(n_threads * sizeof(int));
+#pragma omp parallel
+  thread_cpu[omp_get_thread_num()] = sched_getcpu();
+
+  // "thread:cpu/node" for every thread, on one line
+  size_t size = 16 * (size_t)n_threads + 1;
+  char *line = (char *)malloc(size);
+  size_t used = 0;
+  line[0] = '\0';
+  for (int t = 0; t < n_threads && used < size; t++) {
+    int node = 0;
+    for (int k = 0; k < topology->n_cpus; k++) {
+      if (topology->cpus[k] == thread_cpu[t])
+        node = topology->cpu_node[k];
+    }
+    used += snprintf(line + used, size - used, " %d:%d/%d", t, thread_cpu[t],
+                     node);
+  }
+  log_info("Threads on CPU/node:%s", line);
+  free(line);
+  free(thread_cpu);
+}
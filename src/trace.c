@@ -0,0 +1,187 @@
+#include "../include/trace.h"
+#include "../include/log.h"
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Pause of the writer between two passes over the rings
+#define TRACE_WRITER_PAUSE_NS 1000000L
+
+static uint64_t nowNs(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Write the events of a ring not written yet, return their number
+ */
+static unsigned int drainRing(Trace *trace, TraceRing *ring) {
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail)
+    return 0;
+
+  // The events may wrap around the end of the ring
+  uint64_t first = tail % TRACE_RING_SIZE;
+  uint64_t count = head - tail;
+  uint64_t before_end = TRACE_RING_SIZE - first;
+  if (count <= before_end) {
+    fwrite(&ring->events[first], sizeof(TraceEvent), count, trace->file);
+  } else {
+    fwrite(&ring->events[first], sizeof(TraceEvent), before_end, trace->file);
+    fwrite(ring->events, sizeof(TraceEvent), count - before_end, trace->file);
+  }
+
+  // The slots can be reused once copied
+  atomic_store_explicit(&ring->tail, head, memory_order_release);
+  trace->written += count;
+  return count;
+}
+
+/**
+ * Background thread writing the rings to the file until the trace is closed
+ */
+static void *traceWriter(void *arg) {
+  Trace *trace = (Trace *)arg;
+  struct timespec pause = {0, TRACE_WRITER_PAUSE_NS};
+
+  while (!atomic_load_explicit(&trace->stop, memory_order_acquire)) {
+    unsigned int count = 0;
+    for (int t = 0; t < trace->n_rings; t++) {
+      count += drainRing(trace, &trace->rings[t]);
+    }
+    if (count == 0)
+      nanosleep(&pause, NULL);
+  }
+  return NULL;
+}
+
+/**
+ * Create the file of the trace and start its writer, NULL on failure
+ */
+Trace *openTrace(const char *filename, int n_threads) {
+  Trace *trace = (Trace *)calloc(1, sizeof(Trace));
+  if (trace == NULL) {
+    log_error("Error: Could not allocate the trace.");
+    return NULL;
+  }
+  trace->file = fopen(filename, "wb");
+  if (trace->file == NULL) {
+    log_error("Error: Could not open file %s.", filename);
+    free(trace);
+    return NULL;
+  }
+
+  trace->n_rings = n_threads;
+  trace->rings = (TraceRing *)aligned_alloc(
+      64, (size_t)n_threads * sizeof(TraceRing));
+  if (trace->rings == NULL) {
+    log_error("Error: Could not allocate the trace rings.");
+    fclose(trace->file);
+    free(trace);
+    return NULL;
+  }
+  for (int t = 0; t < n_threads; t++) {
+    atomic_init(&trace->rings[t].head, 0);
+    atomic_init(&trace->rings[t].tail, 0);
+    atomic_init(&trace->rings[t].dropped, 0);
+  }
+
+  TraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.event_size = sizeof(TraceEvent);
+  header.start = nowNs(CLOCK_REALTIME);
+  fwrite(&header, sizeof(header), 1, trace->file);
+
+  trace->origin = nowNs(CLOCK_MONOTONIC);
+  atomic_init(&trace->stop, false);
+  if (pthread_create(&trace->writer, NULL, traceWriter, trace) != 0) {
+    log_error("Error: Could not start the trace writer.");
+    fclose(trace->file);
+    free(trace->rings);
+    free(trace);
+    return NULL;
+  }
+  return trace;
+}
+
+/**
+ * Record an event in the ring of the calling thread. Never waits: the event
+ * is dropped if the ring is full.
+ */
+void traceEvent(Trace *trace, traceType type, uint64_t a, uint64_t b, float x,
+                float y) {
+  int thread = omp_get_thread_num();
+  if (thread >= trace->n_rings)
+    return;
+
+  TraceRing *ring = &trace->rings[thread];
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail == TRACE_RING_SIZE) {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  TraceEvent *event = &ring->events[head % TRACE_RING_SIZE];
+  event->time = nowNs(CLOCK_MONOTONIC) - trace->origin;
+  event->type = type;
+  event->thread = thread;
+  event->a = a;
+  event->b = b;
+  event->x = x;
+  event->y = y;
+
+  // Publish the event to the writer
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void traceStepBegin(Trace *trace, uint64_t springs) {
+  traceEvent(trace, TRACE_STEP_BEGIN, trace->step, springs, 0.0f, 0.0f);
+}
+
+void traceStepEnd(Trace *trace, uint64_t springs) {
+  traceEvent(trace, TRACE_STEP_END, trace->step, springs, 0.0f, 0.0f);
+  trace->step++;
+}
+
+/**
+ * Stop the writer, write the remaining events and close the file
+ */
+void closeTrace(Trace *trace) {
+  if (trace == NULL)
+    return;
+
+  atomic_store_explicit(&trace->stop, true, memory_order_release);
+  pthread_join(trace->writer, NULL);
+
+  uint64_t dropped = 0;
+  for (int t = 0; t < trace->n_rings; t++) {
+    drainRing(trace, &trace->rings[t]);
+    dropped += atomic_load(&trace->rings[t].dropped);
+  }
+  fclose(trace->file);
+
+  log_info("Trace: %llu events written, %llu dropped",
+           (unsigned long long)trace->written, (unsigned long long)dropped);
+  free(trace->rings);
+  free(trace);
+}
+
+const char *traceTypeName(traceType type) {
+  switch (type) {
+  case TRACE_STEP_BEGIN:
+  case TRACE_STEP_END:
+    return "step";
+  case TRACE_SPRING_BREAK:
+    return "spring_break";
+  case TRACE_NORMAL_FAILURE:
+    return "normal_failure";
+  default:
+    return "unknown";
+  }
+}
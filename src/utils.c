@@ -1,4 +1,7 @@
 #include "utils.h"
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
 
 int createDirectory(const char *path) {
   struct stat st = {0};
@@ -18,24 +21,290 @@ int createDirectory(const char *path) {
 }
 
 meshType parseArguments(int argc, char *argv[]) {
-  if (argc != 2) { // only one argument
-    log_error("Usage: %s [curtain] | [table-cloth] | [soft] ", argv[0]);
+  if (argc < 2) { // the mesh type is mandatory, options may follow
+    log_error("Usage: %s [curtain] | [table-cloth] | [soft] | [flag] "
+              "[--sink=vtk|shm|image|none] [--shm-name=NAME] [--shm-slots=K] "
+              "[--output-tolerance=SPACINGS] [--output-min=UPDATES] "
+              "[--output-max=UPDATES] "
+              "[--image-size=WIDTHxHEIGHT] [--camera=X,Y,Z] "
+              "[--look-at=X,Y,Z] [--fov=DEGREES] [--color=state|strain] "
+              "[--image-format=png|ppm] "
+              "[--profile=REPORT.json|REPORT.csv] [--deterministic] "
+              "[--tile=SIZE] [--stencil] [--obj=FILE] "
+              "[--reorder=none|morton|rcm] [--refine=LEVELS] "
+              "[--pin=none|compact|spread] "
+              "[--diagnostics=FILE.csv] "
+              "[--stop-at-rest=ENERGY] [--stop-broken=FRACTION] "
+              "[--trace=FILE.bin] [--body=TYPE[:X,Y,Z]]... [--size=NxM] "
+              "[--preview=K] [--preview-step=UPDATES] "
+              "[--temporal=STEPS (implies --deterministic)] "
+              "[--temporal-tile=SIZE]",
+              argv[0]);
     exit(EXIT_FAILURE);
   }
 
-  if (strcmp(argv[1], "curtain") == 0) {
-    return CURTAIN;
-  } else if (strcmp(argv[1], "table-cloth") == 0) {
-    return TABLE_CLOTH;
-  } else if (strcmp(argv[1], "soft") == 0) {
-    return SOFT;
-  } else if (strcmp(argv[1], "flag") == 0) {
-    return FLAG;
-  } else {
+  meshType type;
+  if (!parseMeshType(argv[1], &type)) {
     log_error("the requested arguments doesn't exists");
     log_error("Usage: %s [curtain] | [table-cloth] ", argv[0]);
     exit(EXIT_FAILURE);
   }
+  return type;
+}
+
+bool parseMeshType(const char *name, meshType *type) {
+  if (strcmp(name, "curtain") == 0) {
+    *type = CURTAIN;
+  } else if (strcmp(name, "table-cloth") == 0) {
+    *type = TABLE_CLOTH;
+  } else if (strcmp(name, "soft") == 0) {
+    *type = SOFT;
+  } else if (strcmp(name, "flag") == 0) {
+    *type = FLAG;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Return the value of the option `name` if argument is --name=value, NULL
+ * otherwise
+ */
+static const char *optionValue(const char *arg, const char *name) {
+  size_t len = strlen(name);
+  if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, len) != 0 ||
+      arg[2 + len] != '=')
+    return NULL;
+  return arg + 3 + len;
+}
+
+/**
+ * Read the vector given as x,y,z, exits if it is not one
+ */
+static Vector parseVector(const char *value) {
+  Vector v;
+  if (sscanf(value, "%f,%f,%f", &v.x, &v.y, &v.z) != 3) {
+    log_error("Expected a vector X,Y,Z instead of %s", value);
+    exit(EXIT_FAILURE);
+  }
+  return v;
+}
+
+void parseOptions(int argc, char *argv[], Options *options) {
+  options->sink = SINK_VTK;
+  options->output_tolerance = 0.0f;
+  options->output_min = 1;
+  options->output_max = 0;
+  options->shm_name = SHM_DEFAULT_NAME;
+  options->shm_slots = SHM_DEFAULT_SLOTS;
+  options->camera = defaultCamera();
+  options->color = COLOR_STATE;
+  options->format = IMAGE_PNG;
+  options->profile = NULL;
+  options->deterministic = false;
+  options->tile_size = 0;
+  options->stencil = false;
+  options->obj = NULL;
+  options->reorder = REORDER_RCM;
+  options->refine = 0;
+  options->pin = PIN_NONE;
+  options->diagnostics = NULL;
+  options->stop_at_rest = 0.0f;
+  options->stop_broken = 0.0f;
+  options->trace = NULL;
+  options->n_bodies = 0;
+  options->lines = 0;
+  options->columns = 0;
+  options->preview = 0;
+  options->preview_step = 0;
+  options->temporal = 0;
+  options->temporal_tile = 0;
+
+  const char *value;
+  for (int k = 2; k < argc; k++) {
+    if ((value = optionValue(argv[k], "sink")) != NULL) {
+      if (strcmp(value, "vtk") == 0) {
+        options->sink = SINK_VTK;
+      } else if (strcmp(value, "shm") == 0) {
+        options->sink = SINK_SHM;
+      } else if (strcmp(value, "image") == 0) {
+        options->sink = SINK_IMAGE;
+      } else if (strcmp(value, "none") == 0) {
+        options->sink = SINK_NONE;
+      } else {
+        log_error("Unknown sink %s, expected vtk, shm, image or none",
+                  value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "preview")) != NULL) {
+      options->preview = (unsigned int)atoi(value);
+      if (options->preview < 2) {
+        log_error("--preview needs K >= 2, got %s", value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "preview-step")) != NULL) {
+      options->preview_step = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "output-tolerance")) != NULL) {
+      options->output_tolerance = (float)atof(value);
+    } else if ((value = optionValue(argv[k], "output-min")) != NULL) {
+      options->output_min = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "output-max")) != NULL) {
+      options->output_max = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "shm-name")) != NULL) {
+      if (strlen(value) >= SHM_NAME_MAX) {
+        log_error("--shm-name needs less than %d characters, got %s",
+                  SHM_NAME_MAX, value);
+        exit(EXIT_FAILURE);
+      }
+      options->shm_name = value;
+    } else if ((value = optionValue(argv[k], "shm-slots")) != NULL) {
+      char *end;
+      unsigned long slots = strtoul(value, &end, 10);
+      if (*value == '\0' || *end != '\0' || value[0] == '-' ||
+          slots < 2 || slots > UINT_MAX) {
+        log_error("--shm-slots needs a number of slots K >= 2, got %s",
+                  value);
+        exit(EXIT_FAILURE);
+      }
+      options->shm_slots = (unsigned int)slots;
+    } else if ((value = optionValue(argv[k], "image-size")) != NULL) {
+      if (sscanf(value, "%ux%u", &options->camera.width,
+                 &options->camera.height) != 2 ||
+          options->camera.width == 0 || options->camera.height == 0) {
+        log_error("Expected an image size WIDTHxHEIGHT instead of %s", value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "size")) != NULL) {
+      if (sscanf(value, "%ux%u", &options->lines, &options->columns) != 2 ||
+          options->lines < 2 || options->columns < 2) {
+        log_error("Expected a grid size NxM of at least 2x2 instead of %s",
+                  value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "camera")) != NULL) {
+      options->camera.eye = parseVector(value);
+      options->camera.has_eye = true;
+    } else if ((value = optionValue(argv[k], "look-at")) != NULL) {
+      options->camera.target = parseVector(value);
+      options->camera.has_target = true;
+    } else if ((value = optionValue(argv[k], "fov")) != NULL) {
+      options->camera.fov = (float)atof(value);
+    } else if ((value = optionValue(argv[k], "image-format")) != NULL) {
+      if (!parseImageFormat(value, &options->format)) {
+        log_error("Unknown image format %s, expected png or ppm", value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "color")) != NULL) {
+      if (!parseColorMode(value, &options->color)) {
+        log_error("Unknown color %s, expected state or strain", value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "profile")) != NULL) {
+      options->profile = value;
+    } else if (strcmp(argv[k], "--deterministic") == 0) {
+      options->deterministic = true;
+    } else if (strcmp(argv[k], "--stencil") == 0) {
+      options->stencil = true;
+    } else if ((value = optionValue(argv[k], "obj")) != NULL) {
+      options->obj = value;
+    } else if ((value = optionValue(argv[k], "reorder")) != NULL) {
+      if (!parseReorderPolicy(value, &options->reorder)) {
+        log_error("Unknown reordering %s, expected none, morton or rcm",
+                  value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "refine")) != NULL) {
+      options->refine = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "tile")) != NULL) {
+      options->tile_size = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "temporal")) != NULL) {
+      // The blocks of updates give the results of the deterministic mode
+      options->temporal = (unsigned int)atoi(value);
+      options->deterministic = true;
+    } else if ((value = optionValue(argv[k], "temporal-tile")) != NULL) {
+      options->temporal_tile = (unsigned int)atoi(value);
+    } else if ((value = optionValue(argv[k], "pin")) != NULL) {
+      if (!parsePinPolicy(value, &options->pin)) {
+        log_error("Unknown pinning %s, expected none, compact or spread",
+                  value);
+        exit(EXIT_FAILURE);
+      }
+    } else if ((value = optionValue(argv[k], "diagnostics")) != NULL) {
+      options->diagnostics = value;
+    } else if ((value = optionValue(argv[k], "stop-at-rest")) != NULL) {
+      options->stop_at_rest = (float)atof(value);
+    } else if ((value = optionValue(argv[k], "stop-broken")) != NULL) {
+      options->stop_broken = (float)atof(value);
+    } else if ((value = optionValue(argv[k], "trace")) != NULL) {
+      options->trace = value;
+    } else if ((value = optionValue(argv[k], "body")) != NULL) {
+      // TYPE or TYPE:X,Y,Z, the body being at the origin by default
+      if (options->n_bodies == MAX_BODIES) {
+        log_error("At most %d bodies can be added", MAX_BODIES);
+        exit(EXIT_FAILURE);
+      }
+      char name[32];
+      const char *offset = strchr(value, ':');
+      size_t len = offset != NULL ? (size_t)(offset - value) : strlen(value);
+      snprintf(name, sizeof(name), "%.*s", (int)len, value);
+      unsigned int b = options->n_bodies++;
+      if (!parseMeshType(name, &options->body_types[b])) {
+        log_error("Unknown body %s, expected curtain, table-cloth, soft or "
+                  "flag",
+                  name);
+        exit(EXIT_FAILURE);
+      }
+      options->body_offsets[b] = offset != NULL
+                                     ? parseVector(offset + 1)
+                                     : newVector(0.0f, 0.0f, 0.0f);
+    } else {
+      log_error("Unknown option %s", argv[k]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // The early stops are decided on the diagnostics
+  if (options->diagnostics == NULL &&
+      (options->stop_at_rest > 0.0f || options->stop_broken > 0.0f)) {
+    log_error("--stop-at-rest and --stop-broken need --diagnostics");
+    exit(EXIT_FAILURE);
+  }
+  if (options->stencil && options->tile_size > 0) {
+    log_error("--stencil and --tile can not be used together");
+    exit(EXIT_FAILURE);
+  }
+  if (options->obj != NULL && (options->stencil || options->tile_size > 0)) {
+    log_error("--obj can not be used with --stencil or --tile");
+    exit(EXIT_FAILURE);
+  }
+  if (options->refine > 0 &&
+      (options->obj != NULL || options->stencil || options->tile_size > 0 ||
+       options->sink == SINK_SHM)) {
+    log_error("--refine can not be used with --obj, --stencil, --tile or "
+              "--sink=shm");
+    exit(EXIT_FAILURE);
+  }
+  if (options->n_bodies > 0 &&
+      (options->obj != NULL || options->refine > 0 || options->stencil ||
+       options->tile_size > 0)) {
+    log_error("--body can not be used with --obj, --refine, --stencil or "
+              "--tile");
+    exit(EXIT_FAILURE);
+  }
+  if (options->temporal > 1 &&
+      (options->stencil || options->tile_size > 0 || options->obj != NULL ||
+       options->refine > 0 || options->n_bodies > 0)) {
+    log_error("--temporal can not be used with --stencil, --tile, --obj, "
+              "--refine or --body");
+    exit(EXIT_FAILURE);
+  }
+  // The preview reads the lines and columns of a grid
+  if (options->preview > 0 &&
+      (options->obj != NULL || options->refine > 0 || options->n_bodies > 0)) {
+    log_error("--preview can not be used with --obj, --refine or --body");
+    exit(EXIT_FAILURE);
+  }
 }
 
 /**
@@ -62,12 +331,253 @@ const char *getTypeName(meshType type) {
 }
 
 /**
- * Convert a mesh into a set of points and lines in a vtk file
+ * Write the formatted file of `size` bytes in output_filename with a single
+ * write, and free it
  */
-void convertMeshToPolyVTK(const Mesh *mesh, const char *output_filename) {
+static void writeFormattedFile(const Mesh *mesh, const char *output_filename,
+                               char *buffer, size_t size) {
+  PROFILE_START(mesh->profile, write_start);
   FILE *file = fopen(output_filename, "w");
   if (file == NULL) {
     log_error("Error: Could not open file %s.\n", output_filename);
+  } else {
+    fwrite(buffer, 1, size, file);
+    fclose(file);
+  }
+  free(buffer);
+  PROFILE_STOP(mesh->profile, PHASE_VTK_WRITE, write_start);
+}
+
+/**
+ * Write value in decimal at out, return the end of the text
+ */
+static char *formatUnsigned(char *out, unsigned long long value) {
+  char digits[20];
+  unsigned int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (n > 0)
+    *out++ = digits[--n];
+  return out;
+}
+
+/**
+ * Write value at out as printf("%f") does, return the end of the text.
+ * value * 1e6 is exact in a double (24 bits of mantissa times the 14 bits of
+ * 15625), so rounding it to the nearest integer, ties to even, gives the
+ * 6 decimals of printf.
+ */
+static char *formatFloat(char *out, float value) {
+  double scaled = (double)value * 1e6;
+  if (!(fabs(scaled) < 9e15)) // NaN, infinite or too large for the digits
+    return out + sprintf(out, "%f", value);
+
+  unsigned long long digits = (unsigned long long)fabs(nearbyint(scaled));
+  if (signbit(value))
+    *out++ = '-';
+  out = formatUnsigned(out, digits / 1000000);
+  *out++ = '.';
+  unsigned int decimals = digits % 1000000;
+  for (int k = 5; k >= 0; k--) {
+    out[k] = '0' + decimals % 10;
+    decimals /= 10;
+  }
+  return out + 6;
+}
+
+/**
+ * Write the row of a section of a VTK file at out, return the end of the
+ * text. The rows are read from source, usually the mesh.
+ */
+typedef char *(*rowFormat)(char *out, const void *source, size_t row);
+
+/**
+ * Write the rows of a section in file, each at most row_size bytes: blocks
+ * of rows are formatted in parallel, one per thread, then written in order
+ */
+static void formatRows(FILE *file, const void *source, size_t rows,
+                       size_t row_size, rowFormat format) {
+  size_t blocks = (rows + VTK_BLOCK_ROWS - 1) / VTK_BLOCK_ROWS;
+  size_t threads = omp_get_max_threads();
+  if (threads > blocks)
+    threads = blocks;
+  if (threads == 0)
+    return;
+  size_t capacity = VTK_BLOCK_ROWS * row_size;
+  char *buffers = (char *)malloc(threads * capacity);
+  size_t *lengths = (size_t *)malloc(threads * sizeof(size_t));
+
+  for (size_t first = 0; first < blocks; first += threads) {
+    size_t count = blocks - first < threads ? blocks - first : threads;
+#pragma omp parallel for schedule(static, 1) if (count > 1)
+    for (size_t b = 0; b < count; b++) {
+      size_t begin = (first + b) * VTK_BLOCK_ROWS;
+      size_t end = begin + VTK_BLOCK_ROWS;
+      if (end > rows)
+        end = rows;
+      char *out = buffers + b * capacity;
+      for (size_t row = begin; row < end; row++)
+        out = format(out, source, row);
+      lengths[b] = out - (buffers + b * capacity);
+    }
+    for (size_t b = 0; b < count; b++)
+      fwrite(buffers + b * capacity, 1, lengths[b], file);
+  }
+  free(buffers);
+  free(lengths);
+}
+
+/**
+ * The point p, as "x y z"
+ */
+static char *formatVector(char *out, Vector p) {
+  out = formatFloat(out, p.x);
+  *out++ = ' ';
+  out = formatFloat(out, p.y);
+  *out++ = ' ';
+  out = formatFloat(out, p.z);
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The point of index row
+ */
+static char *formatPoint(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  return formatVector(out, mesh->P[row / mesh->m][row % mesh->m]);
+}
+
+/**
+ * The spring of index row as a line between its points, nothing if broken
+ */
+static char *formatSpring(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  const Spring *spring = &mesh->springs[row];
+  if (spring->isBreak)
+    return out;
+
+  // Convert grid coordinates (i, j) to point indices
+  *out++ = '2';
+  *out++ = ' ';
+  out = formatUnsigned(out, spring->ext_1.i * mesh->m + spring->ext_1.j);
+  *out++ = ' ';
+  out = formatUnsigned(out, spring->ext_2.i * mesh->m + spring->ext_2.j);
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The spring of the stencil in the direction row / (n * m) from the point
+ * row % (n * m), nothing if there is none or it is broken
+ */
+static char *formatStencilSpring(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  unsigned int d = row / (mesh->n * mesh->m);
+  unsigned int id1 = row % (mesh->n * mesh->m);
+  unsigned int i = id1 / mesh->m, j = id1 % mesh->m;
+  if (!stencilHasSpring(mesh->stencil, d, i, j) ||
+      STENCIL_BROKEN(mesh->stencil, d, id1))
+    return out;
+  unsigned int id2 =
+      (i + STENCIL_OFFSET[d][0]) * mesh->m + j + STENCIL_OFFSET[d][1];
+  *out++ = '2';
+  *out++ = ' ';
+  out = formatUnsigned(out, id1);
+  *out++ = ' ';
+  out = formatUnsigned(out, id2);
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The quad of the face of index row of a grid of m columns
+ */
+static char *formatQuad(char *out, unsigned int m, size_t row) {
+  unsigned int i = row / (m - 1), j = row % (m - 1);
+  unsigned int id1 = i * m + j;
+  unsigned int id2 = i * m + (j + 1);
+  unsigned int id3 = (i + 1) * m + j;
+  unsigned int id4 = (i + 1) * m + (j + 1);
+  unsigned int ids[4] = {id1, id2, id4, id3};
+  *out++ = '4';
+  for (int k = 0; k < 4; k++) {
+    *out++ = ' ';
+    out = formatUnsigned(out, ids[k]);
+  }
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The quad of the face of index row of the grid
+ */
+static char *formatGridCell(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  return formatQuad(out, mesh->m, row);
+}
+
+/**
+ * The triangle or quad of the face of index row of an imported mesh
+ */
+static char *formatSurfaceCell(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  const unsigned int *face = mesh->surface->faces[row];
+  unsigned int size = faceSize(mesh->surface, row);
+  *out++ = '0' + size;
+  for (unsigned int k = 0; k < size; k++) {
+    *out++ = ' ';
+    out = formatUnsigned(out, face[k]);
+  }
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The VTK type of the face of index row of an imported mesh: VTK_TRIANGLE
+ * = 5, VTK_POLYGON = 7
+ */
+static char *formatSurfaceCellType(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  *out++ = faceSize(mesh->surface, row) == 3 ? '5' : '7';
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The VTK type of a face of a grid, VTK_POLYGON = 7
+ */
+static char *formatGridCellType(char *out, const void *source, size_t row) {
+  (void)source;
+  (void)row;
+  *out++ = '7';
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * The state of the face of index row, 1 if it is intact
+ */
+static char *formatFaceState(char *out, const void *source, size_t row) {
+  const Mesh *mesh = source;
+  *out++ = isMeshFaceIntact(mesh, row) ? '1' : '0';
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * Convert a mesh into a set of points and lines in a vtk file
+ */
+void convertMeshToPolyVTK(const Mesh *mesh, const char *output_filename) {
+  // The file is formatted in memory, then written at once
+  PROFILE_START(mesh->profile, format_start);
+  char *buffer;
+  size_t size;
+  FILE *file = open_memstream(&buffer, &size);
+  if (file == NULL) {
+    log_error("Error: Could not format file %s.\n", output_filename);
     return;
   }
 
@@ -80,41 +590,56 @@ void convertMeshToPolyVTK(const Mesh *mesh, const char *output_filename) {
   // Write points
   unsigned int total_points = mesh->n * mesh->m;
   fprintf(file, "POINTS %u float\n", total_points);
-  for (unsigned int i = 0; i < mesh->n; i++) {
-    for (unsigned int j = 0; j < mesh->m; j++) {
-      fprintf(file, "%3f %3f %3f\n", mesh->P[i][j].x, mesh->P[i][j].y,
-              mesh->P[i][j].z);
-    }
-  }
-
-  // Write lines (springs)
-  unsigned int total_number_of_springs = numberOfSprings(mesh->n, mesh->m);
+  formatRows(file, mesh, total_points, 3 * VTK_FLOAT_TEXT, formatPoint);
 
-  // print all springs
-  fprintf(file, "LINES %u %u\n", mesh->n_springs, 3 * mesh->n_springs);
-  for (unsigned int k = 0; k < total_number_of_springs; k++) {
+  // Write lines (springs), those of the stencil direction after direction
+  fprintf(file, "LINES %" PRI_MESH_INDEX " %" PRI_MESH_INDEX "\n",
+          mesh->n_springs, 3 * mesh->n_springs);
+  if (mesh->stencil != NULL)
+    formatRows(file, mesh, (size_t)STENCIL_DIRECTIONS * total_points, 32,
+               formatStencilSpring);
+  else
+    formatRows(file, mesh, mesh->total_springs, 32, formatSpring);
 
-    if (mesh->springs[k].isBreak)
-      continue;
+  fclose(file);
+  PROFILE_STOP(mesh->profile, PHASE_VTK_FORMAT, format_start);
+  writeFormattedFile(mesh, output_filename, buffer, size);
+}
 
-    // Convert grid coordinates (i, j) to point indices
-    unsigned int id1 =
-        mesh->springs[k].ext_1.i * mesh->m + mesh->springs[k].ext_1.j;
-    unsigned int id2 =
-        mesh->springs[k].ext_2.i * mesh->m + mesh->springs[k].ext_2.j;
-    fprintf(file, "2 %d %d\n", id1, id2);
+/**
+ * Write the triangles and quads of an imported mesh and their state
+ */
+static void writeSurfaceCells(FILE *file, const Mesh *mesh) {
+  const Surface *surface = mesh->surface;
+  meshIndex total_size = 0;
+  for (unsigned int f = 0; f < surface->n_faces; f++) {
+    total_size += faceSize(surface, f) + 1;
   }
 
-  fclose(file);
+  fprintf(file, "CELLS %u %" PRI_MESH_INDEX "\n", surface->n_faces,
+          total_size);
+  formatRows(file, mesh, surface->n_faces, 48, formatSurfaceCell);
+
+  fprintf(file, "CELL_TYPES %u\n", surface->n_faces);
+  formatRows(file, mesh, surface->n_faces, 2, formatSurfaceCellType);
+
+  fprintf(file, "CELL_DATA %u\n", surface->n_faces);
+  fprintf(file, "SCALARS face_state int 1\n");
+  fprintf(file, "LOOKUP_TABLE default\n");
+  formatRows(file, mesh, surface->n_faces, 2, formatFaceState);
 }
 
 /**
  * Convert a Mesh into a a grid that can be used as surface easily.
  */
 void convertMeshToGridVTK(const Mesh *mesh, const char *output_filename) {
-  FILE *file = fopen(output_filename, "w");
+  // The file is formatted in memory, then written at once
+  PROFILE_START(mesh->profile, format_start);
+  char *buffer;
+  size_t size;
+  FILE *file = open_memstream(&buffer, &size);
   if (file == NULL) {
-    log_error("Error: Could not open file %s.\n", output_filename);
+    log_error("Error: Could not format file %s.\n", output_filename);
     return;
   }
 
@@ -129,62 +654,140 @@ void convertMeshToGridVTK(const Mesh *mesh, const char *output_filename) {
   // Write points
   unsigned int total_points = mesh->n * mesh->m;
   fprintf(file, "POINTS %u float\n", total_points);
-  for (unsigned int i = 0; i < mesh->n; i++) {
-    for (unsigned int j = 0; j < mesh->m; j++) {
-      fprintf(file, "%f %f %f\n", mesh->P[i][j].x, mesh->P[i][j].y,
-              mesh->P[i][j].z);
-    }
+  formatRows(file, mesh, total_points, 3 * VTK_FLOAT_TEXT, formatPoint);
+
+  // The faces of an imported mesh are those of its file
+  if (mesh->surface != NULL) {
+    writeSurfaceCells(file, mesh);
+    fclose(file);
+    PROFILE_STOP(mesh->profile, PHASE_VTK_FORMAT, format_start);
+    writeFormattedFile(mesh, output_filename, buffer, size);
+    return;
   }
 
   // Write cells (quadrilateral)
-  unsigned int total_cells = (mesh->n - 1) * (mesh->m - 1);
-  fprintf(
-      file, "CELLS %u %u\n", total_cells,
-      5 * total_cells); // Each cell has 4 points + 1 (for the number of points)
-  for (unsigned int i = 0; i < mesh->n - 1; i++) {
-    for (unsigned int j = 0; j < mesh->m - 1; j++) {
-      unsigned int id1 = i * mesh->m + j;
-      unsigned int id2 = i * mesh->m + (j + 1);
-      unsigned int id3 = (i + 1) * mesh->m + j;
-      unsigned int id4 = (i + 1) * mesh->m + (j + 1);
-      fprintf(file, "4 %d %d %d %d\n", id1, id2, id4, id3);
-    }
-  }
+  // Each cell has 4 points + 1 (for the number of points)
+  meshIndex total_cells = mesh->n_faces;
+  fprintf(file, "CELLS %" PRI_MESH_INDEX " %" PRI_MESH_INDEX "\n",
+          total_cells, 5 * total_cells);
+  formatRows(file, mesh, total_cells, 48, formatGridCell);
 
   // Write cell types
-  // VTK_QUAD = 9
-  fprintf(file, "CELL_TYPES %u\n", total_cells);
-  for (unsigned int k = 0; k < total_cells; k++) {
-    fprintf(file, "7\n");
-  }
+  fprintf(file, "CELL_TYPES %" PRI_MESH_INDEX "\n", total_cells);
+  formatRows(file, mesh, total_cells, 2, formatGridCellType);
 
   // Write cell data (state of each face)
-  fprintf(file, "CELL_DATA %u\n", total_cells);
+  fprintf(file, "CELL_DATA %" PRI_MESH_INDEX "\n", total_cells);
   fprintf(file, "SCALARS face_state int 1\n");
   fprintf(file, "LOOKUP_TABLE default\n");
+  formatRows(file, mesh, total_cells, 2, formatFaceState);
 
-  for (unsigned int i = 0; i < mesh->n - 1; i++) {
-    for (unsigned int j = 0; j < mesh->m - 1; j++) {
-      bool face_state = true;
-
-      // Access the springs associated with this face directly
-      unsigned int *spring_indices = mesh->face_spring_indices[i][j];
-
-      for (unsigned int k = 0; k < 4;
-           k++) { // we use 4 because we consider only structural springs are
-                  // part of the face.
-        if (spring_indices[k] != -1 &&
-            mesh->springs[spring_indices[k]]
-                .isBreak) { // the spring_indices[k] != -1 condition may be
-                            // unnecessary but...
-          face_state = false;
-          break;
-        }
-      }
+  fclose(file);
+  PROFILE_STOP(mesh->profile, PHASE_VTK_FORMAT, format_start);
+  writeFormattedFile(mesh, output_filename, buffer, size);
+}
+
+// A preview of a grid: every k-th line and column, and the last ones. The
+// face (a, b) of the preview covers the faces of the grid between its lines
+// a and a + 1 and its columns b and b + 1.
+typedef struct Preview {
+  const Mesh *mesh;
+  unsigned int k;
+  unsigned int n, m; // lines and columns of the preview
+} Preview;
+
+/**
+ * Line or column of the grid of the line or column a of the preview, n
+ * being the lines or columns of the grid
+ */
+static unsigned int previewLine(const Preview *preview, unsigned int a,
+                                unsigned int n) {
+  return a * preview->k < n - 1 ? a * preview->k : n - 1;
+}
+
+/**
+ * The point of index row of the preview
+ */
+static char *formatPreviewPoint(char *out, const void *source, size_t row) {
+  const Preview *preview = source;
+  const Mesh *mesh = preview->mesh;
+  unsigned int i = previewLine(preview, row / preview->m, mesh->n);
+  unsigned int j = previewLine(preview, row % preview->m, mesh->m);
+  return formatVector(out, mesh->P[i][j]);
+}
+
+/**
+ * The quad of the face of index row of the preview
+ */
+static char *formatPreviewCell(char *out, const void *source, size_t row) {
+  const Preview *preview = source;
+  return formatQuad(out, preview->m, row);
+}
 
-      // Write the face state
-      fprintf(file, "%d\n", face_state ? 1 : 0);
+/**
+ * The state of the face of index row of the preview, 1 if all the faces of
+ * the grid it covers are intact
+ */
+static char *formatPreviewState(char *out, const void *source, size_t row) {
+  const Preview *preview = source;
+  const Mesh *mesh = preview->mesh;
+  unsigned int a = row / (preview->m - 1), b = row % (preview->m - 1);
+  unsigned int i1 = previewLine(preview, a + 1, mesh->n);
+  unsigned int j1 = previewLine(preview, b + 1, mesh->m);
+  bool intact = true;
+  for (unsigned int i = previewLine(preview, a, mesh->n); i < i1 && intact;
+       i++) {
+    for (unsigned int j = previewLine(preview, b, mesh->m); j < j1; j++) {
+      if (!isFaceIntact(mesh, i, j)) {
+        intact = false;
+        break;
+      }
     }
   }
+  *out++ = intact ? '1' : '0';
+  *out++ = '\n';
+  return out;
+}
+
+/**
+ * Write every k-th line and column of a grid, and its last ones, as a grid
+ * VTK file. The points are read from the mesh, and a face is intact if all
+ * the faces of the grid it covers are.
+ */
+void convertMeshToPreviewVTK(const Mesh *mesh, unsigned int k,
+                             const char *output_filename) {
+  Preview preview = {mesh, k, 1 + (mesh->n + k - 2) / k,
+                     1 + (mesh->m + k - 2) / k};
+  PROFILE_START(mesh->profile, format_start);
+  char *buffer;
+  size_t size;
+  FILE *file = open_memstream(&buffer, &size);
+  if (file == NULL) {
+    log_error("Error: Could not format file %s.\n", output_filename);
+    return;
+  }
+
+  fprintf(file, "# vtk DataFile Version 4.2\n");
+  fprintf(file, "Preview Grid Mesh\n");
+  fprintf(file, "ASCII\n");
+  fprintf(file, "DATASET UNSTRUCTURED_GRID\n");
+
+  unsigned int total_points = preview.n * preview.m;
+  fprintf(file, "POINTS %u float\n", total_points);
+  formatRows(file, &preview, total_points, 3 * VTK_FLOAT_TEXT,
+             formatPreviewPoint);
+
+  unsigned int total_cells = (preview.n - 1) * (preview.m - 1);
+  fprintf(file, "CELLS %u %u\n", total_cells, 5 * total_cells);
+  formatRows(file, &preview, total_cells, 48, formatPreviewCell);
+  fprintf(file, "CELL_TYPES %u\n", total_cells);
+  formatRows(file, &preview, total_cells, 2, formatGridCellType);
+  fprintf(file, "CELL_DATA %u\n", total_cells);
+  fprintf(file, "SCALARS face_state int 1\n");
+  fprintf(file, "LOOKUP_TABLE default\n");
+  formatRows(file, &preview, total_cells, 2, formatPreviewState);
+
   fclose(file);
+  PROFILE_STOP(mesh->profile, PHASE_VTK_FORMAT, format_start);
+  writeFormattedFile(mesh, output_filename, buffer, size);
 }
@@ -0,0 +1,404 @@
+#include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../include/alloc.h"
+#include "../include/mesh.h"
+#include "../include/utils.h"
+
+/**
+ * Benchmark of the kernels in isolation, for every mesh type, mesh size and
+ * thread count, written as CSV.
+ *
+ * Usage: bench [--types=curtain,table-cloth,soft,flag]
+ *              [--sizes=20,50,100,200,500,1000,2000] [--threads=1,2,4...]
+ *              [--reps=5] [--warmup=2] [--vtk-max-size=500]
+ *              [--output=bench.csv] [--deterministic] [--stencil]
+ *              [--tile=SIZE]
+ *              [--pin=none|compact|spread]
+ *
+ * Springs never break during the benchmark so every repetition does the same
+ * work. The bandwidth is the compulsory traffic of a kernel (every array it
+ * reads or writes, once) divided by its median time, for the VTK writers the
+ * size of the file written. Built with make COUNT_ALLOCS=1, the heap
+ * allocations of a call are reported too.
+ */
+
+#define MAX_LIST 32
+
+typedef enum {
+  KERNEL_SPRINGS, // computeSpringForces
+  KERNEL_UPDATE,  // updatePosition
+  KERNEL_FLUID,   // computeFluidForce on every point
+  KERNEL_VTK_POLY,
+  KERNEL_VTK_GRID,
+  KERNEL_COUNT
+} benchKernel;
+
+static const char *KERNEL_NAMES[KERNEL_COUNT] = {
+    "computeSpringForces", "updatePosition", "computeFluidForce",
+    "convertMeshToPolyVTK", "convertMeshToGridVTK"};
+
+typedef struct BenchResult {
+  meshType type;
+  unsigned int size; // the mesh is size * size
+  unsigned int threads;
+  benchKernel kernel;
+  double min, median, mean; // seconds per call
+  double bytes;             // compulsory traffic of a call
+  double allocations;       // heap allocations of a call, NAN if not counted
+} BenchResult;
+
+typedef struct BenchConfig {
+  meshType types[MAX_LIST];
+  unsigned int n_types;
+  unsigned int sizes[MAX_LIST];
+  unsigned int n_sizes;
+  unsigned int threads[MAX_LIST];
+  unsigned int n_threads;
+  unsigned int reps, warmup;
+  unsigned int vtk_max_size;
+  const char *output;
+  bool deterministic; // params.DETERMINISTIC of the meshes
+  unsigned int tile_size; // params.TILE_SIZE of the meshes
+  bool stencil;           // params.STENCIL of the meshes
+  pinPolicy pin;
+} BenchConfig;
+
+static double now(void) { return omp_get_wtime(); }
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Parse a comma separated list of unsigned integers, return its length
+ */
+static unsigned int parseList(const char *list, unsigned int *values) {
+  unsigned int count = 0;
+  char *end;
+  while (*list != '\0' && count < MAX_LIST) {
+    values[count++] = (unsigned int)strtoul(list, &end, 10);
+    list = *end == ',' ? end + 1 : end;
+    if (end == list && *end != '\0')
+      break;
+  }
+  return count;
+}
+
+static meshType parseType(const char *name) {
+  char *argv[2] = {"bench", (char *)name};
+  return parseArguments(2, argv);
+}
+
+static void parseConfig(int argc, char **argv, BenchConfig *config) {
+  meshType all[] = {CURTAIN, TABLE_CLOTH, SOFT, FLAG};
+  unsigned int sizes[] = {20, 50, 100, 200, 500, 1000, 2000};
+
+  config->n_types = 4;
+  memcpy(config->types, all, sizeof(all));
+  config->n_sizes = 7;
+  memcpy(config->sizes, sizes, sizeof(sizes));
+  config->n_threads = 0;
+  for (unsigned int t = 1; t < omp_get_max_threads(); t *= 2) {
+    config->threads[config->n_threads++] = t;
+  }
+  config->threads[config->n_threads++] = omp_get_max_threads();
+  config->reps = 5;
+  config->warmup = 2;
+  config->vtk_max_size = 500;
+  config->output = "bench.csv";
+  config->deterministic = false;
+  config->tile_size = 0;
+  config->stencil = false;
+  config->pin = PIN_NONE;
+
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "--deterministic") == 0) {
+      config->deterministic = true;
+      continue;
+    }
+    if (strcmp(argv[k], "--stencil") == 0) {
+      config->stencil = true;
+      continue;
+    }
+
+    char *value = strchr(argv[k], '=');
+    if (strncmp(argv[k], "--", 2) != 0 || value == NULL) {
+      log_error("Unknown option %s", argv[k]);
+      exit(EXIT_FAILURE);
+    }
+    value++;
+
+    if (strncmp(argv[k], "--types=", 8) == 0) {
+      char names[256];
+      snprintf(names, sizeof(names), "%s", value);
+      config->n_types = 0;
+      for (char *name = strtok(names, ","); name != NULL;
+           name = strtok(NULL, ",")) {
+        config->types[config->n_types++] = parseType(name);
+      }
+    } else if (strncmp(argv[k], "--sizes=", 8) == 0) {
+      config->n_sizes = parseList(value, config->sizes);
+    } else if (strncmp(argv[k], "--threads=", 10) == 0) {
+      config->n_threads = parseList(value, config->threads);
+    } else if (strncmp(argv[k], "--reps=", 7) == 0) {
+      config->reps = (unsigned int)atoi(value);
+    } else if (strncmp(argv[k], "--warmup=", 9) == 0) {
+      config->warmup = (unsigned int)atoi(value);
+    } else if (strncmp(argv[k], "--vtk-max-size=", 15) == 0) {
+      config->vtk_max_size = (unsigned int)atoi(value);
+    } else if (strncmp(argv[k], "--output=", 9) == 0) {
+      config->output = value;
+    } else if (strncmp(argv[k], "--tile=", 7) == 0) {
+      config->tile_size = (unsigned int)atoi(value);
+    } else if (strncmp(argv[k], "--pin=", 6) == 0) {
+      if (!parsePinPolicy(value, &config->pin)) {
+        log_error("Unknown pinning %s", value);
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      log_error("Unknown option %s", argv[k]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (config->reps == 0) {
+    log_error("At least one repetition is needed");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * Bytes read or written once by a call of the kernel on the mesh
+ */
+static double kernelBytes(const Mesh *mesh, benchKernel kernel,
+                          const char *filename) {
+  double points = (double)mesh->n * mesh->m * sizeof(Vector);
+  double springs = (double)mesh->total_springs * sizeof(Spring);
+  if (mesh->stencil != NULL) // damage and broken bits of every direction
+    springs = (double)mesh->n * mesh->m * STENCIL_DIRECTIONS *
+              (sizeof(float) + 1.0 / 8);
+  struct stat st;
+
+  switch (kernel) {
+  case KERNEL_SPRINGS: // springs, P and P0 read, acc read and written
+    return springs + 4 * points;
+  case KERNEL_UPDATE: // the spring forces, then P, V and acc updated
+    return springs + 4 * points + 6 * points;
+  case KERNEL_FLUID: // P and V read
+    return 2 * points;
+  default: // the file written
+    return stat(filename, &st) == 0 ? (double)st.st_size : 0.0;
+  }
+}
+
+/**
+ * Run the kernel once on the mesh
+ */
+static void runKernel(Mesh *mesh, meshType type, benchKernel kernel,
+                      Vector **acc, const char *filename) {
+  switch (kernel) {
+  case KERNEL_SPRINGS:
+    memset(acc[0], 0, (size_t)mesh->n * mesh->m * sizeof(Vector));
+    computeSpringForces(mesh, acc, type, mesh->params.DELTA_T);
+    break;
+  case KERNEL_UPDATE:
+    updatePosition(mesh, mesh->params.DELTA_T, type);
+    break;
+  case KERNEL_FLUID:
+#pragma omp parallel for collapse(2)
+    for (int i = 0; i < mesh->n; i++) {
+      for (int j = 0; j < mesh->m; j++) {
+        acc[i][j] = computeFluidForce(mesh, i, j, mesh->params.FLUID);
+      }
+    }
+    break;
+  case KERNEL_VTK_POLY:
+    convertMeshToPolyVTK(mesh, filename);
+    break;
+  case KERNEL_VTK_GRID:
+    convertMeshToGridVTK(mesh, filename);
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Time the kernel: warmup calls, then reps timed calls
+ */
+static void timeKernel(const BenchConfig *config, Mesh *mesh, meshType type,
+                       benchKernel kernel, Vector **acc, BenchResult *result) {
+  const char *filename = "bench_vtk.vtk";
+  double *times = (double *)malloc(config->reps * sizeof(double));
+
+  for (unsigned int r = 0; r < config->warmup; r++) {
+    runKernel(mesh, type, kernel, acc, filename);
+  }
+  AllocTotals before = allocTotals();
+  for (unsigned int r = 0; r < config->reps; r++) {
+    double start = now();
+    runKernel(mesh, type, kernel, acc, filename);
+    times[r] = now() - start;
+  }
+  result->allocations =
+      allocCounted()
+          ? (double)(allocTotals().calls - before.calls) / config->reps
+          : NAN;
+
+  qsort(times, config->reps, sizeof(double), compareDouble);
+  result->min = times[0];
+  result->median = times[config->reps / 2];
+  result->mean = 0.0;
+  for (unsigned int r = 0; r < config->reps; r++) {
+    result->mean += times[r] / config->reps;
+  }
+  result->bytes = kernelBytes(mesh, kernel, filename);
+  remove(filename);
+  free(times);
+}
+
+/**
+ * Result of the same kernel, type and thread count at the given size, NULL
+ * if it was not measured
+ */
+static const BenchResult *findResult(const BenchResult *results,
+                                     unsigned int count,
+                                     const BenchResult *ref,
+                                     unsigned int size, unsigned int threads) {
+  for (unsigned int k = 0; k < count; k++) {
+    if (results[k].type == ref->type && results[k].kernel == ref->kernel &&
+        results[k].size == size && results[k].threads == threads)
+      return &results[k];
+  }
+  return NULL;
+}
+
+/**
+ * Strong scaling: same mesh, time on one thread over threads times the time
+ */
+static double strongEfficiency(const BenchResult *results, unsigned int count,
+                               const BenchResult *r) {
+  const BenchResult *serial = findResult(results, count, r, r->size, 1);
+  if (serial == NULL)
+    return NAN;
+  return serial->median / (r->threads * r->median);
+}
+
+/**
+ * Weak scaling: the single thread run with the number of points closest to
+ * (points / threads), compared per point
+ */
+static double weakEfficiency(const BenchResult *results, unsigned int count,
+                             const BenchResult *r) {
+  double target = (double)r->size * r->size / r->threads;
+  const BenchResult *serial = NULL;
+  for (unsigned int k = 0; k < count; k++) {
+    const BenchResult *c = &results[k];
+    if (c->type != r->type || c->kernel != r->kernel || c->threads != 1)
+      continue;
+    if (serial == NULL ||
+        fabs(log((double)c->size * c->size / target)) <
+            fabs(log((double)serial->size * serial->size / target)))
+      serial = c;
+  }
+  if (serial == NULL)
+    return NAN;
+
+  double serial_per_point =
+      serial->median / ((double)serial->size * serial->size);
+  double per_point_per_thread =
+      r->median * r->threads / ((double)r->size * r->size);
+  return serial_per_point / per_point_per_thread;
+}
+
+int main(int argc, char **argv) {
+  BenchConfig config;
+  parseConfig(argc, argv, &config);
+
+  Topology topology;
+  readTopology(&topology);
+  logTopology(&topology, config.pin);
+
+  unsigned int capacity = config.n_types * config.n_sizes *
+                          config.n_threads * KERNEL_COUNT;
+  BenchResult *results = (BenchResult *)malloc(capacity * sizeof(BenchResult));
+  unsigned int count = 0;
+
+  for (unsigned int t = 0; t < config.n_types; t++) {
+    meshType type = config.types[t];
+    for (unsigned int s = 0; s < config.n_sizes; s++) {
+      Params params = defaultParams();
+      customs_params(&params, type);
+      params.N = params.M = config.sizes[s];
+      params.ENERGY_THRESHOLD = FLT_MAX; // the springs never break
+      params.DAMAGE_THRESHOLD = FLT_MAX;
+      params.DETERMINISTIC = config.deterministic;
+      params.TILE_SIZE = config.tile_size;
+      params.STENCIL = config.stencil;
+
+      for (unsigned int p = 0; p < config.n_threads; p++) {
+        omp_set_num_threads(config.threads[p]);
+        pinThreads(&topology, config.pin);
+
+        // A new mesh for each thread count, first written by the threads
+        // which use it
+        Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
+        if (initMesh(mesh, type, &params) != 0)
+          return EXIT_FAILURE;
+        Vector **acc = getMatrix(mesh->n, mesh->m);
+
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+          if ((k == KERNEL_VTK_POLY || k == KERNEL_VTK_GRID) &&
+              config.sizes[s] > config.vtk_max_size)
+            continue;
+
+          BenchResult *result = &results[count++];
+          result->type = type;
+          result->size = config.sizes[s];
+          result->threads = config.threads[p];
+          result->kernel = (benchKernel)k;
+          timeKernel(&config, mesh, type, (benchKernel)k, acc, result);
+
+          log_info("%s %ux%u %u threads %s: %.6f s", getTypeName(type),
+                   result->size, result->size, result->threads,
+                   KERNEL_NAMES[k], result->median);
+        }
+
+        freeMatrix(acc, mesh->n);
+        freeMesh(mesh);
+      }
+    }
+  }
+
+  FILE *file = fopen(config.output, "w");
+  if (file == NULL) {
+    log_error("Error: Could not open file %s.", config.output);
+    return EXIT_FAILURE;
+  }
+  fprintf(file, "type,n,m,threads,kernel,reps,min_s,median_s,mean_s,"
+                "points,springs,bytes,bandwidth_GBs,strong_efficiency,"
+                "weak_efficiency,allocations\n");
+  for (unsigned int k = 0; k < count; k++) {
+    const BenchResult *r = &results[k];
+    fprintf(file,
+            "%s,%u,%u,%u,%s,%u,%.9f,%.9f,%.9f,%u,%" PRI_MESH_INDEX
+            ",%.0f,%.3f,%.3f,%.3f,%.1f\n",
+            getTypeName(r->type), r->size, r->size, r->threads,
+            KERNEL_NAMES[r->kernel], config.reps, r->min, r->median, r->mean,
+            r->size * r->size, numberOfSprings(r->size, r->size), r->bytes,
+            r->bytes / r->median / 1e9, strongEfficiency(results, count, r),
+            weakEfficiency(results, count, r), r->allocations);
+  }
+  fclose(file);
+  free(results);
+
+  log_info("Benchmark written in %s", config.output);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../include/log.h"
+
+/**
+ * Compare the trajectories of two runs, as written in VTK files, and report
+ * the maximum deviation of the positions.
+ *
+ * Usage: compare <run_a> <run_b> [--tolerance=T]
+ *
+ * A run is a VTK file or a directory of VTK files (e.g. vtk_poly_soft), the
+ * files of two directories being matched by name. The exit status is 1 if a
+ * deviation exceeds the tolerance (0 by default) or if the runs do not have
+ * the same frames or points.
+ */
+
+/**
+ * Read the POINTS section of a VTK file, return the number of points (NULL
+ * points and 0 on failure)
+ */
+static unsigned int readPoints(const char *filename, float **points) {
+  *points = NULL;
+  FILE *file = fopen(filename, "r");
+  if (file == NULL) {
+    log_error("Error: Could not open file %s.", filename);
+    return 0;
+  }
+
+  char line[256];
+  unsigned int count = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (sscanf(line, "POINTS %u", &count) == 1)
+      break;
+  }
+
+  if (count > 0) {
+    *points = (float *)malloc(3 * (size_t)count * sizeof(float));
+    for (size_t k = 0; k < 3 * (size_t)count; k++) {
+      if (fscanf(file, "%f", &(*points)[k]) != 1) {
+        log_error("Error: %s has less than %u points.", filename, count);
+        free(*points);
+        *points = NULL;
+        count = 0;
+        break;
+      }
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+/**
+ * Maximum distance between the points of two files, -1 if they cannot be
+ * compared
+ */
+static double compareFiles(const char *file_a, const char *file_b,
+                           unsigned int *worst_point) {
+  float *a, *b;
+  unsigned int count_a = readPoints(file_a, &a);
+  unsigned int count_b = readPoints(file_b, &b);
+  double deviation = -1.0;
+
+  if (count_a == 0 || count_a != count_b) {
+    log_error("%s and %s do not have the same points (%u and %u)", file_a,
+              file_b, count_a, count_b);
+  } else {
+    deviation = 0.0;
+    for (unsigned int k = 0; k < count_a; k++) {
+      double dx = a[3 * k] - b[3 * k];
+      double dy = a[3 * k + 1] - b[3 * k + 1];
+      double dz = a[3 * k + 2] - b[3 * k + 2];
+      double d = sqrt(dx * dx + dy * dy + dz * dz);
+      if (d > deviation) {
+        deviation = d;
+        *worst_point = k;
+      }
+    }
+  }
+  free(a);
+  free(b);
+  return deviation;
+}
+
+static int isVTK(const struct dirent *entry) {
+  const char *extension = strrchr(entry->d_name, '.');
+  return extension != NULL && strcmp(extension, ".vtk") == 0;
+}
+
+int main(int argc, char **argv) {
+  double tolerance = 0.0;
+  if (argc == 4 && strncmp(argv[3], "--tolerance=", 12) == 0) {
+    tolerance = atof(argv[3] + 12);
+  } else if (argc != 3) {
+    log_error("Usage: %s <run_a> <run_b> [--tolerance=T]", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct stat st;
+  if (stat(argv[1], &st) == -1) {
+    log_error("Error: %s does not exist.", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  double max_deviation = 0.0;
+  int failed = 0;
+  unsigned int worst_point = 0;
+
+  if (!S_ISDIR(st.st_mode)) {
+    max_deviation = compareFiles(argv[1], argv[2], &worst_point);
+    failed = max_deviation < 0.0;
+    if (!failed)
+      printf("%s: max deviation %.9g at point %u\n", argv[1], max_deviation,
+             worst_point);
+  } else {
+    struct dirent **entries;
+    int count = scandir(argv[1], &entries, isVTK, alphasort);
+    if (count < 0) {
+      log_error("Error: Could not read directory %s.", argv[1]);
+      return EXIT_FAILURE;
+    }
+
+    // The frames of b are counted to detect the ones missing in a
+    struct dirent **others;
+    int other_count = scandir(argv[2], &others, isVTK, alphasort);
+    if (other_count != count) {
+      log_error("%s has %d frames, %s has %d", argv[1], count, argv[2],
+                other_count);
+      failed = 1;
+    }
+    for (int k = 0; k < other_count; k++) {
+      free(others[k]);
+    }
+    free(others);
+
+    char file_a[4096], file_b[4096];
+    for (int k = 0; k < count; k++) {
+      snprintf(file_a, sizeof(file_a), "%s/%s", argv[1], entries[k]->d_name);
+      snprintf(file_b, sizeof(file_b), "%s/%s", argv[2], entries[k]->d_name);
+      double deviation = compareFiles(file_a, file_b, &worst_point);
+      if (deviation < 0.0) {
+        failed = 1;
+      } else {
+        printf("%s: max deviation %.9g at point %u\n", entries[k]->d_name,
+               deviation, worst_point);
+        max_deviation = fmax(max_deviation, deviation);
+      }
+      free(entries[k]);
+    }
+    free(entries);
+  }
+
+  printf("Maximum position deviation: %.9g (tolerance %.9g)\n", max_deviation,
+         tolerance);
+  return failed || max_deviation > tolerance ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cloth.h"
+
+/**
+ * Example of a host process driving libcloth: the soft cloth is stretched
+ * until it tears, breaks are counted by a callback and every frame is read
+ * in place to print the centroid of the cloth.
+ *
+ * Usage: embed_example [updates]
+ */
+
+static void onBreak(const Cloth *cloth, meshIndex spring, void *user_data) {
+  (*(meshIndex *)user_data)++;
+}
+
+static void onFrame(const Cloth *cloth, unsigned int step, void *user_data) {
+  unsigned int n, m;
+  const Vector *P = clothPositions(cloth, &n, &m);
+
+  Vector centroid = {0.0f, 0.0f, 0.0f};
+  for (unsigned int k = 0; k < n * m; k++) {
+    centroid = addVector(centroid, P[k]);
+  }
+  centroid = multVector(1.0f / (n * m), centroid);
+
+  printf("step %4u: centroid (%.3f, %.3f, %.3f), %" PRI_MESH_INDEX
+         " springs broken\n",
+         step, centroid.x, centroid.y, centroid.z, *(meshIndex *)user_data);
+}
+
+int main(int argc, char **argv) {
+  unsigned int updates = argc > 1 ? (unsigned int)atoi(argv[1]) : 300;
+
+  Cloth *cloth = clothCreate(SOFT, NULL);
+  if (cloth == NULL) {
+    fprintf(stderr, "Could not create the cloth\n");
+    return EXIT_FAILURE;
+  }
+  // one frame every 50 updates
+  if (clothSetParam(cloth, "STEP", 50) != 0 ||
+      clothSetParam(cloth, "C_DIS", 0.8f) != 0) {
+    fprintf(stderr, "Could not set the parameters of the cloth\n");
+    clothDestroy(cloth);
+    return EXIT_FAILURE;
+  }
+
+  meshIndex broken = 0;
+  clothOnBreak(cloth, onBreak, &broken);
+  clothOnFrame(cloth, onFrame, &broken);
+
+  clothStep(cloth, updates);
+
+  meshIndex count;
+  const Spring *springs = clothSprings(cloth, &count);
+  float max_damage = 0.0f;
+  for (meshIndex k = 0; k < count; k++) {
+    if (!springs[k].isBreak && springs[k].damage > max_damage)
+      max_damage = springs[k].damage;
+  }
+  printf("%u updates, %" PRI_MESH_INDEX "/%" PRI_MESH_INDEX
+         " springs broken, max damage %.3f\n",
+         clothStepCount(cloth), broken, count, max_damage);
+
+  clothDestroy(cloth);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/mesh.h"
+#include "../include/utils.h"
+
+/**
+ * Update time and deviation of a refined grid, against the same grid
+ * without refinement and the same grid with all its faces refined.
+ *
+ * Usage: refine [--type=curtain] [--levels=2] [--updates=1000]
+ *               [--adapt=20] [NAME=VALUE]...
+ *
+ * The three meshes are updated with the time step of the finest faces, the
+ * refined one being adapted every --adapt updates, which is timed with them.
+ * The deviation is the distance of the points of the grid to the same points
+ * of the fully refined grid, relative to the spacing of the grid. NAME=VALUE
+ * sets a field of Params, such as REFINE_STRAIN.
+ */
+
+#define N_RUNS 3
+
+// A mesh and the time spent updating it
+typedef struct Run {
+  const char *name;
+  Mesh *mesh;
+  unsigned int shift; // lattice steps between two points of the grid
+  double seconds;
+  double points; // summed over the updates
+} Run;
+
+/**
+ * Position of the point (i, j) of the grid in the mesh of a run
+ */
+static Vector gridPoint(const Run *run, unsigned int i, unsigned int j) {
+  const Refinement *refinement = run->mesh->refinement;
+  if (refinement != NULL)
+    return run->mesh->P[0][refinement->point_of[(size_t)(i << run->shift) *
+                                                    refinement->m +
+                                                (j << run->shift)]];
+  return run->mesh->P[i][j];
+}
+
+int main(int argc, char **argv) {
+  meshType type = CURTAIN;
+  unsigned int levels = 2, updates = 1000, adapt = 20;
+  for (int k = 1; k < argc; k++) {
+    if (strncmp(argv[k], "--type=", 7) == 0) {
+      char *type_argv[2] = {argv[0], argv[k] + 7};
+      type = parseArguments(2, type_argv);
+    }
+  }
+  Params params = defaultParams();
+  customs_params(&params, type);
+
+  for (int k = 1; k < argc; k++) {
+    char *equal = strchr(argv[k], '=');
+    if (strncmp(argv[k], "--type=", 7) == 0) {
+      continue;
+    } else if (strncmp(argv[k], "--levels=", 9) == 0) {
+      levels = (unsigned int)atoi(argv[k] + 9);
+    } else if (strncmp(argv[k], "--updates=", 10) == 0) {
+      updates = (unsigned int)atoi(argv[k] + 10);
+    } else if (strncmp(argv[k], "--adapt=", 8) == 0) {
+      adapt = (unsigned int)atoi(argv[k] + 8);
+    } else if (equal != NULL && argv[k][0] != '-') {
+      *equal = '\0';
+      const ParamInfo *info = findParam(argv[k]);
+      if (info == NULL) {
+        log_error("Unknown parameter %s", argv[k]);
+        return EXIT_FAILURE;
+      }
+      setParam(&params, info, (float)atof(equal + 1));
+    } else {
+      log_error("Usage: %s [--type=curtain] [--levels=2] [--updates=1000] "
+                "[--adapt=20] [NAME=VALUE]...",
+                argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (levels == 0 || adapt == 0) {
+    log_error("--levels and --adapt must be at least 1");
+    return EXIT_FAILURE;
+  }
+
+  // The time step of the finest faces, whose points are 4^levels lighter.
+  // Every face of the fine grid is split as soon as it is adapted.
+  params.DELTA_T /= 1u << levels;
+  params.REFINE_LEVELS = levels;
+  Params fine = params;
+  fine.REFINE_STRAIN = -1.0f;
+
+  Run runs[N_RUNS] = {{"grid", NULL, 0, 0.0, 0.0},
+                      {"refined", NULL, levels, 0.0, 0.0},
+                      {"fine", NULL, levels, 0.0, 0.0}};
+  for (unsigned int r = 0; r < N_RUNS; r++) {
+    runs[r].mesh = (Mesh *)malloc(sizeof(Mesh));
+  }
+  Params grid = params;
+  grid.REFINE_LEVELS = 0;
+  if (initMesh(runs[0].mesh, type, &grid) != 0 ||
+      initMeshAdaptive(runs[1].mesh, type, &params) != 0 ||
+      initMeshAdaptive(runs[2].mesh, type, &fine) != 0)
+    return EXIT_FAILURE;
+  for (unsigned int l = 0; l < levels; l++) {
+    adaptMesh(runs[2].mesh, type);
+  }
+
+  for (unsigned int r = 0; r < N_RUNS; r++) {
+    Mesh *mesh = runs[r].mesh;
+    double start = omp_get_wtime();
+    for (unsigned int u = 0; u < updates; u += adapt) {
+      unsigned int steps = updates - u < adapt ? updates - u : adapt;
+      adaptMesh(mesh, type);
+      updatePositions(mesh, params.DELTA_T, type, steps);
+      runs[r].points += (double)mesh->n * mesh->m * steps;
+    }
+    runs[r].seconds = omp_get_wtime() - start;
+  }
+
+  printf("%-8s %9s %11s %9s %10s %10s %10s\n", "mesh", "points",
+         "mean_points", "springs", "update_ms", "rms_dev", "max_dev");
+  for (unsigned int r = 0; r < N_RUNS; r++) {
+    double sum = 0.0, high = 0.0;
+    for (unsigned int i = 0; i < params.N; i++) {
+      for (unsigned int j = 0; j < params.M; j++) {
+        double d = norm(newVectorFromPoint(gridPoint(&runs[r], i, j),
+                                           gridPoint(&runs[2], i, j))) /
+                   params.SPACING;
+        sum += d * d;
+        high = fmax(high, d);
+      }
+    }
+    const Mesh *mesh = runs[r].mesh;
+    printf("%-8s %9u %11.0f %9" PRI_MESH_INDEX " %10.3f %10.4f %10.4f\n",
+           runs[r].name, mesh->n * mesh->m, runs[r].points / updates,
+           mesh->total_springs, 1e3 * runs[r].seconds / updates,
+           sqrt(sum / (params.N * params.M)), high);
+  }
+
+  for (unsigned int r = 0; r < N_RUNS; r++) {
+    freeMesh(runs[r].mesh);
+  }
+  return EXIT_SUCCESS;
+}
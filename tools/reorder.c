@@ -0,0 +1,178 @@
+#include <float.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../include/mesh.h"
+#include "../include/utils.h"
+
+/**
+ * Step time and cache misses of the updates of an imported mesh for every
+ * order of its points, written as a table.
+ *
+ * Usage: reorder <file.obj> [--type=curtain] [--steps=200] [--warmup=10]
+ *                [--deterministic]
+ *
+ * Springs never break, so every order does the same work. The cache misses
+ * are counted by the perf events of every thread of the OpenMP team, and
+ * are reported as n/a where they are not available.
+ */
+
+#define N_COUNTERS 2
+
+// Counters of every thread, -1 if they could not be opened
+typedef struct Counters {
+  int n_threads;
+  int *fd; // fd[t * N_COUNTERS + c]
+} Counters;
+
+static const unsigned long long COUNTER_CONFIG[N_COUNTERS] = {
+    PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+    PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+};
+
+static int openCounter(unsigned long long config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Open the counters in every thread of the team, which is kept by the
+ * following parallel regions
+ */
+static void openCounters(Counters *counters) {
+  counters->n_threads = omp_get_max_threads();
+  counters->fd = (int *)malloc(counters->n_threads * N_COUNTERS * sizeof(int));
+#pragma omp parallel
+  {
+    int t = omp_get_thread_num();
+    for (int c = 0; c < N_COUNTERS; c++) {
+      counters->fd[t * N_COUNTERS + c] = openCounter(COUNTER_CONFIG[c]);
+    }
+  }
+}
+
+static void switchCounters(const Counters *counters, bool on) {
+  for (int k = 0; k < counters->n_threads * N_COUNTERS; k++) {
+    if (counters->fd[k] < 0)
+      continue;
+    if (on)
+      ioctl(counters->fd[k], PERF_EVENT_IOC_RESET, 0);
+    ioctl(counters->fd[k], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE,
+          0);
+  }
+}
+
+/**
+ * Sum of the counter c over the threads, -1 if it is not available
+ */
+static long long readCounter(const Counters *counters, int c) {
+  long long sum = 0;
+  for (int t = 0; t < counters->n_threads; t++) {
+    long long value;
+    int fd = counters->fd[t * N_COUNTERS + c];
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+      return -1;
+    sum += value;
+  }
+  return sum;
+}
+
+static void printCount(long long count, unsigned int steps) {
+  if (count < 0)
+    printf(" %14s", "n/a");
+  else
+    printf(" %14.0f", (double)count / steps);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    log_error("Usage: %s <file.obj> [--type=curtain] [--steps=200] "
+              "[--warmup=10] [--deterministic]",
+              argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *filename = argv[1];
+  meshType type = CURTAIN;
+  unsigned int steps = 200, warmup = 10;
+  bool deterministic = false;
+  for (int k = 2; k < argc; k++) {
+    if (strncmp(argv[k], "--type=", 7) == 0) {
+      char *type_argv[2] = {argv[0], argv[k] + 7};
+      type = parseArguments(2, type_argv);
+    } else if (strncmp(argv[k], "--steps=", 8) == 0) {
+      steps = (unsigned int)atoi(argv[k] + 8);
+    } else if (strncmp(argv[k], "--warmup=", 9) == 0) {
+      warmup = (unsigned int)atoi(argv[k] + 9);
+    } else if (strcmp(argv[k], "--deterministic") == 0) {
+      deterministic = true;
+    } else {
+      log_error("Unknown option %s", argv[k]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Counters counters;
+  openCounters(&counters);
+
+  printf("%-8s %9s %9s %10s %10s %14s %14s\n", "order", "points", "springs",
+         "mean_span", "step_ms", "l1d_miss/step", "llc_miss/step");
+  reorderPolicy policies[] = {REORDER_NONE, REORDER_MORTON, REORDER_RCM};
+  for (unsigned int k = 0; k < 3; k++) {
+    Params params = defaultParams();
+    customs_params(&params, type);
+    params.ENERGY_THRESHOLD = FLT_MAX; // the springs never break
+    params.DAMAGE_THRESHOLD = FLT_MAX;
+    params.DETERMINISTIC = deterministic;
+
+    Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
+    if (initMeshFromObj(mesh, type, &params, filename, policies[k]) != 0) {
+      free(mesh);
+      return EXIT_FAILURE;
+    }
+
+    // Distance in memory between the two points of a spring
+    double span = 0.0;
+    for (meshIndex s = 0; s < mesh->total_springs; s++) {
+      span += mesh->springs[s].ext_2.j - mesh->springs[s].ext_1.j;
+    }
+    span /= mesh->total_springs;
+
+    updatePositions(mesh, params.DELTA_T, type, warmup);
+    switchCounters(&counters, true);
+    double start = omp_get_wtime();
+    updatePositions(mesh, params.DELTA_T, type, steps);
+    double elapsed = omp_get_wtime() - start;
+    switchCounters(&counters, false);
+
+    printf("%-8s %9u %9" PRI_MESH_INDEX " %10.1f %10.3f",
+           reorderPolicyName(policies[k]),
+           mesh->m, mesh->total_springs, span, 1e3 * elapsed / steps);
+    for (int c = 0; c < N_COUNTERS; c++) {
+      printCount(readCounter(&counters, c), steps);
+    }
+    printf("\n");
+    freeMesh(mesh);
+  }
+
+  for (int k = 0; k < counters.n_threads * N_COUNTERS; k++) {
+    if (counters.fd[k] >= 0)
+      close(counters.fd[k]);
+  }
+  free(counters.fd);
+  return EXIT_SUCCESS;
+}
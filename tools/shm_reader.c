@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/shm.h"
+
+/**
+ * Minimal consumer of the shared-memory ring buffer published by
+ * `app <type> --sink=shm`. Frames are read in place, without copy.
+ *
+ * Usage: shm_reader [--name=NAME] [--dump] [--timeout=SECONDS]
+ *   --dump     print every frame read (positions and face states)
+ *   otherwise  report the frame rate every second
+ */
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleepMs(long ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
+/**
+ * Print a frame to stdout, one point per line followed by one face per line
+ */
+static void dumpFrame(const ShmReader *reader, const ShmFrameView *view) {
+  unsigned int n = reader->header->n, m = reader->header->m;
+  printf("# frame %lu step %u t=%f springs %u\n", (unsigned long)view->frame,
+         view->step, view->t, view->n_springs);
+  for (unsigned int k = 0; k < n * m; k++) {
+    printf("%f %f %f\n", view->positions[3 * k], view->positions[3 * k + 1],
+           view->positions[3 * k + 2]);
+  }
+  for (unsigned int k = 0; k < (n - 1) * (m - 1); k++) {
+    printf("%d\n", view->faces[k]);
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *name = SHM_DEFAULT_NAME;
+  bool dump = false;
+  double timeout = 5.0;
+
+  for (int k = 1; k < argc; k++) {
+    if (strncmp(argv[k], "--name=", 7) == 0) {
+      name = argv[k] + 7;
+    } else if (strcmp(argv[k], "--dump") == 0) {
+      dump = true;
+    } else if (strncmp(argv[k], "--timeout=", 10) == 0) {
+      timeout = atof(argv[k] + 10);
+    } else {
+      log_error("Usage: %s [--name=NAME] [--dump] [--timeout=SECONDS]",
+                argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Wait for the publisher to create the segment
+  ShmReader *reader = NULL;
+  double start = now();
+  while ((reader = shmOpenReader(name)) == NULL) {
+    if (now() - start > timeout) {
+      log_error("No shared memory %s found", name);
+      return EXIT_FAILURE;
+    }
+    sleepMs(10);
+  }
+  log_info("Reading %s: mesh %ux%u, %u slots", name, reader->header->n,
+           reader->header->m, reader->header->slots);
+
+  uint64_t next = 0; // next frame to read
+  unsigned long read = 0, missed = 0, window_read = 0;
+  double last_frame = now(), window_start = last_frame;
+
+  while (now() - last_frame < timeout) {
+    uint64_t head = shmLatestFrame(reader);
+    if (next == head) {
+      sleepMs(1);
+    }
+
+    // Frames already overwritten by the publisher are lost
+    if (head > next + reader->header->slots) {
+      missed += head - reader->header->slots - next;
+      next = head - reader->header->slots;
+    }
+
+    for (; next < head; next++) {
+      ShmFrameView view;
+      if (!shmBeginRead(reader, next, &view)) {
+        missed++;
+        continue;
+      }
+      if (dump) {
+        dumpFrame(reader, &view);
+      }
+      if (shmEndRead(&view)) {
+        read++;
+        window_read++;
+      } else {
+        missed++; // torn by the publisher while we were reading it
+        if (dump)
+          printf("# frame %lu torn, ignore it\n", (unsigned long)next);
+      }
+      last_frame = now();
+    }
+
+    double elapsed = now() - window_start;
+    if (!dump && elapsed >= 1.0) {
+      log_info("%.1f frames/s (%lu read, %lu missed)", window_read / elapsed,
+               read, missed);
+      window_read = 0;
+      window_start = now();
+    }
+  }
+
+  log_info("No new frame for %.1f s: %lu frames read, %lu missed", timeout,
+           read, missed);
+  shmCloseReader(reader);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/sweep.h"
+#include "../include/utils.h"
+
+/**
+ * Run a grid of simulations of one mesh type in this process.
+ *
+ * Usage: sweep <type> [NAME=a,b,c | NAME=start:stop:count]...
+ *              [--output=FILE]
+ *
+ * NAME is a field of Params (STIFFNESS_H, C_DIS, FLUID.z...). Every
+ * combination of the values is simulated, one simulation per thread, and
+ * summarized in one line of the CSV output (sweep_<type>.csv by default).
+ */
+/**
+ * Log the usage of the sweep, not the one of the app
+ */
+static void usage(const char *program) {
+  log_error("Usage: %s <curtain|table-cloth|soft|flag> "
+            "[NAME=a,b,c | NAME=start:stop:count]... [--output=FILE]",
+            program);
+}
+
+int main(int argc, char **argv) {
+  meshType type;
+  if (argc < 2 || !parseMeshType(argv[1], &type)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Sweep sweep;
+  initSweep(&sweep, type);
+
+  char default_output[256];
+  snprintf(default_output, sizeof(default_output), "sweep_%s.csv",
+           getTypeName(type));
+  const char *output = default_output;
+
+  for (int k = 2; k < argc; k++) {
+    if (strncmp(argv[k], "--output=", 9) == 0) {
+      output = argv[k] + 9;
+      continue;
+    }
+
+    char *equal = strchr(argv[k], '=');
+    if (equal == NULL) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    *equal = '\0';
+    if (addSweepAxis(&sweep, argv[k], equal + 1) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return runSweep(&sweep, output) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
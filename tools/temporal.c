@@ -0,0 +1,129 @@
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/mesh.h"
+#include "../include/utils.h"
+
+/**
+ * Update time of the temporally blocked update, against the deterministic
+ * update it reproduces, for several sizes of tiles.
+ *
+ * Usage: temporal [--type=curtain] [--size=NxM] [--steps=4]
+ *                 [--tiles=16,32,64] [--updates=200] [NAME=VALUE]...
+ *
+ * Each mesh is updated --updates times by blocks of --steps updates, and
+ * its positions and velocities are compared bit for bit with those of the
+ * deterministic update. NAME=VALUE sets a field of Params.
+ */
+
+#define MAX_TILES 16
+
+/**
+ * Return true if the points and springs of the two meshes are the same
+ */
+static bool sameState(const Mesh *a, const Mesh *b) {
+  for (unsigned int i = 0; i < a->n; i++) {
+    if (memcmp(a->P[i], b->P[i], a->m * sizeof(Vector)) != 0 ||
+        memcmp(a->V[i], b->V[i], a->m * sizeof(Vector)) != 0)
+      return false;
+  }
+  for (meshIndex k = 0; k < a->total_springs; k++) {
+    if (a->springs[k].isBreak != b->springs[k].isBreak ||
+        a->springs[k].damage != b->springs[k].damage)
+      return false;
+  }
+  return a->n_springs == b->n_springs;
+}
+
+/**
+ * Update a mesh of params, and return the time of an update in seconds
+ */
+static double timeUpdates(Mesh *mesh, meshType type, const Params *params,
+                          unsigned int updates) {
+  initMesh(mesh, type, params);
+  double start = omp_get_wtime();
+  updatePositions(mesh, params->DELTA_T, type, updates);
+  return (omp_get_wtime() - start) / updates;
+}
+
+int main(int argc, char **argv) {
+  meshType type = CURTAIN;
+  unsigned int steps = 4, updates = 200, n_tiles = 3;
+  unsigned int tiles[MAX_TILES] = {16, 32, 64};
+  for (int k = 1; k < argc; k++) {
+    if (strncmp(argv[k], "--type=", 7) == 0) {
+      char *type_argv[2] = {argv[0], argv[k] + 7};
+      type = parseArguments(2, type_argv);
+    }
+  }
+  Params params = defaultParams();
+  customs_params(&params, type);
+
+  for (int k = 1; k < argc; k++) {
+    char *equal = strchr(argv[k], '=');
+    if (strncmp(argv[k], "--type=", 7) == 0) {
+      continue;
+    } else if (strncmp(argv[k], "--size=", 7) == 0) {
+      if (sscanf(argv[k] + 7, "%ux%u", &params.N, &params.M) != 2) {
+        log_error("Expected --size=NxM, got %s", argv[k]);
+        return EXIT_FAILURE;
+      }
+    } else if (strncmp(argv[k], "--steps=", 8) == 0) {
+      steps = (unsigned int)atoi(argv[k] + 8);
+    } else if (strncmp(argv[k], "--tiles=", 8) == 0) {
+      n_tiles = 0;
+      for (char *size = strtok(argv[k] + 8, ",");
+           size != NULL && n_tiles < MAX_TILES; size = strtok(NULL, ",")) {
+        tiles[n_tiles++] = (unsigned int)atoi(size);
+      }
+    } else if (strncmp(argv[k], "--updates=", 10) == 0) {
+      updates = (unsigned int)atoi(argv[k] + 10);
+    } else if (equal != NULL && argv[k][0] != '-') {
+      *equal = '\0';
+      const ParamInfo *info = findParam(argv[k]);
+      if (info == NULL) {
+        log_error("Unknown parameter %s", argv[k]);
+        return EXIT_FAILURE;
+      }
+      setParam(&params, info, (float)atof(equal + 1));
+    } else {
+      log_error("Usage: %s [--type=curtain] [--size=NxM] [--steps=4] "
+                "[--tiles=16,32,64] [--updates=200] [NAME=VALUE]...",
+                argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (steps < 2 || updates == 0 || n_tiles == 0) {
+    log_error("--steps must be at least 2, --updates and --tiles not empty");
+    return EXIT_FAILURE;
+  }
+  for (unsigned int t = 0; t < n_tiles; t++) {
+    if (tiles[t] == 0) {
+      log_error("The tiles have at least one point on a side");
+      return EXIT_FAILURE;
+    }
+  }
+
+  params.DETERMINISTIC = true;
+  Mesh *reference = (Mesh *)malloc(sizeof(Mesh));
+  double base = timeUpdates(reference, type, &params, updates);
+
+  printf("%-8s %7s %10s %8s %9s\n", "tile", "steps", "update_ms", "speedup",
+         "identical");
+  printf("%-8s %7u %10.3f %8.2f %9s\n", "none", 1u, 1e3 * base, 1.0, "yes");
+  for (unsigned int t = 0; t < n_tiles; t++) {
+    Params blocked = params;
+    blocked.TEMPORAL_STEPS = steps;
+    blocked.TEMPORAL_TILE = tiles[t];
+    Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
+    double seconds = timeUpdates(mesh, type, &blocked, updates);
+    printf("%-8u %7u %10.3f %8.2f %9s\n", tiles[t], steps, 1e3 * seconds,
+           base / seconds, sameState(mesh, reference) ? "yes" : "no");
+    freeMesh(mesh);
+  }
+
+  freeMesh(reference);
+  return EXIT_SUCCESS;
+}
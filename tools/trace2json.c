@@ -0,0 +1,106 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/log.h"
+#include "../include/trace.h"
+
+/**
+ * Convert a trace written by `app <type> --trace=FILE.bin` to the Chrome
+ * trace event format, to be opened in chrome://tracing or Perfetto.
+ *
+ * Usage: trace2json <trace.bin> [output.json]
+ *
+ * The updates are duration events, the spring breaks and normal failures
+ * are instant events on the thread which found them. The output goes to
+ * stdout if no file is given.
+ */
+
+/**
+ * Write one event as a JSON object, the time in microseconds
+ */
+static void writeEvent(FILE *out, const TraceEvent *event) {
+  double ts = event->time / 1000.0;
+  const char *name = traceTypeName((traceType)event->type);
+
+  switch (event->type) {
+  case TRACE_STEP_BEGIN:
+  case TRACE_STEP_END:
+    fprintf(out,
+            "{\"name\":\"%s\",\"cat\":\"solver\",\"ph\":\"%s\",\"ts\":%.3f,"
+            "\"pid\":0,\"tid\":%u,\"args\":{\"update\":%" PRIu64
+            ",\"springs\":%" PRIu64 "}}",
+            name, event->type == TRACE_STEP_BEGIN ? "B" : "E", ts,
+            event->thread, event->a, event->b);
+    break;
+  case TRACE_SPRING_BREAK:
+    fprintf(out,
+            "{\"name\":\"%s\",\"cat\":\"springs\",\"ph\":\"i\",\"s\":\"t\","
+            "\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"spring\":%" PRIu64 ","
+            "\"energy\":%g,\"damage\":%g}}",
+            name, ts, event->thread, event->a, event->x, event->y);
+    break;
+  case TRACE_NORMAL_FAILURE:
+    fprintf(out,
+            "{\"name\":\"%s\",\"cat\":\"fluid\",\"ph\":\"i\",\"s\":\"t\","
+            "\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"i\":%" PRIu64
+            ",\"j\":%" PRIu64 ",\"springs\":%g}}",
+            name, ts, event->thread, event->a, event->b, event->x);
+    break;
+  default:
+    fprintf(out,
+            "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+            "\"pid\":0,\"tid\":%u}",
+            name, ts, event->thread);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 3) {
+    log_error("Usage: %s <trace.bin> [output.json]", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (in == NULL) {
+    log_error("Error: Could not open file %s.", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  TraceHeader header;
+  if (fread(&header, sizeof(header), 1, in) != 1 ||
+      memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != TRACE_VERSION ||
+      header.event_size != sizeof(TraceEvent)) {
+    log_error("Error: %s is not a trace of this version.", argv[1]);
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  FILE *out = argc == 3 ? fopen(argv[2], "w") : stdout;
+  if (out == NULL) {
+    log_error("Error: Could not open file %s.", argv[2]);
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"start\":%llu},"
+               "\"traceEvents\":[\n",
+          (unsigned long long)header.start);
+  TraceEvent event;
+  unsigned long count = 0;
+  while (fread(&event, sizeof(event), 1, in) == 1) {
+    if (count++ > 0)
+      fprintf(out, ",\n");
+    writeEvent(out, &event);
+  }
+  fprintf(out, "\n]}\n");
+
+  fclose(in);
+  if (out != stdout) {
+    fclose(out);
+    log_info("%lu events converted to %s", count, argv[2]);
+  }
+  return EXIT_SUCCESS;
+}